@@ -3,7 +3,9 @@
 #pragma once
 
 #include "MyContainer.hpp"
+#include "SortedRuns.hpp"
 #include <vector>
+#include <memory>      // for std::allocator, std::shared_ptr
 #include <algorithm>   // for std::sort
 #include <cstddef>     // for std::size_t
 #include <stdexcept>   // for std::out_of_range
@@ -13,14 +15,21 @@ namespace ariel {
 /**
  * @brief Iterator that traverses a container’s elements in ascending order.
  * 
- * AscendingOrderIterator takes a copy of the container’s data, sorts it in
- * ascending order, and then allows sequential access via iterator semantics.
+ * AscendingOrderIterator reads a sorted copy of the container’s data in
+ * ascending order, and allows sequential access via iterator semantics. The
+ * sorted copy is shared (MyContainer hands the same one to every iterator
+ * until the container is modified). It may come as a base run plus a small
+ * delta run (see SortedRuns), which are merged while iterating.
+ * 
+ * @tparam Alloc  Allocator of the scratch copy (chosen by the container's storage).
  */
-template<typename T>
+template<typename T, typename Alloc = std::allocator<T>>
 class AscendingOrderIterator {
 private:
-    /// Sorted copy of all elements, in ascending order
-    std::vector<T> sorted_data;
+    /// Shared sorted runs of all elements, in ascending order
+    SortedRuns<T, Alloc> sorted_data;
+    /// Position of the current element in the merged runs
+    typename SortedRuns<T, Alloc>::Cursor pos;
     /// Current index within sorted_data (0-based)
     std::size_t index;
 
@@ -33,13 +42,48 @@ public:
      * @param all_data  Copy of the container’s data (will be moved into sorted_data).
      * @param idx       Starting index (default 0).
      */
-    AscendingOrderIterator(std::vector<T> all_data, std::size_t idx = 0)
-        : sorted_data(std::move(all_data)), index(idx)
+    AscendingOrderIterator(std::vector<T, Alloc> all_data, std::size_t idx = 0)
+        : sorted_data(), pos{0, 0}, index(idx)
     {
         // Sort the data in ascending order upon construction
-        std::sort(sorted_data.begin(), sorted_data.end());
+        std::sort(all_data.begin(), all_data.end());
+        sorted_data = SortedRuns<T, Alloc>(std::make_shared<const std::vector<T, Alloc>>(std::move(all_data)));
+        pos = sorted_data.split(idx < sorted_data.size() ? idx : sorted_data.size());
+    }
+
+    /**
+     * @brief Construct a new AscendingOrderIterator over already sorted data.
+     * 
+     * @param sorted  Shared copy of the elements, already in ascending order.
+     * @param idx     Starting index (default 0).
+     */
+    AscendingOrderIterator(std::shared_ptr<const std::vector<T, Alloc>> sorted, std::size_t idx = 0)
+        : AscendingOrderIterator(SortedRuns<T, Alloc>(std::move(sorted)), idx) {}
+
+    /**
+     * @brief Construct a new AscendingOrderIterator over sorted runs merged on the fly.
+     * 
+     * @param runs  Shared sorted base and delta runs of the elements.
+     * @param idx   Starting index (default 0).
+     */
+    AscendingOrderIterator(SortedRuns<T, Alloc> runs, std::size_t idx = 0)
+        : sorted_data(std::move(runs)), pos{0, 0}, index(idx)
+    {
+        if (index > 0) {
+            pos = sorted_data.split(index < sorted_data.size() ? index : sorted_data.size());
+        }
     }
 
+    /**
+     * @brief Construct a new AscendingOrderIterator at a cursor of the runs,
+     *        e.g. one found by SortedRuns::lowerBound.
+     * 
+     * @param runs  Shared sorted base and delta runs of the elements.
+     * @param at    Position of the first element to yield.
+     */
+    AscendingOrderIterator(SortedRuns<T, Alloc> runs, typename SortedRuns<T, Alloc>::Cursor at)
+        : sorted_data(std::move(runs)), pos(at), index(at.base + at.delta) {}
+
     /**
      * @brief Dereference operator.
      * 
@@ -53,7 +97,7 @@ public:
         if (index >= sorted_data.size()) {
             throw std::out_of_range("Iterator is out of bounds");
         }
-        return sorted_data[index];
+        return sorted_data.next(pos);
     }
 
     /**
@@ -69,6 +113,7 @@ public:
         if (index >= sorted_data.size()) {
             throw std::out_of_range("Cannot increment iterator: out of bounds");
         }
+        sorted_data.advance(pos);
         ++index;
         return *this;
     }
@@ -0,0 +1,1062 @@
+//dor.cohen15@msmail.ariel.ac.il
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <sys/resource.h> // for getrusage
+#include <unistd.h>       // for sysconf
+#include <thread>
+#include <atomic>
+#include <map>
+#include <unordered_map>
+#include "MyContainer.hpp"
+#include "ConcurrentContainer.hpp"
+#include "ConcurrentAppender.hpp"
+#include "ShardedContainer.hpp"
+#include "MergeIterator.hpp"
+#include "ParallelAlgorithms.hpp"
+#include <mutex>
+using namespace ariel;
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief Print p50 / p99 / p99.9 / max of a set of latency samples (in ns).
+ */
+static void printPercentiles(const std::string& label, std::vector<long long>& samples) {
+    std::sort(samples.begin(), samples.end());
+    auto at = [&](double p) {
+        return samples[static_cast<std::size_t>(p * (samples.size() - 1))];
+    };
+    std::cout << std::left << std::setw(28) << label
+              << " p50=" << at(0.50) << "ns"
+              << " p99=" << at(0.99) << "ns"
+              << " p99.9=" << at(0.999) << "ns"
+              << " max=" << samples.back() << "ns" << std::endl;
+}
+
+/**
+ * @brief Measure the latency of every single addElement call.
+ *
+ * With std::vector storage the calls that trigger a regrowth copy the whole
+ * array and show up in the tail; segmented storage never relocates.
+ */
+template<typename Container>
+static void benchAddElementLatency(const std::string& label, std::size_t n) {
+    Container c;
+    std::vector<long long> samples;
+    samples.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        auto start = Clock::now();
+        c.addElement(static_cast<int>(i));
+        auto stop = Clock::now();
+        samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+    }
+    printPercentiles(label, samples);
+}
+
+/**
+ * @brief Page faults so far and the current resident set size of the process.
+ */
+struct MemoryStats {
+    long minor_faults;
+    long major_faults;
+    long rss_kb;
+
+    static MemoryStats now() {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        long pages = 0;
+        long resident = 0;
+        std::ifstream statm("/proc/self/statm");
+        statm >> pages >> resident;
+        return MemoryStats{usage.ru_minflt, usage.ru_majflt, resident * (sysconf(_SC_PAGESIZE) / 1024)};
+    }
+};
+
+/**
+ * @brief Fill a container, then walk it in ascending order, reporting the time,
+ *        page faults and RSS of both phases.
+ */
+template<typename Container>
+static void benchMemory(const std::string& label, std::size_t n) {
+    MemoryStats before = MemoryStats::now();
+    auto start = Clock::now();
+    Container c;
+    for (std::size_t i = 0; i < n; ++i) {
+        c.addElement(static_cast<int>((i * 2654435761u) % n));
+    }
+    auto filled = Clock::now();
+    MemoryStats afterFill = MemoryStats::now();
+    long long sum = 0;
+    auto end = c.end_ascending_order();
+    for (auto it = c.begin_ascending_order(); it != end; ++it) {
+        sum += *it;
+    }
+    auto sorted = Clock::now();
+    MemoryStats afterSort = MemoryStats::now();
+
+    auto ms = [](Clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+    };
+    std::cout << std::left << std::setw(28) << label
+              << " fill=" << ms(filled - start) << "ms"
+              << " faults=" << (afterFill.minor_faults - before.minor_faults)
+              << "/" << (afterFill.major_faults - before.major_faults)
+              << " rss=" << afterFill.rss_kb / 1024 << "MB"
+              << " | ascending=" << ms(sorted - filled) << "ms"
+              << " faults=" << (afterSort.minor_faults - afterFill.minor_faults)
+              << "/" << (afterSort.major_faults - afterFill.major_faults)
+              << " rss=" << afterSort.rss_kb / 1024 << "MB"
+              << " (checksum " << sum << ")" << std::endl;
+}
+
+/**
+ * @brief Report the throughput of one phase over the given number of bytes.
+ */
+static void printThroughput(const std::string& label, std::size_t bytes, Clock::duration d) {
+    double seconds = std::chrono::duration<double>(d).count();
+    std::cout << std::left << std::setw(28) << label
+              << " " << std::fixed << std::setprecision(1)
+              << (seconds * 1000) << "ms  "
+              << (bytes / seconds / (1 << 20)) << " MB/s" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+}
+
+/**
+ * @brief Round trip n ints through binary save/load and through text.
+ */
+static void benchSerialization(std::size_t n) {
+    MyContainer<int> c;
+    for (std::size_t i = 0; i < n; ++i) {
+        c.addElement(static_cast<int>(i * 2654435761u));
+    }
+
+    // binary, buffer based
+    std::vector<char> buffer;
+    auto start = Clock::now();
+    c.save(buffer);
+    auto saved = Clock::now();
+    MyContainer<int> back;
+    back.load(buffer.data(), buffer.size());
+    auto loaded = Clock::now();
+    printThroughput("binary save (buffer)", buffer.size(), saved - start);
+    printThroughput("binary load (buffer)", buffer.size(), loaded - saved);
+
+    // binary, stream based
+    std::stringstream binary(std::ios::in | std::ios::out | std::ios::binary);
+    start = Clock::now();
+    c.save(binary);
+    saved = Clock::now();
+    back.load(binary);
+    loaded = Clock::now();
+    printThroughput("binary save (stream)", buffer.size(), saved - start);
+    printThroughput("binary load (stream)", buffer.size(), loaded - saved);
+
+    // text: operator<< and parsing the "[a, b, c]" output back
+    std::ostringstream text;
+    start = Clock::now();
+    text << c;
+    saved = Clock::now();
+    std::string dumped = text.str();
+    std::istringstream in(dumped);
+    MyContainer<int> parsed;
+    in >> parsed;
+    loaded = Clock::now();
+    printThroughput("text operator<<", dumped.size(), saved - start);
+    printThroughput("text operator>>", dumped.size(), loaded - saved);
+
+    // bulk loader over a one-value-per-line dump
+    std::string lines;
+    for (std::size_t i = 0; i < n; ++i) {
+        lines += std::to_string(static_cast<int>(i * 2654435761u));
+        lines += '\n';
+    }
+    std::istringstream linesIn(lines);
+    MyContainer<int> bulk;
+    start = Clock::now();
+    bulk.loadText(linesIn);
+    loaded = Clock::now();
+    printThroughput("text loadText", lines.size(), loaded - start);
+}
+
+/**
+ * @brief Single-value ingest into ConcurrentContainer: n addElement() calls,
+ *        alone and with a snapshot() every 1000 appends, then one flush().
+ */
+static void benchConcurrentIngest(std::size_t n) {
+    for (std::size_t read_every : {std::size_t(0), std::size_t(1000)}) {
+        ConcurrentContainer<int> shared;
+        std::size_t seen = 0;
+        auto start = Clock::now();
+        for (std::size_t i = 0; i < n; ++i) {
+            shared.addElement(static_cast<int>(i));
+            if (read_every != 0 && i % read_every == 0) {
+                seen += shared.snapshot()->size();
+            }
+        }
+        shared.flush();
+        seen += shared.size();
+        auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        volatile std::size_t keep = seen; // keeps the reads from being optimized away
+        (void)keep;
+        std::cout << std::left << std::setw(28)
+                  << (read_every == 0 ? "single addElement" : "addElement + read per 1000")
+                  << " " << std::fixed << std::setprecision(1) << (elapsed / n) << "ns/value" << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+}
+
+/**
+ * @brief Reader and writer scaling of ConcurrentContainer.
+ *
+ * Every reader repeatedly takes a snapshot and sums it in insertion order for
+ * a fixed time; optionally one writer keeps publishing batches of 1000 values
+ * meanwhile. Reports snapshots read per second and versions published.
+ */
+static void benchConcurrent(std::size_t n) {
+    constexpr auto DURATION = std::chrono::milliseconds(500);
+    for (bool with_writer : {false, true}) {
+        for (int readers : {1, 2, 4, 8}) {
+            ConcurrentContainer<int> shared;
+            std::vector<int> initial(n);
+            for (std::size_t i = 0; i < n; ++i) {
+                initial[i] = static_cast<int>(i);
+            }
+            shared.addElements(initial.begin(), initial.end());
+
+            std::atomic<bool> stop(false);
+            std::atomic<long long> reads(0);
+            std::atomic<long long> sink(0);
+            long long published = 0;
+            std::vector<std::thread> threads;
+            for (int r = 0; r < readers; ++r) {
+                threads.emplace_back([&]() {
+                    long long local = 0, total = 0;
+                    while (!stop.load(std::memory_order_relaxed)) {
+                        auto snap = shared.snapshot();
+                        for (auto it = snap->begin_order(); it != snap->end_order(); ++it) {
+                            total += *it;
+                        }
+                        ++local;
+                    }
+                    reads += local;
+                    sink += total;
+                });
+            }
+            if (with_writer) {
+                threads.emplace_back([&]() {
+                    std::vector<int> batch(1000, 1);
+                    while (!stop.load(std::memory_order_relaxed)) {
+                        shared.addElements(batch.begin(), batch.end());
+                        ++published;
+                    }
+                });
+            }
+            std::this_thread::sleep_for(DURATION);
+            stop = true;
+            for (auto& t : threads) {
+                t.join();
+            }
+            double seconds = std::chrono::duration<double>(DURATION).count();
+            std::cout << std::left << std::setw(28)
+                      << (std::to_string(readers) + " readers" + (with_writer ? " + 1 writer" : ""))
+                      << " " << std::fixed << std::setprecision(1)
+                      << (reads.load() / seconds) << " snapshots/s";
+            if (with_writer) {
+                std::cout << "  " << (published / seconds) << " publishes/s";
+            }
+            std::cout << std::endl;
+            std::cout.unsetf(std::ios::floatfield);
+        }
+    }
+}
+
+/**
+ * @brief Run producer(t) on the given number of threads and return the wall time.
+ */
+template<typename Producer>
+static Clock::duration runProducers(int threads, Producer producer) {
+    std::vector<std::thread> pool;
+    auto start = Clock::now();
+    for (int t = 0; t < threads; ++t) {
+        pool.emplace_back(producer, t);
+    }
+    for (auto& th : pool) {
+        th.join();
+    }
+    return Clock::now() - start;
+}
+
+/**
+ * @brief Append n ints from 1 to 64 producer threads: a mutex around
+ *        MyContainer::addElement versus ConcurrentAppender (one fetch-add per
+ *        value, and batched through a Producer).
+ */
+static void benchProducers(std::size_t n) {
+    auto report = [](const std::string& label, std::size_t count, Clock::duration d) {
+        double seconds = std::chrono::duration<double>(d).count();
+        std::cout << std::left << std::setw(28) << label
+                  << " " << std::fixed << std::setprecision(1)
+                  << (count / seconds / 1e6) << " M appends/s" << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    };
+    for (int threads : {1, 2, 4, 8, 16, 32, 64}) {
+        std::size_t per = n / threads;
+        std::string suffix = " x" + std::to_string(threads);
+
+        MyContainer<int> locked;
+        std::mutex lock;
+        report("mutex addElement" + suffix, per * threads, runProducers(threads, [&](int t) {
+            for (std::size_t i = 0; i < per; ++i) {
+                std::lock_guard<std::mutex> guard(lock);
+                locked.addElement(static_cast<int>(t * per + i));
+            }
+        }));
+
+        ConcurrentAppender<int> single;
+        report("appender append" + suffix, per * threads, runProducers(threads, [&](int t) {
+            for (std::size_t i = 0; i < per; ++i) {
+                single.append(static_cast<int>(t * per + i));
+            }
+        }));
+
+        ConcurrentAppender<int> batched;
+        report("appender Producer" + suffix, per * threads, runProducers(threads, [&](int t) {
+            ConcurrentAppender<int>::Producer producer(batched);
+            for (std::size_t i = 0; i < per; ++i) {
+                producer.add(static_cast<int>(t * per + i));
+            }
+        }));
+    }
+}
+
+/**
+ * @brief Ingest n ints into a ShardedContainer from 1 to 16 threads, each
+ *        owning one shard, then scan it in global ascending order.
+ */
+static void benchSharded(std::size_t n) {
+    for (int threads : {1, 2, 4, 8, 16}) {
+        std::size_t per = n / threads;
+        ShardedContainer<int> sharded(static_cast<std::size_t>(threads));
+        auto ingest = runProducers(threads, [&](int t) {
+            for (std::size_t i = 0; i < per; ++i) {
+                sharded.addElementTo(static_cast<std::size_t>(t), static_cast<int>((t * per + i) * 2654435761u));
+            }
+        });
+        auto start = Clock::now();
+        long long sum = 0;
+        auto end = sharded.end_ascending_order();
+        for (auto it = sharded.begin_ascending_order(); it != end; ++it) {
+            sum += *it;
+        }
+        auto scan = Clock::now() - start;
+        volatile long long keep = sum; // keeps the scan from being optimized away
+        (void)keep;
+        std::cout << std::left << std::setw(28) << (std::to_string(threads) + " shards")
+                  << " ingest " << std::fixed << std::setprecision(1)
+                  << (per * threads / std::chrono::duration<double>(ingest).count() / 1e6) << " M/s"
+                  << "  ascending scan " << (std::chrono::duration<double>(scan).count() * 1000) << "ms" << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+}
+
+/**
+ * @brief Global ascending scan over many tenants: concatenating into one
+ *        container and sorting versus a MergedView over their sorted data.
+ */
+static void benchMerge(std::size_t n) {
+    for (std::size_t k : {4, 64, 512}) {
+        std::vector<MyContainer<int>> tenants(k);
+        for (std::size_t i = 0; i < n; ++i) {
+            tenants[i % k].addElement(static_cast<int>(i * 2654435761u));
+        }
+        for (const auto& t : tenants) {
+            t.begin_ascending_order(); // warm every tenant's sorted cache
+        }
+
+        long long sum = 0;
+        auto start = Clock::now();
+        MyContainer<int> all;
+        for (const auto& t : tenants) {
+            for (auto it = t.begin_order(); it != t.end_order(); ++it) {
+                all.addElement(*it);
+            }
+        }
+        auto allEnd = all.end_ascending_order();
+        for (auto it = all.begin_ascending_order(); it != allEnd; ++it) {
+            sum += *it;
+        }
+        auto concatenated = Clock::now() - start;
+
+        start = Clock::now();
+        MergedView<int> view(tenants);
+        auto viewEnd = view.end_ascending_order();
+        for (auto it = view.begin_ascending_order(); it != viewEnd; ++it) {
+            sum -= *it;
+        }
+        auto merged = Clock::now() - start;
+        volatile long long keep = sum;
+        (void)keep;
+
+        std::cout << std::left << std::setw(28) << (std::to_string(k) + " tenants")
+                  << " concat+sort " << std::fixed << std::setprecision(1)
+                  << (std::chrono::duration<double>(concatenated).count() * 1000) << "ms"
+                  << "  loser-tree merge " << (std::chrono::duration<double>(merged).count() * 1000) << "ms"
+                  << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+}
+
+/**
+ * @brief A per-element scoring pass and a sum in every order: serial loop
+ *        over the iterator versus parallel_for_each / parallel_reduce.
+ */
+static void benchParallel(std::size_t n) {
+    MyContainer<int> c;
+    for (std::size_t i = 0; i < n; ++i) {
+        c.addElement(static_cast<int>(i * 2654435761u));
+    }
+    c.begin_ascending_order(); // sort once up front, for every order
+    auto score = [](int v) {
+        unsigned x = static_cast<unsigned>(v);
+        for (int r = 0; r < 16; ++r) {
+            x = x * 1664525u + 1013904223u;
+        }
+        return x;
+    };
+    std::vector<unsigned> scores(n);
+    auto ms = [](Clock::duration d) { return std::chrono::duration<double>(d).count() * 1000; };
+
+    auto start = Clock::now();
+    std::size_t k = 0;
+    for (auto it = c.begin_side_cross_order(); it != c.end_side_cross_order(); ++it) {
+        scores[k++] = score(*it);
+    }
+    auto serial = Clock::now() - start;
+    start = Clock::now();
+    parallel_for_each(c, Order::SideCross, [&](std::size_t pos, const int& v) { scores[pos] = score(v); });
+    auto parallel = Clock::now() - start;
+    std::cout << std::left << std::setw(28) << "scoring pass (side-cross)"
+              << " serial " << std::fixed << std::setprecision(1) << ms(serial) << "ms"
+              << "  parallel " << ms(parallel) << "ms  (" << defaultPool().workerCount() << " workers)" << std::endl;
+
+    for (std::size_t grain : {std::size_t(1024), std::size_t(65536), std::size_t(0)}) {
+        start = Clock::now();
+        long long sum = parallel_reduce(c, Order::Ascending, 0LL,
+                                        [](long long a, long long b) { return a + b; }, grain);
+        auto reduced = Clock::now() - start;
+        volatile long long keep = sum;
+        (void)keep;
+        std::cout << std::left << std::setw(28) << ("parallel_reduce grain " + std::to_string(grain))
+                  << " " << ms(reduced) << "ms" << std::endl;
+    }
+    std::cout.unsetf(std::ios::floatfield);
+}
+
+/**
+ * @brief remove() of a value matching 1% of n ints: serial std::remove
+ *        compaction versus the parallel block compaction.
+ */
+static void benchRemove(std::size_t n) {
+    auto ms = [](Clock::duration d) { return std::chrono::duration<double>(d).count() * 1000; };
+    const std::size_t saved = MyContainer<int>::parallel_remove_threshold;
+    for (bool parallel : {false, true}) {
+        MyContainer<int>::parallel_remove_threshold = parallel ? 0 : static_cast<std::size_t>(-1);
+        MyContainer<int> c;
+        for (std::size_t i = 0; i < n; ++i) {
+            c.addElement(static_cast<int>(i % 100));
+        }
+        auto start = Clock::now();
+        c.remove(42);
+        auto removed = Clock::now() - start;
+        std::cout << std::left << std::setw(28) << (parallel ? "remove (parallel)" : "remove (serial)")
+                  << " " << std::fixed << std::setprecision(1) << ms(removed) << "ms" << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+    MyContainer<int>::parallel_remove_threshold = saved;
+}
+
+/**
+ * @brief Fork-join overhead at small sizes: one parallelFor on the shared
+ *        pool versus spawning two std::threads per call, plus parallel versus
+ *        serial sort of n ints.
+ */
+static void benchForkJoin(std::size_t n) {
+    WorkStealingPool& pool = defaultPool();
+    std::vector<int> values(65536, 1);
+    for (std::size_t size : {std::size_t(1), std::size_t(16), std::size_t(256), std::size_t(4096), std::size_t(65536)}) {
+        constexpr int ROUNDS = 2000;
+        std::atomic<long long> sum(0);
+        auto body = [&](std::size_t begin, std::size_t end) {
+            long long local = 0;
+            for (std::size_t i = begin; i < end; ++i) {
+                local += values[i];
+            }
+            sum += local;
+        };
+        auto start = Clock::now();
+        for (int r = 0; r < ROUNDS; ++r) {
+            pool.parallelFor(size, 0, body);
+        }
+        auto pooled = Clock::now() - start;
+        start = Clock::now();
+        for (int r = 0; r < ROUNDS; ++r) {
+            std::thread left(body, 0, size / 2);
+            std::thread right(body, size / 2, size);
+            left.join();
+            right.join();
+        }
+        auto spawned = Clock::now() - start;
+        auto perCall = [](Clock::duration d) {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count() / ROUNDS;
+        };
+        std::cout << std::left << std::setw(28) << ("fork-join n=" + std::to_string(size))
+                  << " pool " << perCall(pooled) << "ns/call"
+                  << "  thread spawn " << perCall(spawned) << "ns/call" << std::endl;
+    }
+
+    std::vector<int> random(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        random[i] = static_cast<int>(i * 2654435761u);
+    }
+    std::vector<int> copy = random;
+    auto start = Clock::now();
+    std::sort(copy.begin(), copy.end());
+    auto serial = Clock::now() - start;
+    start = Clock::now();
+    parallelSort(random, pool);
+    auto parallel = Clock::now() - start;
+    auto ms = [](Clock::duration d) { return std::chrono::duration<double>(d).count() * 1000; };
+    std::cout << std::left << std::setw(28) << "sort"
+              << " std::sort " << std::fixed << std::setprecision(1) << ms(serial) << "ms"
+              << "  parallelSort " << ms(parallel) << "ms" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+}
+
+/**
+ * @brief Latency of the first sorted query after every burst of appends,
+ *        with the sorted cache rebuilt on the query thread versus in the
+ *        background (setBackgroundSort).
+ */
+static void benchBackgroundSort(std::size_t n) {
+    constexpr int BURSTS = 200;
+    constexpr std::size_t BURST = 1000;
+    volatile int keep = 0; // keeps the queries from being optimized away
+    for (bool background : {false, true}) {
+        MyContainer<int> c;
+        c.setBackgroundSort(background);
+        for (std::size_t i = 0; i < n; ++i) {
+            c.addElement(static_cast<int>(i * 2654435761u));
+        }
+        keep = *c.begin_ascending_order();
+        std::vector<long long> samples;
+        samples.reserve(BURSTS);
+        for (int b = 0; b < BURSTS; ++b) {
+            for (std::size_t i = 0; i < BURST; ++i) {
+                c.addElement(static_cast<int>((b * BURST + i) * 40503u));
+            }
+            auto start = Clock::now();
+            keep = *c.begin_ascending_order();
+            samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+        }
+        c.waitForBackgroundSort();
+        printPercentiles(background ? "sorted query (background)" : "sorted query (inline)", samples);
+    }
+    (void)keep;
+}
+
+/**
+ * @brief Steady-state workload: every round appends 1000 ints, removes one
+ *        value and scans the whole container in ascending order. The
+ *        incremental index sorts only the appended ints; the reference
+ *        re-sorts a copy of every element, as each scan did before.
+ */
+static void benchIncrementalScan(std::size_t n) {
+    constexpr int ROUNDS = 20;
+    constexpr std::size_t BURST = 1000;
+    auto ms = [](Clock::duration d) { return std::chrono::duration<double>(d).count() * 1000 / ROUNDS; };
+    MyContainer<int> c;
+    std::vector<int> reference;
+    for (std::size_t i = 0; i < n; ++i) {
+        c.addElement(static_cast<int>(i * 2654435761u % 1000003));
+        reference.push_back(static_cast<int>(i * 2654435761u % 1000003));
+    }
+    long long sum = 0;
+    for (auto it = c.begin_ascending_order(); it != c.end_ascending_order(); ++it) {
+        sum += *it;
+    }
+    Clock::duration incremental{};
+    Clock::duration resorted{};
+    for (int r = 0; r < ROUNDS; ++r) {
+        for (std::size_t i = 0; i < BURST; ++i) {
+            int v = static_cast<int>((r * BURST + i) * 40503u % 1000003);
+            c.addElement(v);
+            reference.push_back(v);
+        }
+        int gone = *c.begin_order();
+        auto start = Clock::now();
+        c.remove(gone);
+        for (auto it = c.begin_ascending_order(); it != c.end_ascending_order(); ++it) {
+            sum += *it;
+        }
+        incremental += Clock::now() - start;
+
+        start = Clock::now();
+        reference.erase(std::remove(reference.begin(), reference.end(), gone), reference.end());
+        std::vector<int> copy = reference;
+        std::sort(copy.begin(), copy.end());
+        for (int v : copy) {
+            sum += v;
+        }
+        resorted += Clock::now() - start;
+    }
+    volatile long long keep = sum; // keeps the scans from being optimized away
+    (void)keep;
+    std::cout << std::left << std::setw(28) << "remove + ascending scan"
+              << " incremental " << std::fixed << std::setprecision(1) << ms(incremental) << "ms"
+              << "  full re-sort " << ms(resorted) << "ms" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+}
+
+/**
+ * @brief Interleaved single inserts and short sorted reads (the ten smallest
+ *        elements and the median): sorted index versus tree index.
+ */
+static void benchTreeIndex(std::size_t n) {
+    constexpr int ROUNDS = 10000;
+    volatile int keep = 0; // keeps the reads from being optimized away
+    for (bool use_tree : {false, true}) {
+        MyContainer<int> c;
+        for (std::size_t i = 0; i < n; ++i) {
+            c.addElement(static_cast<int>(i * 2654435761u));
+        }
+        c.setTreeIndex(use_tree);
+        keep = *c.begin_ascending_order();
+        std::vector<long long> samples;
+        samples.reserve(ROUNDS);
+        for (int r = 0; r < ROUNDS; ++r) {
+            auto start = Clock::now();
+            c.addElement(static_cast<int>(r * 40503u));
+            auto it = c.begin_ascending_order();
+            for (int k = 0; k < 10; ++k, ++it) {
+                keep = *it;
+            }
+            keep = c.kthSmallest(c.size() / 2);
+            samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+        }
+        printPercentiles(use_tree ? "insert + read (tree index)" : "insert + read (sorted index)", samples);
+    }
+    (void)keep;
+}
+
+/**
+ * @brief Range query "the 100 elements from X up": seek with
+ *        begin_ascending_order_from versus walking from begin_ascending_order.
+ */
+static void benchRangeSeek(std::size_t n) {
+    constexpr int QUERIES = 200;
+    MyContainer<int> c;
+    for (std::size_t i = 0; i < n; ++i) {
+        c.addElement(static_cast<int>(i * 2654435761u % 1000000007u));
+    }
+    long long sum = *c.begin_ascending_order();
+    auto per = [](Clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count() / QUERIES;
+    };
+    auto start = Clock::now();
+    for (int q = 0; q < QUERIES; ++q) {
+        int from = static_cast<int>(q * 4999999u);
+        auto it = c.begin_ascending_order_from(from);
+        for (int k = 0; k < 100 && it != c.end_ascending_order(); ++k, ++it) {
+            sum += *it;
+        }
+    }
+    auto seek = Clock::now() - start;
+    start = Clock::now();
+    for (int q = 0; q < QUERIES; ++q) {
+        int from = static_cast<int>(q * 4999999u);
+        auto it = c.begin_ascending_order();
+        while (it != c.end_ascending_order() && *it < from) {
+            ++it;
+        }
+        for (int k = 0; k < 100 && it != c.end_ascending_order(); ++k, ++it) {
+            sum += *it;
+        }
+    }
+    auto walk = Clock::now() - start;
+    volatile long long keep = sum; // keeps the reads from being optimized away
+    (void)keep;
+    std::cout << std::left << std::setw(28) << "100 elements from a bound"
+              << " seek " << per(seek) << "ns/query"
+              << "  walk from begin " << per(walk) << "ns/query" << std::endl;
+}
+
+/**
+ * @brief contains() lookups against a large sorted base, with binary search
+ *        (default) and with the Eytzinger search accelerator.
+ */
+static void benchSearchLayout(std::size_t n) {
+    constexpr int QUERIES = 1000000;
+    for (bool accelerated : {false, true}) {
+        MyContainer<int> c;
+        c.setSearchAccelerator(accelerated);
+        for (std::size_t i = 0; i < n; ++i) {
+            c.addElement(static_cast<int>(i * 2654435761u % 1000000007u));
+        }
+        std::size_t found = c.count(0); // builds the index (and the layout)
+        auto start = Clock::now();
+        for (int q = 0; q < QUERIES; ++q) {
+            found += c.contains(static_cast<int>(q * 2654435761u % 1000000007u)) ? 1 : 0;
+        }
+        auto elapsed = Clock::now() - start;
+        volatile std::size_t keep = found; // keeps the lookups from being optimized away
+        (void)keep;
+        std::cout << std::left << std::setw(28) << (accelerated ? "contains, Eytzinger" : "contains, binary search")
+                  << " " << std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / QUERIES
+                  << "ns/lookup" << std::endl;
+    }
+}
+
+/**
+ * @brief Median of a fresh container: sort and walk to the middle with the
+ *        ascending iterator, select with median() (no index), and look it up
+ *        with median() once the sorted index exists.
+ */
+static void benchMedian(std::size_t n) {
+    MyContainer<int> c;
+    for (std::size_t i = 0; i < n; ++i) {
+        c.addElement(static_cast<int>(i * 2654435761u % 1000000007u));
+    }
+    auto ms = [](Clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1000.0;
+    };
+    MyContainer<int> fresh = c; // no sorted index yet
+    auto start = Clock::now();
+    long long sum = fresh.median();
+    auto select = Clock::now() - start;
+    start = Clock::now();
+    auto it = c.begin_ascending_order();
+    for (std::size_t k = 0; k < (n - 1) / 2; ++k) {
+        ++it;
+    }
+    sum += *it;
+    auto walk = Clock::now() - start;
+    start = Clock::now();
+    sum += c.median() + c.percentile(99) + c.min() + c.max();
+    auto lookup = Clock::now() - start;
+    volatile long long keep = sum; // keeps the queries from being optimized away
+    (void)keep;
+    std::cout << std::left << std::setw(28) << "median"
+              << " sort+walk " << ms(walk) << "ms"
+              << "  nth_element " << ms(select) << "ms"
+              << "  indexed (median, p99, min, max) "
+              << std::chrono::duration_cast<std::chrono::nanoseconds>(lookup).count() << "ns" << std::endl;
+}
+
+/**
+ * @brief First k elements of the descending order of a fresh container: the
+ *        full-sort iterator, the partial sort iterator and top_k().
+ */
+static void benchTopK(std::size_t n) {
+    MyContainer<int> c;
+    for (std::size_t i = 0; i < n; ++i) {
+        c.addElement(static_cast<int>(i * 2654435761u % 1000000007u));
+    }
+    auto ms = [](Clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1000.0;
+    };
+    long long sum = 0;
+    for (std::size_t k : {std::size_t(10), std::size_t(1000)}) {
+        MyContainer<int> sorting = c, partial = c; // no sorted index yet
+        auto start = Clock::now();
+        auto it = sorting.begin_descending_order();
+        for (std::size_t i = 0; i < k; ++i, ++it) {
+            sum += *it;
+        }
+        auto full = Clock::now() - start;
+        start = Clock::now();
+        auto lazy = partial.begin_partial_descending_order();
+        for (std::size_t i = 0; i < k; ++i, ++lazy) {
+            sum += *lazy;
+        }
+        auto part = Clock::now() - start;
+        start = Clock::now();
+        for (int v : c.top_k(k)) {
+            sum += v;
+        }
+        auto heap = Clock::now() - start;
+        std::cout << std::left << std::setw(28) << ("first " + std::to_string(k) + " descending")
+                  << " full sort " << ms(full) << "ms"
+                  << "  partial iterator " << ms(part) << "ms"
+                  << "  top_k " << ms(heap) << "ms" << std::endl;
+    }
+    volatile long long keep = sum; // keeps the reads from being optimized away
+    (void)keep;
+}
+
+/**
+ * @brief Value histogram of a container with many duplicates: a std::map built
+ *        from the ascending order vs the histogram view of the sorted index.
+ */
+static void benchHistogram(std::size_t n) {
+    MyContainer<int> c;
+    for (std::size_t i = 0; i < n; ++i) {
+        c.addElement(static_cast<int>(i * 2654435761u % 1000u)); // 1000 distinct values
+    }
+    auto ms = [](Clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1000.0;
+    };
+    std::size_t sum = *c.begin_ascending_order(); // sorted index built up front for both
+    auto start = Clock::now();
+    std::map<int, std::size_t> counts;
+    for (auto it = c.begin_ascending_order(); it != c.end_ascending_order(); ++it) {
+        ++counts[*it];
+    }
+    auto mapped = Clock::now() - start;
+    sum += counts.size();
+    start = Clock::now();
+    for (const auto& bucket : c.histogram()) {
+        sum += bucket.second;
+    }
+    auto view = Clock::now() - start;
+    volatile std::size_t keep = sum; // keeps the reads from being optimized away
+    (void)keep;
+    std::cout << std::left << std::setw(28) << "1000 distinct values"
+              << " std::map " << ms(mapped) << "ms"
+              << "  histogram() " << ms(view) << "ms" << std::endl;
+}
+
+/**
+ * @brief Intersection of two containers: dumping both through
+ *        begin_ascending_order() into vectors for std::set_intersection,
+ *        versus set_intersection() and the lazy set_operation() view on the
+ *        sorted indexes. Same sizes, then a small container against a large one.
+ */
+static void benchSetOperations(std::size_t n) {
+    auto ms = [](Clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1000.0;
+    };
+    auto fill = [](MyContainer<int>& c, std::size_t count, unsigned salt) {
+        for (std::size_t i = 0; i < count; ++i) {
+            c.addElement(static_cast<int>((i * 2654435761u + salt) % (2 * count + 1)));
+        }
+        (void)*c.begin_ascending_order(); // sorted index built up front for all three
+    };
+    auto run = [&ms](const std::string& label, const MyContainer<int>& l, const MyContainer<int>& r) {
+        std::size_t sum = 0;
+        auto start = Clock::now();
+        std::vector<int> lv, rv, out;
+        for (auto it = l.begin_ascending_order(); it != l.end_ascending_order(); ++it) {
+            lv.push_back(*it);
+        }
+        for (auto it = r.begin_ascending_order(); it != r.end_ascending_order(); ++it) {
+            rv.push_back(*it);
+        }
+        std::set_intersection(lv.begin(), lv.end(), rv.begin(), rv.end(), std::back_inserter(out));
+        auto dumped = Clock::now() - start;
+        sum += out.size();
+        start = Clock::now();
+        sum += l.set_intersection(r).size();
+        auto eager = Clock::now() - start;
+        start = Clock::now();
+        for (int value : l.set_operation(SetOperation::Intersection, r)) {
+            sum += static_cast<std::size_t>(value) & 1;
+        }
+        auto lazy = Clock::now() - start;
+        volatile std::size_t keep = sum; // keeps the reads from being optimized away
+        (void)keep;
+        std::cout << std::left << std::setw(28) << label
+                  << " dump+std " << ms(dumped) << "ms"
+                  << "  set_intersection() " << ms(eager) << "ms"
+                  << "  lazy view " << ms(lazy) << "ms" << std::endl;
+    };
+    MyContainer<int> a, b, small;
+    fill(a, n, 0);
+    fill(b, n, 12345);
+    fill(small, n / 1000, 777);
+    run("n with n", a, b);
+    run("n/1000 with n", small, a);
+}
+
+/// Join benchmark rows: ordered by their key first
+struct OrderRow {
+    int customer;
+    int amount;
+    bool operator<(const OrderRow& other) const {
+        return customer < other.customer || (customer == other.customer && amount < other.amount);
+    }
+};
+
+struct CustomerRow {
+    int id;
+    int region;
+    bool operator<(const CustomerRow& other) const { return id < other.id; }
+};
+
+/**
+ * @brief Join n orders with n / 10 customers on the customer id: a hash join
+ *        hand-rolled over begin_ascending_order(), versus join() on the two
+ *        sorted indexes.
+ */
+static void benchJoin(std::size_t n) {
+    auto ms = [](Clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1000.0;
+    };
+    MyContainer<OrderRow> orders;
+    MyContainer<CustomerRow> customers;
+    int ids = static_cast<int>(n / 10 + 1);
+    for (std::size_t i = 0; i < n; ++i) {
+        orders.addElement({static_cast<int>(i * 2654435761u % static_cast<unsigned>(2 * ids)), static_cast<int>(i)});
+    }
+    for (int id = 0; id < ids; ++id) {
+        customers.addElement({(id * 7919) % ids, id % 8});
+    }
+    (void)*orders.begin_ascending_order(); // sorted indexes built up front for both
+    (void)*customers.begin_ascending_order();
+    long long sum = 0;
+    auto start = Clock::now();
+    std::unordered_multimap<int, CustomerRow> table;
+    for (auto it = customers.begin_ascending_order(); it != customers.end_ascending_order(); ++it) {
+        table.emplace((*it).id, *it);
+    }
+    for (auto it = orders.begin_ascending_order(); it != orders.end_ascending_order(); ++it) {
+        auto range = table.equal_range((*it).customer);
+        for (auto match = range.first; match != range.second; ++match) {
+            sum += (*it).amount + match->second.region;
+        }
+    }
+    auto hashed = Clock::now() - start;
+    start = Clock::now();
+    for (const auto& match : orders.join(customers, &OrderRow::customer, &CustomerRow::id)) {
+        sum -= match.first.amount + match.second.region;
+    }
+    auto merged = Clock::now() - start;
+    volatile long long keep = sum; // 0 when both found the same pairs
+    (void)keep;
+    std::cout << std::left << std::setw(28) << "orders x customers"
+              << " hash join " << ms(hashed) << "ms"
+              << "  join() " << ms(merged) << "ms"
+              << (sum == 0 ? "" : "  (results differ)") << std::endl;
+}
+
+/**
+ * @brief Duplicate-heavy data (1000 distinct values): fill, ascending walk and
+ *        remove of one value, with the RSS growth after each phase.
+ */
+template<typename Container>
+static void benchCounted(const std::string& label, std::size_t n) {
+    MemoryStats before = MemoryStats::now();
+    auto start = Clock::now();
+    long long sum = 0;
+    {
+        Container c;
+        for (std::size_t i = 0; i < n; ++i) {
+            c.addElement(static_cast<int>(i * 2654435761u % 1000u));
+        }
+        auto filled = Clock::now();
+        MemoryStats afterFill = MemoryStats::now();
+        auto end = c.end_ascending_order();
+        for (auto it = c.begin_ascending_order(); it != end; ++it) {
+            sum += *it;
+        }
+        auto walked = Clock::now();
+        MemoryStats afterWalk = MemoryStats::now();
+        c.remove(500);
+        auto removed = Clock::now();
+        auto ms = [](Clock::duration d) {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+        };
+        std::cout << std::left << std::setw(28) << label
+                  << " fill=" << ms(filled - start) << "ms"
+                  << " +rss=" << (afterFill.rss_kb - before.rss_kb) / 1024 << "MB"
+                  << " | ascending=" << ms(walked - filled) << "ms"
+                  << " +rss=" << (afterWalk.rss_kb - before.rss_kb) / 1024 << "MB"
+                  << " | remove=" << ms(removed - walked) << "ms" << std::endl;
+    }
+    volatile long long keep = sum; // keeps the walk from being optimized away
+    (void)keep;
+}
+
+int main(int argc, char* argv[]) {
+    // Number of elements per benchmark (can be overridden from the command line)
+    std::size_t n = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+
+    std::cout << "== addElement tail latency (" << n << " ints) ==" << std::endl;
+    benchAddElementLatency<MyContainer<int>>("vector storage", n);
+    benchAddElementLatency<SegmentedContainer<int>>("segmented storage", n);
+    benchAddElementLatency<MmapContainer<int>>("mmap storage", n);
+
+    std::cout << "== memory: page faults (minor/major) and RSS ==" << std::endl;
+    benchMemory<MyContainer<int>>("vector storage", n);
+    benchMemory<MmapContainer<int>>("mmap storage", n);
+
+    std::cout << "== serialization round trip (" << n << " ints) ==" << std::endl;
+    benchSerialization(n);
+
+    std::cout << "== concurrent snapshot reads (" << n / 100 << " ints) ==" << std::endl;
+    benchConcurrent(n / 100);
+
+    std::cout << "== concurrent single-value ingest (" << n << " ints) ==" << std::endl;
+    benchConcurrentIngest(n);
+
+    std::cout << "== multi-producer append (" << n << " ints) ==" << std::endl;
+    benchProducers(n);
+
+    std::cout << "== sharded ingest and merged scan (" << n << " ints) ==" << std::endl;
+    benchSharded(n);
+
+    std::cout << "== global ascending scan over many containers (" << n << " ints) ==" << std::endl;
+    benchMerge(n);
+
+    std::cout << "== parallel traversal (" << n << " ints) ==" << std::endl;
+    benchParallel(n);
+
+    std::cout << "== remove compaction (" << n << " ints) ==" << std::endl;
+    benchRemove(n);
+
+    std::cout << "== shared pool: fork-join overhead and parallel sort ==" << std::endl;
+    benchForkJoin(n);
+
+    std::cout << "== incremental sorted index: append, remove, scan (" << n << " ints) ==" << std::endl;
+    benchIncrementalScan(n);
+
+    std::cout << "== interleaved insert and sorted read (" << n << " ints) ==" << std::endl;
+    benchTreeIndex(n);
+
+    std::cout << "== range seek (" << n << " ints) ==" << std::endl;
+    benchRangeSeek(n);
+
+    std::cout << "== point lookups (" << n << " ints) ==" << std::endl;
+    benchSearchLayout(n);
+
+    std::cout << "== order statistics (" << n << " ints) ==" << std::endl;
+    benchMedian(n);
+
+    std::cout << "== top-k without a sorted index (" << n << " ints) ==" << std::endl;
+    benchTopK(n);
+
+    std::cout << "== histogram (" << n << " ints) ==" << std::endl;
+    benchHistogram(n);
+
+    std::cout << "== intersection of two containers (" << n << " ints each) ==" << std::endl;
+    benchSetOperations(n);
+
+    std::cout << "== sort-merge join (" << n << " orders, " << n / 10 << " customers) ==" << std::endl;
+    benchJoin(n);
+
+    std::cout << "== 1000 distinct values: plain vs counted storage (" << n << " ints) ==" << std::endl;
+    benchCounted<CountedContainer<int>>("counted storage", n);
+    benchCounted<MyContainer<int>>("vector storage", n);
+
+    std::cout << "== sorted query after append bursts (" << n / 10 << " ints) ==" << std::endl;
+    benchBackgroundSort(n / 10);
+
+    return 0;
+}
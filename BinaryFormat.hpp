@@ -0,0 +1,211 @@
+//dor.cohen15@msmail.ariel.ac.il
+
+#pragma once
+
+#include <sys/mman.h>  // for mmap
+#include <sys/stat.h>  // for fstat
+#include <fcntl.h>     // for open
+#include <unistd.h>    // for close
+#include <cstddef>     // for std::size_t
+#include <cstdint>     // for fixed-width header fields
+#include <cstring>     // for std::memcmp
+#include <stdexcept>   // for std::runtime_error
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+
+namespace ariel {
+
+/**
+ * @brief Header at the start of a container file (see MyContainer::saveFile).
+ *
+ * File layout (native byte order):
+ *
+ *     [FileHeader, 64 bytes][count elements][padding][count x uint64_t permutation]
+ *
+ * The elements start at data_offset, which keeps them aligned for mmap. The
+ * optional permutation lists element indices in ascending order of value, so a
+ * loaded container can serve the sorted iterators without sorting.
+ *
+ * MyContainer::save writes the same header followed by the elements only. Types
+ * that are not trivially copyable (std::string) are written LENGTH_PREFIXED:
+ * each element is a uint64_t byte count followed by its bytes, and element_size
+ * is 0. Such files can be loaded but not mapped.
+ */
+struct FileHeader {
+    /// Always "MYCT"
+    char magic[4];
+    /// Format version, FileHeader::VERSION when written by this code
+    std::uint32_t version;
+    /// sizeof(T) of the writer, checked on load
+    std::uint32_t element_size;
+    /// Bit set of FileHeader::HAS_PERMUTATION
+    std::uint32_t flags;
+    /// Number of elements
+    std::uint64_t count;
+    /// Offset of the first element from the start of the file
+    std::uint64_t data_offset;
+    /// Offset of the sorted permutation (0 when absent)
+    std::uint64_t permutation_offset;
+    /// Reserved for future versions, written as zero
+    std::uint64_t reserved[3];
+
+    static constexpr std::uint32_t VERSION = 1;
+    static constexpr std::uint32_t HAS_PERMUTATION = 1u << 0;
+    static constexpr std::uint32_t LENGTH_PREFIXED = 1u << 1;
+
+    /**
+     * @brief Build a header for count elements of element_size bytes.
+     */
+    static FileHeader make(std::uint32_t element_size, std::uint64_t count, bool with_permutation) {
+        FileHeader h{};
+        std::memcpy(h.magic, "MYCT", 4);
+        h.version = VERSION;
+        h.element_size = element_size;
+        h.count = count;
+        h.data_offset = sizeof(FileHeader);
+        if (with_permutation) {
+            h.flags |= HAS_PERMUTATION;
+            h.permutation_offset = alignTo8(h.data_offset + count * element_size);
+        }
+        return h;
+    }
+
+    /**
+     * @brief Check magic, version and element encoding against the reader.
+     *
+     * @param expected_element_size  sizeof(T), or 0 for length-prefixed elements.
+     * @throws std::runtime_error on any mismatch.
+     */
+    void checkFormat(std::uint32_t expected_element_size) const {
+        if (std::memcmp(magic, "MYCT", 4) != 0) {
+            throw std::runtime_error("Not a container file");
+        }
+        if (version != VERSION) {
+            throw std::runtime_error("Unsupported container file version");
+        }
+        if (element_size != expected_element_size ||
+            ((flags & LENGTH_PREFIXED) != 0) != (expected_element_size == 0)) {
+            throw std::runtime_error("Container file element size mismatch");
+        }
+    }
+
+    /**
+     * @brief Check the header against the reader and the size of the file.
+     *
+     * @throws std::runtime_error if the file is not a valid container file for
+     *         elements of element_size bytes.
+     */
+    void validate(std::uint32_t expected_element_size, std::size_t file_size) const {
+        checkFormat(expected_element_size);
+        if (data_offset < sizeof(FileHeader) || data_offset > file_size ||
+            count > (file_size - data_offset) / element_size) {
+            throw std::runtime_error("Container file is truncated");
+        }
+        if ((flags & HAS_PERMUTATION) &&
+            (permutation_offset % 8 != 0 || permutation_offset > file_size ||
+             count > (file_size - permutation_offset) / 8)) {
+            throw std::runtime_error("Container file is truncated");
+        }
+    }
+
+    static std::uint64_t alignTo8(std::uint64_t offset) {
+        return (offset + 7) / 8 * 8;
+    }
+};
+
+static_assert(sizeof(FileHeader) == 64, "FileHeader must stay 64 bytes");
+
+/// Byte sink writing to an std::ostream.
+struct StreamSink {
+    std::ostream& os;
+
+    void write(const void* p, std::size_t n) {
+        os.write(static_cast<const char*>(p), static_cast<std::streamsize>(n));
+    }
+};
+
+/// Byte sink appending to a memory buffer.
+struct BufferSink {
+    std::vector<char>& buffer;
+
+    void write(const void* p, std::size_t n) {
+        const char* bytes = static_cast<const char*>(p);
+        buffer.insert(buffer.end(), bytes, bytes + n);
+    }
+};
+
+/// Byte source reading from an std::istream.
+struct StreamSource {
+    /// The bytes left are unknown: readers grow their output as data arrives
+    static constexpr bool KNOWN_SIZE = false;
+
+    std::istream& is;
+
+    /// Nothing to check up front; read() reports a short stream.
+    void require(std::uint64_t, std::size_t) const noexcept {}
+
+    /// @throws std::runtime_error if the stream ends before n bytes.
+    void read(void* p, std::size_t n) {
+        is.read(static_cast<char*>(p), static_cast<std::streamsize>(n));
+        if (static_cast<std::size_t>(is.gcount()) != n) {
+            throw std::runtime_error("Container data is truncated");
+        }
+    }
+};
+
+/// Byte source reading from a memory buffer.
+struct BufferSource {
+    /// The bytes left are known: count fields are checked before allocating
+    static constexpr bool KNOWN_SIZE = true;
+
+    const char* pos;
+    std::size_t remaining;
+
+    /// @throws std::runtime_error if fewer than count items of size bytes are left.
+    void require(std::uint64_t count, std::size_t size) const {
+        if (size != 0 && count > remaining / size) {
+            throw std::runtime_error("Container data is truncated");
+        }
+    }
+
+    /// @throws std::runtime_error if the buffer ends before n bytes.
+    void read(void* p, std::size_t n) {
+        if (n > remaining) {
+            throw std::runtime_error("Container data is truncated");
+        }
+        std::memcpy(p, pos, n);
+        pos += n;
+        remaining -= n;
+    }
+};
+
+/**
+ * @brief Map a whole file privately (copy-on-write) into memory.
+ *
+ * @param path    File to map.
+ * @param length  Receives the length of the file / mapping in bytes.
+ * @return void*  Start of the mapping; the caller owns it and must munmap it.
+ * @throws std::runtime_error if the file cannot be opened or mapped.
+ */
+inline void* mapWholeFile(const std::string& path, std::size_t& length) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(FileHeader)) {
+        ::close(fd);
+        throw std::runtime_error("Not a container file: " + path);
+    }
+    length = static_cast<std::size_t>(st.st_size);
+    void* base = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file alive
+    if (base == MAP_FAILED) {
+        throw std::runtime_error("Cannot map file: " + path);
+    }
+    return base;
+}
+
+} // namespace ariel
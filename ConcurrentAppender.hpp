@@ -0,0 +1,301 @@
+//dor.cohen15@msmail.ariel.ac.il
+
+#pragma once
+
+#include <atomic>      // for std::atomic
+#include <algorithm>   // for std::min, std::fill
+#include <cstddef>     // for std::size_t
+#include <iterator>    // for std::distance
+#include <memory>      // for std::unique_ptr
+#include <vector>
+
+#include "MyContainer.hpp"
+
+namespace ariel {
+
+/**
+ * @brief Lock-free multi-producer append buffer that drains into a MyContainer.
+ *
+ * Producers reserve slots with a single atomic fetch-add and write their values
+ * into segments that are never moved, so any number of threads append without
+ * a lock and without waiting for each other. Segment k holds
+ * FirstSegment * 2^k elements; a missing segment is allocated by whichever
+ * producer needs it first (the others adopt it through a compare-and-swap).
+ *
+ * For the highest throughput each thread appends through a Producer, which
+ * batches values locally and reserves a whole batch with one fetch-add.
+ *
+ * Values of one thread keep their order; values of different threads are
+ * interleaved in reservation order. drainInto() moves everything into a
+ * MyContainer and must only be called while no producer is appending (e.g.
+ * after joining the producer threads).
+ *
+ * Every slot has a written flag, set once its value is stored. If storing an
+ * append fails after its slots were reserved (its segment cannot be
+ * allocated, or copying a value throws), the append throws but its slots are
+ * still committed with the flag clear: later appends are not held up, and
+ * drains skip the abandoned slots.
+ *
+ * @tparam T             Element type (default constructible and copy assignable).
+ * @tparam FirstSegment  Number of elements in the first segment.
+ */
+template<typename T, std::size_t FirstSegment = 4096>
+class ConcurrentAppender {
+    static_assert(FirstSegment > 0, "FirstSegment must be positive");
+
+private:
+    /// Enough segments to address every size_t index
+    static constexpr std::size_t SEGMENTS = 64;
+
+    /// Values of a segment, and whether each slot holds an appended value
+    struct Segment {
+        std::unique_ptr<T[]> values;
+        std::unique_ptr<bool[]> written;
+
+        explicit Segment(std::size_t length) : values(new T[length]), written(new bool[length]()) {}
+    };
+
+    /// Segment directory; a null entry is not allocated yet
+    std::atomic<Segment*> segments[SEGMENTS];
+    /// Number of slots handed out to producers
+    std::atomic<std::size_t> reserved;
+    /// Number of slots finished by their producer, written or abandoned
+    std::atomic<std::size_t> committed;
+    /// Number of committed slots that were abandoned
+    std::atomic<std::size_t> abandoned;
+
+    /// Index of the segment holding slot i
+    static std::size_t segmentOf(std::size_t i) {
+        std::size_t q = i / FirstSegment + 1;
+        std::size_t k = 0;
+        while (q >>= 1) {
+            ++k;
+        }
+        return k;
+    }
+
+    /// First slot of segment k
+    static std::size_t segmentStart(std::size_t k) {
+        return FirstSegment * ((std::size_t(1) << k) - 1);
+    }
+
+    /// Number of slots in segment k
+    static std::size_t segmentLength(std::size_t k) {
+        return FirstSegment << k;
+    }
+
+    /**
+     * @brief Segment k, allocating it if no producer did yet.
+     */
+    Segment* segment(std::size_t k) {
+        Segment* p = segments[k].load(std::memory_order_acquire);
+        if (p == nullptr) {
+            Segment* fresh = new Segment(segmentLength(k));
+            if (segments[k].compare_exchange_strong(p, fresh, std::memory_order_acq_rel)) {
+                p = fresh;
+            } else {
+                delete fresh; // another producer won, p now holds its segment
+            }
+        }
+        return p;
+    }
+
+    /**
+     * @brief Write [first, first + n) into the slots starting at index and
+     *        commit them.
+     *
+     * If a segment cannot be allocated or a value cannot be copied, the
+     * slots already written are cleared again and all n slots are committed
+     * as abandoned before the exception is rethrown.
+     */
+    template<typename InputIt>
+    void write(std::size_t index, InputIt first, std::size_t n) {
+        std::size_t done = 0;
+        try {
+            while (done < n) {
+                std::size_t k = segmentOf(index + done);
+                std::size_t offset = index + done - segmentStart(k);
+                std::size_t step = std::min(n - done, segmentLength(k) - offset);
+                Segment* p = segment(k);
+                for (std::size_t i = 0; i < step; ++i, ++first) {
+                    p->values[offset + i] = *first;
+                }
+                std::fill(p->written.get() + offset, p->written.get() + offset + step, true);
+                done += step;
+            }
+        } catch (...) {
+            for (std::size_t i = 0; i < done; ++i) { // flags are set per finished piece
+                std::size_t k = segmentOf(index + i);
+                segments[k].load(std::memory_order_relaxed)->written[index + i - segmentStart(k)] = false;
+            }
+            abandoned.fetch_add(n, std::memory_order_relaxed);
+            committed.fetch_add(n, std::memory_order_release);
+            throw;
+        }
+        committed.fetch_add(n, std::memory_order_release);
+    }
+
+public:
+    /**
+     * @brief Per-thread handle that batches values and appends them with one
+     *        slot reservation per batch.
+     *
+     * A Producer must only be used by one thread. Its remaining values are
+     * appended by flush() or by its destructor.
+     */
+    class Producer {
+    private:
+        ConcurrentAppender& owner;
+        std::vector<T> buffer;
+        std::size_t batch;
+
+    public:
+        /**
+         * @param appender  Buffer to append to.
+         * @param batch_size  Number of values collected before each reservation.
+         */
+        explicit Producer(ConcurrentAppender& appender, std::size_t batch_size = 1024)
+            : owner(appender), buffer(), batch(batch_size == 0 ? 1 : batch_size) {
+            buffer.reserve(batch);
+        }
+
+        Producer(const Producer&) = delete;
+        Producer& operator=(const Producer&) = delete;
+
+        ~Producer() {
+            flush();
+        }
+
+        /**
+         * @brief Queue value; appends the batch once it is full.
+         */
+        void add(const T& value) {
+            buffer.push_back(value);
+            if (buffer.size() == batch) {
+                flush();
+            }
+        }
+
+        /**
+         * @brief Append every queued value now.
+         */
+        void flush() {
+            if (!buffer.empty()) {
+                owner.append(buffer.begin(), buffer.end());
+                buffer.clear();
+            }
+        }
+    };
+
+    ConcurrentAppender() : reserved(0), committed(0), abandoned(0) {
+        for (std::atomic<Segment*>& s : segments) {
+            s.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    ConcurrentAppender(const ConcurrentAppender&) = delete;
+    ConcurrentAppender& operator=(const ConcurrentAppender&) = delete;
+
+    ~ConcurrentAppender() {
+        for (std::atomic<Segment*>& s : segments) {
+            delete s.load(std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Append one value. Lock-free; safe to call from any thread.
+     *
+     * @throws Rethrows a failed segment allocation or copy; nothing is appended.
+     */
+    void append(const T& value) {
+        std::size_t index = reserved.fetch_add(1, std::memory_order_relaxed);
+        std::size_t k = segmentOf(index);
+        std::size_t offset = index - segmentStart(k);
+        try {
+            Segment* p = segment(k);
+            p->values[offset] = value;
+            p->written[offset] = true;
+        } catch (...) {
+            abandoned.fetch_add(1, std::memory_order_relaxed);
+            committed.fetch_add(1, std::memory_order_release);
+            throw;
+        }
+        committed.fetch_add(1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Append [first, last) as one contiguous run with a single slot
+     *        reservation. Lock-free; safe to call from any thread.
+     *
+     * @throws Rethrows a failed segment allocation or copy; nothing of the
+     *         run is appended.
+     */
+    template<typename ForwardIt>
+    void append(ForwardIt first, ForwardIt last) {
+        std::size_t n = static_cast<std::size_t>(std::distance(first, last));
+        if (n == 0) {
+            return;
+        }
+        std::size_t index = reserved.fetch_add(n, std::memory_order_relaxed);
+        write(index, first, n);
+    }
+
+    /**
+     * @brief Number of values written so far (may lag behind running producers).
+     */
+    std::size_t size() const {
+        return committed.load(std::memory_order_acquire) - abandoned.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Append every buffered value to c, in slot order, and empty the
+     *        buffer. The segments are kept for reuse.
+     *
+     * c is reserved once for all the values, and every run of written slots
+     * is appended with one MyContainer::addElements call; abandoned slots are
+     * skipped. Must not run concurrently with append() or a Producer flush.
+     *
+     * @return std::size_t  Number of values moved into c.
+     * @throws Rethrows if c cannot store a run of values; c then keeps the
+     *         runs before it, and the buffer is left as it was.
+     */
+    template<typename Storage>
+    std::size_t drainInto(MyContainer<T, Storage>& c) {
+        std::size_t n = committed.load(std::memory_order_acquire);
+        std::size_t count = size();
+        c.reserve(c.size() + count);
+        for (std::size_t done = 0; done < n;) {
+            std::size_t k = segmentOf(done);
+            std::size_t step = std::min(n - done, segmentLength(k));
+            const Segment* p = segments[k].load(std::memory_order_relaxed);
+            for (std::size_t i = 0; p != nullptr && i < step;) {
+                if (!p->written[i]) { // abandoned slot
+                    ++i;
+                    continue;
+                }
+                std::size_t run = i + 1;
+                while (run < step && p->written[run]) {
+                    ++run;
+                }
+                c.addElements(p->values.get() + i, p->values.get() + run);
+                i = run;
+            }
+            done += step;
+        }
+        for (std::size_t done = 0; done < n;) {
+            std::size_t k = segmentOf(done);
+            Segment* p = segments[k].load(std::memory_order_relaxed);
+            std::size_t step = std::min(n - done, segmentLength(k));
+            if (p != nullptr) {
+                std::fill(p->written.get(), p->written.get() + step, false);
+            }
+            done += step;
+        }
+        reserved.store(0, std::memory_order_relaxed);
+        committed.store(0, std::memory_order_relaxed);
+        abandoned.store(0, std::memory_order_relaxed);
+        return count;
+    }
+};
+
+} // namespace ariel
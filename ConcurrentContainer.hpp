@@ -0,0 +1,269 @@
+//dor.cohen15@msmail.ariel.ac.il
+
+#pragma once
+
+#include <memory>      // for std::shared_ptr, std::atomic_load, std::atomic_store
+#include <mutex>       // for std::mutex, std::lock_guard, std::unique_lock
+#include <condition_variable>
+#include <vector>
+#include <cstddef>     // for std::size_t
+
+#include "MyContainer.hpp"
+#include "WorkStealingPool.hpp"
+
+namespace ariel {
+
+/**
+ * @brief Thread-safe MyContainer where readers work on immutable snapshots.
+ *
+ * The current version of the container is an immutable MyContainer held by a
+ * shared_ptr. Readers take a snapshot() - one atomic shared_ptr load - and then
+ * use the snapshot like any const MyContainer: all six iterators, print, size.
+ * Readers never wait for a writer, and a snapshot (with every iterator taken
+ * from it) stays valid and unchanged for as long as the reader holds it.
+ *
+ * Writers are serialized by a mutex. A publish copies the current version,
+ * applies the change to the private copy and publishes it with an atomic
+ * shared_ptr store (copy-on-write, RCU style); old versions are freed when the
+ * last reader drops them.
+ *
+ * A single addElement() does not publish: it appends the value to a small
+ * mutex-guarded log, in O(1), and queues one flush on defaultPool(). The
+ * flush folds the whole log into one new version; values appended while it
+ * copies wait for the next flush, so an ingest loop of single appends copies
+ * each version once per batch instead of once per value. Any other write
+ * folds the log in first, so writes are published in the order they were made.
+ * A single append is seen by readers once the flush ran; flush() waits for it.
+ *
+ * @tparam T        Element type.
+ * @tparam Storage  Storage policy of the snapshots.
+ */
+template<typename T = int, typename Storage = std::vector<T>>
+class ConcurrentContainer {
+public:
+    /// Immutable version of the container that readers iterate over
+    using Snapshot = std::shared_ptr<const MyContainer<T, Storage>>;
+
+private:
+    /// Latest published version (only accessed with atomic_load / atomic_store)
+    Snapshot current;
+    /// Serializes writers
+    std::mutex writer;
+    /// Guards the fields below; never held while copying a version
+    std::mutex log_lock;
+    /// Values appended by addElement() and not published yet, in order
+    std::vector<T> pending;
+    /// Threads that hold writer or are about to take it
+    std::size_t writing;
+    /// Whether a flush is queued or running
+    bool flush_queued;
+    /// Signaled when a flush finishes
+    std::condition_variable flushed;
+
+    /// Queue a flush of the log; the caller holds log_lock and the log is not empty.
+    void queueFlush() {
+        flush_queued = true;
+        try {
+            defaultPool().submit([this]() { runFlush(); });
+        } catch (...) {
+            // out of memory: the next write or flush() publishes the log
+            flush_queued = false;
+        }
+    }
+
+    /// Register the calling thread as a writer, before it takes writer.
+    void enterWriter() {
+        std::lock_guard<std::mutex> lock(log_lock);
+        ++writing;
+    }
+
+    /**
+     * @brief Unregister a writer after it released writer, and queue a flush
+     *        for the values logged meanwhile unless one is queued.
+     */
+    void leaveWriter() {
+        std::lock_guard<std::mutex> lock(log_lock);
+        --writing;
+        if (writing == 0 && !flush_queued && !pending.empty()) {
+            queueFlush();
+        }
+    }
+
+    /**
+     * @brief Body of a queued flush.
+     *
+     * A pool worker may run it while its thread is inside a writer (a writer
+     * waiting for a parallel step runs queued tasks), so it never waits for
+     * writer: while a writer is active it stands down, and that writer
+     * queues it again on leaving. Values logged while it copies get a new flush.
+     */
+    void runFlush() {
+        {
+            std::lock_guard<std::mutex> lock(log_lock);
+            if (writing != 0) {
+                flush_queued = false;
+                flushed.notify_all();
+                return;
+            }
+            ++writing;
+        }
+        bool failed = false;
+        {
+            std::lock_guard<std::mutex> lock(writer);
+            auto nothing = [](MyContainer<T, Storage>&) {};
+            try {
+                publishLocked(nothing);
+            } catch (...) {
+                // out of memory: the values stay logged for the next write or flush()
+                failed = true;
+            }
+        }
+        std::lock_guard<std::mutex> lock(log_lock);
+        --writing;
+        flush_queued = false;
+        if (!failed && writing == 0 && !pending.empty()) {
+            queueFlush(); // values appended while this flush copied
+        }
+        flushed.notify_all();
+    }
+
+    /// Take the logged values out of the log; the caller holds writer.
+    std::vector<T> takeLog() {
+        std::vector<T> taken;
+        std::lock_guard<std::mutex> lock(log_lock);
+        taken.swap(pending);
+        return taken;
+    }
+
+    /// Put taken values back at the front of the log after a failed publish.
+    void restoreLog(std::vector<T>& taken) {
+        std::lock_guard<std::mutex> lock(log_lock);
+        taken.insert(taken.end(), pending.begin(), pending.end());
+        pending.swap(taken);
+    }
+
+    /**
+     * @brief Copy the current version, append the logged values, let change
+     *        modify the copy and publish it; the caller holds writer.
+     *
+     * If change throws, nothing is published and the log is kept.
+     */
+    template<typename Change>
+    void publishLocked(Change& change) {
+        std::vector<T> taken = takeLog();
+        try {
+            auto next = std::make_shared<MyContainer<T, Storage>>(*std::atomic_load(&current));
+            for (const T& value : taken) {
+                next->addElement(value);
+            }
+            change(*next);
+            std::atomic_store(&current, Snapshot(std::move(next)));
+        } catch (...) {
+            restoreLog(taken);
+            throw;
+        }
+    }
+
+    template<typename Change>
+    void publish(Change change) {
+        enterWriter();
+        try {
+            std::lock_guard<std::mutex> lock(writer);
+            publishLocked(change);
+        } catch (...) {
+            leaveWriter();
+            throw;
+        }
+        leaveWriter();
+    }
+
+public:
+    ConcurrentContainer()
+        : current(std::make_shared<const MyContainer<T, Storage>>()), writer(), log_lock(), pending(),
+          writing(0), flush_queued(false), flushed() {}
+
+    ConcurrentContainer(const ConcurrentContainer&) = delete;
+    ConcurrentContainer& operator=(const ConcurrentContainer&) = delete;
+
+    /**
+     * @brief Wait for a queued flush, which still refers to this container.
+     */
+    ~ConcurrentContainer() {
+        std::unique_lock<std::mutex> lock(log_lock);
+        flushed.wait(lock, [this]() { return !flush_queued; });
+    }
+
+    /**
+     * @brief The latest published version. Never blocks on writers.
+     */
+    Snapshot snapshot() const {
+        return std::atomic_load(&current);
+    }
+
+    /**
+     * @brief Number of elements in the latest published version.
+     */
+    std::size_t size() const {
+        return snapshot()->size();
+    }
+
+    /**
+     * @brief Append value to the log and queue a flush unless one is queued.
+     *
+     * O(1); never waits for a writer. The value is published by the flush,
+     * or earlier by the next other write.
+     */
+    void addElement(const T& value) {
+        std::lock_guard<std::mutex> lock(log_lock);
+        pending.push_back(value);
+        if (!flush_queued && writing == 0) {
+            queueFlush();
+        }
+    }
+
+    /**
+     * @brief Publish the logged values now, so that snapshots taken after
+     *        the call see every addElement() that returned before it.
+     */
+    void flush() {
+        publish([](MyContainer<T, Storage>&) {});
+    }
+
+    /**
+     * @brief Publish one new version with the logged values and all of
+     *        [first, last) appended.
+     */
+    template<typename InputIt>
+    void addElements(InputIt first, InputIt last) {
+        publish([first, last](MyContainer<T, Storage>& c) {
+            for (InputIt it = first; it != last; ++it) {
+                c.addElement(*it);
+            }
+        });
+    }
+
+    /**
+     * @brief Publish a new version, with the logged values folded in, without
+     *        any occurrence of value.
+     *
+     * @throws std::runtime_error like MyContainer::remove (nothing is published,
+     *         the logged values stay logged).
+     */
+    void remove(const T& value) {
+        publish([&value](MyContainer<T, Storage>& c) { c.remove(value); });
+    }
+
+    /**
+     * @brief Apply any sequence of changes to a private copy (with the logged
+     *        values folded in) and publish it as one new version; readers see
+     *        all of the changes or none.
+     *
+     * @param change  Callable taking MyContainer<T, Storage>&.
+     */
+    template<typename Change>
+    void update(Change change) {
+        publish(change);
+    }
+};
+
+} // namespace ariel
@@ -0,0 +1,397 @@
+//dor.cohen15@msmail.ariel.ac.il
+
+#pragma once
+
+#include <vector>
+#include <memory>      // for std::shared_ptr, std::atomic_load
+#include <algorithm>   // for std::lower_bound, std::upper_bound
+#include <cstddef>     // for std::size_t, std::ptrdiff_t
+#include <cstdint>     // for std::uint16_t
+#include <iterator>    // for std::random_access_iterator_tag
+#include <limits>      // for std::numeric_limits
+#include <stdexcept>   // for std::runtime_error
+#include <type_traits> // for std::is_unsigned
+
+namespace ariel {
+
+/**
+ * @brief Immutable sorted multiset as distinct values with cumulative counts:
+ *        the sorted order of a CountedStorage, expanded only when read.
+ *
+ * Element ranks [ends[i - 1], ends[i]) are copies of values[i] (ends[-1] = 0).
+ */
+template<typename T>
+struct CountedRun {
+    /// Distinct values in ascending order
+    std::vector<T> values;
+    /// ends[i] = number of elements not greater than values[i]
+    std::vector<std::size_t> ends;
+
+    std::size_t size() const noexcept {
+        return ends.empty() ? 0 : ends.back();
+    }
+
+    /// Index in values of the element of the given rank (< size()). O(log d).
+    std::size_t slotOf(std::size_t rank) const {
+        return static_cast<std::size_t>(std::upper_bound(ends.begin(), ends.end(), rank) - ends.begin());
+    }
+
+    /// Rank of the first copy of values[slot]
+    std::size_t firstRank(std::size_t slot) const {
+        return slot == 0 ? 0 : ends[slot - 1];
+    }
+
+    /// Number of elements smaller than value. O(log d).
+    std::size_t lowerRank(const T& value) const {
+        return firstRank(static_cast<std::size_t>(
+            std::lower_bound(values.begin(), values.end(), value) - values.begin()));
+    }
+
+    /// Number of elements not greater than value. O(log d).
+    std::size_t upperRank(const T& value) const {
+        return firstRank(static_cast<std::size_t>(
+            std::upper_bound(values.begin(), values.end(), value) - values.begin()));
+    }
+
+    /**
+     * @brief The n elements in ascending order, expanded from the counts on
+     *        first use and shared by later calls on this run.
+     *
+     * O(n) memory: only for callers that need one contiguous sorted vector.
+     * A new run is built after every modification of the storage, so the
+     * expansion lives no longer than the version it was made from.
+     */
+    std::shared_ptr<const std::vector<T>> expanded() const {
+        std::shared_ptr<const std::vector<T>> current = std::atomic_load(&expansion);
+        if (current) {
+            return current;
+        }
+        auto built = std::make_shared<std::vector<T>>();
+        built->reserve(size());
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            built->insert(built->end(), ends[i] - firstRank(i), values[i]);
+        }
+        current = std::move(built);
+        std::atomic_store(&expansion, current);
+        return current;
+    }
+
+    /// Cache of expanded() (null: not built yet)
+    mutable std::shared_ptr<const std::vector<T>> expansion;
+};
+
+/**
+ * @brief Storage policy for duplicate-heavy data: each distinct value is
+ *        stored once, with its number of copies.
+ *
+ * The insertion order is kept as a log of small value ids (sizeof(Id) bytes
+ * per element instead of sizeof(T)), so memory is
+ * n * sizeof(Id) + O(d) for d distinct values. The sorted orders never need a
+ * sorted copy of the n elements: MyContainer reads countedRun(), built in
+ * O(d) after a modification, and expands the counts as it iterates.
+ *
+ * push_back finds the value's id in O(log d) (O(1) when it repeats the
+ * previous value); count() is O(log d). eraseIf calls its predicate once per
+ * distinct value and compacts the id log in one pass.
+ *
+ * The class exposes the read side of the std::vector interface that
+ * MyContainer uses (size, operator[], random-access const iterators) plus
+ * push_back, append, pop_back, reserve and eraseIf; elements cannot be
+ * modified in place.
+ *
+ * @tparam T   Element type (needs operator<; equal means neither is smaller).
+ * @tparam Id  Unsigned id type; at most its maximum + 1 distinct values.
+ */
+template<typename T, typename Id = std::uint16_t>
+class CountedStorage {
+    static_assert(std::is_unsigned<Id>::value, "Id must be an unsigned integer type");
+
+private:
+    /// Value of each id (slots with a zero count are free)
+    std::vector<T> values;
+    /// Number of copies of each id
+    std::vector<std::size_t> counts;
+    /// Live values in ascending order (searched contiguously), and their ids
+    std::vector<T> sorted_values;
+    std::vector<Id> sorted_ids;
+    /// Ids in insertion order
+    std::vector<Id> log;
+    /// Ids whose count dropped to zero, reused last-freed first (capacity
+    /// stays at least values.size(), so releasing never allocates)
+    std::vector<Id> free_ids;
+    /// Sorted view, built on demand (null: not built since the last change)
+    mutable std::shared_ptr<const CountedRun<T>> run;
+
+    /// Position in sorted_values of the first value not less than value
+    /// (the halving step is a conditional move, not a mispredicted branch)
+    std::size_t lowerSlot(const T& value) const {
+        std::size_t len = sorted_values.size();
+        if (len == 0) {
+            return 0;
+        }
+        const T* first = sorted_values.data();
+        while (len > 1) {
+            std::size_t half = len / 2;
+            first = (first[half] < value) ? first + half : first;
+            len -= half;
+        }
+        return static_cast<std::size_t>(first - sorted_values.data()) + (*first < value ? 1 : 0);
+    }
+
+    /// Id of value, or values.size() if it is not stored
+    std::size_t find(const T& value) const {
+        if (!log.empty()) { // runs of one value are common: try the last one first
+            Id last = log.back();
+            if (!(values[last] < value) && !(value < values[last])) {
+                return last;
+            }
+        }
+        std::size_t slot = lowerSlot(value);
+        if (slot != sorted_values.size() && !(value < sorted_values[slot])) {
+            return sorted_ids[slot];
+        }
+        return values.size();
+    }
+
+    /// Store a new distinct value (count 0) and return its id
+    Id addValue(const T& value) {
+        std::size_t id = values.size();
+        if (!free_ids.empty()) {
+            id = free_ids.back();
+        } else if (id > std::numeric_limits<Id>::max()) {
+            throw std::runtime_error("Too many distinct values for CountedStorage");
+        } else {
+            free_ids.reserve(id + 1);
+        }
+        std::size_t slot = lowerSlot(value);
+        sorted_values.insert(sorted_values.begin() + static_cast<std::ptrdiff_t>(slot), value);
+        try {
+            sorted_ids.insert(sorted_ids.begin() + static_cast<std::ptrdiff_t>(slot), static_cast<Id>(id));
+            try {
+                if (id == values.size()) {
+                    values.push_back(value);
+                    counts.push_back(0);
+                } else {
+                    values[id] = value;
+                    free_ids.pop_back();
+                }
+            } catch (...) {
+                sorted_ids.erase(sorted_ids.begin() + static_cast<std::ptrdiff_t>(slot));
+                throw;
+            }
+        } catch (...) {
+            sorted_values.erase(sorted_values.begin() + static_cast<std::ptrdiff_t>(slot));
+            values.resize(counts.size());
+            throw;
+        }
+        return static_cast<Id>(id);
+    }
+
+    /// Free the slot of an id whose count dropped to zero
+    void releaseId(Id id) {
+        std::size_t slot = lowerSlot(values[id]); // live values are distinct: this is id
+        sorted_values.erase(sorted_values.begin() + static_cast<std::ptrdiff_t>(slot));
+        sorted_ids.erase(sorted_ids.begin() + static_cast<std::ptrdiff_t>(slot));
+        free_ids.push_back(id);
+    }
+
+public:
+    /// Random-access iterator over the elements in insertion order (read only)
+    class const_iterator {
+    private:
+        const CountedStorage* owner;
+        std::size_t pos;
+
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type        = T;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const T*;
+        using reference         = const T&;
+
+        const_iterator(const CountedStorage* o = nullptr, std::size_t p = 0) : owner(o), pos(p) {}
+
+        reference operator*() const { return (*owner)[pos]; }
+        pointer operator->() const { return &(*owner)[pos]; }
+        reference operator[](difference_type n) const { return (*owner)[pos + n]; }
+
+        const_iterator& operator++() { ++pos; return *this; }
+        const_iterator operator++(int) { const_iterator copy = *this; ++pos; return copy; }
+        const_iterator& operator--() { --pos; return *this; }
+        const_iterator operator--(int) { const_iterator copy = *this; --pos; return copy; }
+
+        const_iterator& operator+=(difference_type n) { pos += n; return *this; }
+        const_iterator& operator-=(difference_type n) { pos -= n; return *this; }
+        const_iterator operator+(difference_type n) const { return const_iterator(owner, pos + n); }
+        const_iterator operator-(difference_type n) const { return const_iterator(owner, pos - n); }
+        friend const_iterator operator+(difference_type n, const const_iterator& it) { return it + n; }
+        difference_type operator-(const const_iterator& other) const {
+            return static_cast<difference_type>(pos) - static_cast<difference_type>(other.pos);
+        }
+
+        bool operator==(const const_iterator& other) const { return pos == other.pos; }
+        bool operator!=(const const_iterator& other) const { return pos != other.pos; }
+        bool operator<(const const_iterator& other) const { return pos < other.pos; }
+        bool operator>(const const_iterator& other) const { return pos > other.pos; }
+        bool operator<=(const const_iterator& other) const { return pos <= other.pos; }
+        bool operator>=(const const_iterator& other) const { return pos >= other.pos; }
+    };
+
+    using value_type = T;
+    using size_type  = std::size_t;
+    using iterator   = const_iterator;
+
+    CountedStorage() : values{}, counts{}, sorted_values{}, sorted_ids{}, log{}, free_ids{}, run{} {}
+
+    /// Copies build their own sorted view.
+    CountedStorage(const CountedStorage& other)
+        : values(other.values), counts(other.counts), sorted_values(other.sorted_values), sorted_ids(other.sorted_ids),
+          log(other.log), free_ids(other.free_ids), run{} {
+        free_ids.reserve(values.size());
+    }
+
+    CountedStorage(CountedStorage&& other) noexcept = default;
+
+    CountedStorage& operator=(const CountedStorage& other) {
+        if (this != &other) {
+            CountedStorage copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    CountedStorage& operator=(CountedStorage&& other) noexcept = default;
+
+    /**
+     * @brief Append an element: one more copy of its value. O(log d).
+     *
+     * @throws std::runtime_error if value is new and Id cannot number it.
+     */
+    void push_back(const T& value) {
+        if (log.size() == log.capacity()) { // the push below must not throw
+            log.reserve(log.capacity() * 2 + 16);
+        }
+        std::size_t id = find(value);
+        if (id == values.size()) {
+            id = addValue(value);
+        }
+        ++counts[id];
+        log.push_back(static_cast<Id>(id));
+        run.reset();
+    }
+
+    /**
+     * @brief Append copies elements equal to value at once. O(log d + copies).
+     *
+     * @throws std::runtime_error if value is new and Id cannot number it.
+     */
+    void append(const T& value, std::size_t copies) {
+        if (copies == 0) {
+            return;
+        }
+        log.reserve(log.size() + copies); // the insert below must not throw
+        std::size_t id = find(value);
+        if (id == values.size()) {
+            id = addValue(value);
+        }
+        counts[id] += copies;
+        log.insert(log.end(), copies, static_cast<Id>(id));
+        run.reset();
+    }
+
+    /// Remove the last element.
+    void pop_back() {
+        Id id = log.back();
+        log.pop_back();
+        if (--counts[id] == 0) {
+            releaseId(id);
+        }
+        run.reset();
+    }
+
+    /// Pre-allocate the id log for n elements.
+    void reserve(std::size_t n) {
+        log.reserve(n);
+    }
+
+    std::size_t size() const noexcept { return log.size(); }
+
+    bool empty() const noexcept { return log.empty(); }
+
+    /// Number of distinct values
+    std::size_t distinct() const noexcept { return sorted_ids.size(); }
+
+    /// The i-th element in insertion order
+    const T& operator[](std::size_t i) const { return values[log[i]]; }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, log.size()); }
+
+    /// Number of copies of value. O(log d).
+    std::size_t count(const T& value) const {
+        std::size_t id = find(value);
+        return id == values.size() ? 0 : counts[id];
+    }
+
+    /**
+     * @brief Remove every element whose value satisfies pred, keeping the
+     *        order of the others. pred is called once per distinct value.
+     *
+     * @return std::size_t  Number of elements removed.
+     */
+    template<typename Pred>
+    std::size_t eraseIf(Pred& pred) {
+        std::vector<char> gone(values.size(), 0);
+        std::size_t removed = 0;
+        for (Id id : sorted_ids) {
+            if (pred(static_cast<const T&>(values[id]))) {
+                gone[id] = 1;
+                removed += counts[id];
+            }
+        }
+        if (removed == 0) {
+            return 0;
+        }
+        std::size_t out = 0;
+        for (Id id : log) {
+            if (!gone[id]) {
+                log[out++] = id;
+            }
+        }
+        log.resize(out);
+        for (std::size_t id = 0; id < values.size(); ++id) {
+            if (gone[id]) {
+                releaseId(static_cast<Id>(id));
+                counts[id] = 0;
+            }
+        }
+        run.reset();
+        return removed;
+    }
+
+    /**
+     * @brief The elements in ascending order as distinct values and counts.
+     *
+     * Built in O(d) on first use after a modification and shared until the
+     * next one; concurrent const callers may both build it (both are equal).
+     */
+    std::shared_ptr<const CountedRun<T>> countedRun() const {
+        std::shared_ptr<const CountedRun<T>> current = std::atomic_load(&run);
+        if (current) {
+            return current;
+        }
+        auto built = std::make_shared<CountedRun<T>>();
+        built->values = sorted_values;
+        built->ends.reserve(sorted_ids.size());
+        std::size_t total = 0;
+        for (Id id : sorted_ids) {
+            total += counts[id];
+            built->ends.push_back(total);
+        }
+        current = std::move(built);
+        std::atomic_store(&run, current);
+        return current;
+    }
+};
+
+} // namespace ariel
@@ -3,7 +3,9 @@
 #pragma once
 
 #include "MyContainer.hpp"
+#include "SortedRuns.hpp"
 #include <vector>
+#include <memory>      // for std::allocator, std::shared_ptr
 #include <algorithm>   // for std::sort
 #include <cstddef>     // for std::size_t
 #include <stdexcept>   // for std::out_of_range
@@ -13,17 +15,28 @@ namespace ariel {
 /**
  * @brief Iterator that traverses a container’s elements in descending order.
  * 
- * DescendingOrderIterator takes a copy of the container’s data, sorts it in
- * Descending order, and then allows sequential access via iterator semantics.
+ * DescendingOrderIterator reads the container’s ascending sorted copy from the
+ * back, which yields Descending order, and allows sequential access via
+ * iterator semantics. The sorted copy is shared with the other sorted iterators
+ * and may come as a base run plus a small delta run (see SortedRuns).
+ * 
+ * @tparam Alloc  Allocator of the scratch copy (chosen by the container's storage).
  */
-template<typename T>
+template<typename T, typename Alloc = std::allocator<T>>
 class DescendingOrderIterator {
 private:
-    /// Sorted copy of all elements, in descending order
-    std::vector<T> sorted_data;
+    /// Shared sorted runs of all elements, in ascending order (read back to front)
+    SortedRuns<T, Alloc> sorted_data;
+    /// Position right after the current element in the merged runs
+    typename SortedRuns<T, Alloc>::Cursor pos;
     /// Current index within sorted_data (0-based)
     std::size_t index;
 
+    void seek() {
+        std::size_t n = sorted_data.size();
+        pos = sorted_data.split(index < n ? n - index : 0);
+    }
+
 public:
     /**
      * @brief Construct a new DescendingOrderIterator.
@@ -33,27 +46,67 @@ public:
      * @param all_data  Copy of the container’s data (will be moved into sorted_data).
      * @param idx       Starting index (default 0).
      */
-    DescendingOrderIterator(std::vector<T> all_data, std::size_t idx = 0)
-        : sorted_data(std::move(all_data)), index(idx)
+    DescendingOrderIterator(std::vector<T, Alloc> all_data, std::size_t idx = 0)
+        : sorted_data(), pos{0, 0}, index(idx)
+    {
+        // Sort the data upon construction (read back to front = descending)
+        std::sort(all_data.begin(), all_data.end());
+        sorted_data = SortedRuns<T, Alloc>(std::make_shared<const std::vector<T, Alloc>>(std::move(all_data)));
+        seek();
+    }
+
+    /**
+     * @brief Construct a new DescendingOrderIterator over already sorted data.
+     * 
+     * @param sorted  Shared copy of the elements, in ascending order.
+     * @param idx     Starting index (default 0).
+     */
+    DescendingOrderIterator(std::shared_ptr<const std::vector<T, Alloc>> sorted, std::size_t idx = 0)
+        : DescendingOrderIterator(SortedRuns<T, Alloc>(std::move(sorted)), idx) {}
+
+    /**
+     * @brief Construct a new DescendingOrderIterator over sorted runs merged on the fly.
+     * 
+     * @param runs  Shared sorted base and delta runs of the elements.
+     * @param idx   Starting index (default 0).
+     */
+    DescendingOrderIterator(SortedRuns<T, Alloc> runs, std::size_t idx = 0)
+        : sorted_data(std::move(runs)), pos{0, 0}, index(idx)
+    {
+        if (index == 0) {
+            pos = {sorted_data.baseSize(), sorted_data.delta().size()};
+        } else {
+            seek();
+        }
+    }
+
+    /**
+     * @brief Construct a new DescendingOrderIterator at a cursor of the runs,
+     *        e.g. one found by SortedRuns::upperBound.
+     * 
+     * @param runs  Shared sorted base and delta runs of the elements.
+     * @param at    Position right after the first element to yield.
+     */
+    DescendingOrderIterator(SortedRuns<T, Alloc> runs, typename SortedRuns<T, Alloc>::Cursor at)
+        : sorted_data(std::move(runs)), pos(at), index(0)
     {
-        // Sort the data in descending order upon construction
-        std::sort(sorted_data.begin(), sorted_data.end(),std::greater<T>());
+        index = sorted_data.size() - (at.base + at.delta);
     }
 
     /**
      * @brief Dereference operator.
      * 
-     * Returns a reference to the element at the current index in sorted_data.
+     * Returns a reference to the index-th largest element in sorted_data.
      * Throws std::out_of_range if index is beyond the last element.
      * 
-     * @return T&  Reference to sorted_data[index]
+     * @return T&  Reference to the index-th largest element
      * @throws std::out_of_range if index >= sorted_data.size()
      */
     const T& operator*() const {
         if (index >= sorted_data.size()) {
             throw std::out_of_range("Iterator is out of bounds");
         }
-        return sorted_data[index];
+        return sorted_data.previous(pos);
     }
 
     /**
@@ -69,6 +122,7 @@ public:
         if (index >= sorted_data.size()) {
             throw std::out_of_range("Cannot increment iterator: out of bounds");
         }
+        sorted_data.retreat(pos);
         ++index;
         return *this;
     }
@@ -0,0 +1,163 @@
+//dor.cohen15@msmail.ariel.ac.il
+
+#pragma once
+
+#include "SortedRuns.hpp"
+#include <memory>      // for std::allocator
+#include <cstddef>     // for std::size_t
+#include <stdexcept>   // for std::out_of_range
+#include <type_traits> // for std::conditional_t
+#include <utility>     // for std::pair, std::move
+
+namespace ariel {
+
+/**
+ * @brief Iterator over the distinct values of sorted runs in ascending order,
+ *        each value once, with the number of its copies.
+ *
+ * The copies of a value are adjacent in the merged runs. The iterator steps
+ * over a few of them one by one and seeks past the rest with
+ * SortedRuns::upperBound, so a value costs O(min(copies, log n)).
+ *
+ * @tparam T           Element type (needs operator<).
+ * @tparam Alloc       Allocator of the runs.
+ * @tparam WithCounts  false: yields each value (const T&);
+ *                     true: yields (value, count) pairs (a histogram).
+ */
+template<typename T, typename Alloc = std::allocator<T>, bool WithCounts = false>
+class DistinctIterator {
+public:
+    using Cursor = typename SortedRuns<T, Alloc>::Cursor;
+    using reference = std::conditional_t<WithCounts, std::pair<T, std::size_t>, const T&>;
+
+private:
+    /// Copies stepped over one by one before seeking
+    static constexpr std::size_t LINEAR_STEPS = 8;
+
+    SortedRuns<T, Alloc> runs;
+    /// First copy of the current value, and the position after its last copy
+    Cursor first;
+    Cursor last;
+
+    static std::size_t position(const Cursor& c) {
+        return c.base + c.delta;
+    }
+
+    /// Set last past the copies of the value at first
+    void findEnd() {
+        last = first;
+        if (position(first) >= runs.size()) {
+            return;
+        }
+        const T& value = runs.next(first);
+        for (std::size_t i = 0; i < LINEAR_STEPS; ++i) {
+            runs.advance(last);
+            if (position(last) == runs.size() || value < runs.next(last)) {
+                return;
+            }
+        }
+        last = runs.upperBound(value);
+    }
+
+public:
+    /**
+     * @brief Construct a new DistinctIterator at a cursor of the runs.
+     *
+     * @param sorted  Shared sorted runs of the elements.
+     * @param at      First copy of a value, or the end of the runs.
+     */
+    DistinctIterator(SortedRuns<T, Alloc> sorted, Cursor at)
+        : runs(std::move(sorted)), first(at), last(at)
+    {
+        findEnd();
+    }
+
+    /**
+     * @brief Number of copies of the current value.
+     *
+     * @throws std::out_of_range if the iterator is at the end.
+     */
+    std::size_t count() const {
+        if (position(first) >= runs.size()) {
+            throw std::out_of_range("Iterator is out of bounds");
+        }
+        return position(last) - position(first);
+    }
+
+    /**
+     * @brief The current value, or (value, count) for a histogram.
+     *
+     * @throws std::out_of_range if the iterator is at the end.
+     */
+    reference operator*() const {
+        std::size_t copies = count();
+        if constexpr (WithCounts) {
+            return {runs.next(first), copies};
+        } else {
+            (void)copies;
+            return runs.next(first);
+        }
+    }
+
+    /**
+     * @brief Prefix increment: move to the next larger value.
+     *
+     * @throws std::out_of_range if the iterator is at the end.
+     */
+    DistinctIterator& operator++() {
+        if (position(first) >= runs.size()) {
+            throw std::out_of_range("Cannot increment iterator: out of bounds");
+        }
+        first = last;
+        findEnd();
+        return *this;
+    }
+
+    DistinctIterator operator++(int) {
+        DistinctIterator copy = *this;
+        ++(*this);
+        return copy;
+    }
+
+    /// Iterators over the same runs are equal when they are at the same value.
+    bool operator==(const DistinctIterator& other) const {
+        return position(first) == position(other.first);
+    }
+
+    bool operator!=(const DistinctIterator& other) const {
+        return !(*this == other);
+    }
+};
+
+/**
+ * @brief Range of the distinct values of a container in ascending order
+ *        (see MyContainer::distinct_ascending and MyContainer::histogram).
+ *
+ * The view holds the shared sorted runs it was made from: it stays valid,
+ * and unchanged, when the container is modified or destroyed.
+ */
+template<typename T, typename Alloc = std::allocator<T>, bool WithCounts = false>
+class DistinctView {
+public:
+    using iterator = DistinctIterator<T, Alloc, WithCounts>;
+
+private:
+    SortedRuns<T, Alloc> runs;
+
+public:
+    explicit DistinctView(SortedRuns<T, Alloc> sorted) : runs(std::move(sorted)) {}
+
+    iterator begin() const {
+        return iterator(runs, typename iterator::Cursor{0, 0});
+    }
+
+    iterator end() const {
+        return iterator(runs, typename iterator::Cursor{runs.baseSize(), runs.delta().size()});
+    }
+};
+
+/// Sorted (value, count) pairs of a container
+template<typename T, typename Alloc = std::allocator<T>>
+using HistogramView = DistinctView<T, Alloc, true>;
+
+} // namespace ariel
@@ -0,0 +1,139 @@
+//dor.cohen15@msmail.ariel.ac.il
+
+#pragma once
+
+#include <vector>
+#include <memory>      // for std::allocator
+#include <algorithm>   // for std::min
+#include <cstddef>     // for std::size_t
+
+namespace ariel {
+
+/**
+ * @brief Search accelerator for a sorted array: the same elements in
+ *        Eytzinger (breadth-first) order.
+ *
+ * Node k (1-based) has its children at 2k and 2k + 1, so the first levels of
+ * every search share a few hot cache lines, and a cache line worth of
+ * descendants a few levels below a node (16 ints, four levels) are contiguous
+ * and can be prefetched while the search goes on.
+ * The descent is branch-free. Ranks (positions in the sorted array) are
+ * recovered arithmetically from the node index, without a rank table, so the
+ * accelerator costs one extra copy of the elements.
+ *
+ * @tparam T      Element type (needs operator<).
+ * @tparam Alloc  Allocator of the layout.
+ */
+template<typename T, typename Alloc = std::allocator<T>>
+class EytzingerIndex {
+private:
+    /// keys[k - 1] is node k
+    std::vector<T, Alloc> keys;
+    /// Depth of the last (possibly partial) level; the root has depth 0
+    std::size_t height;
+
+    /// Nodes per cache line: the descendants prefetched log2(LINE) levels ahead
+    static constexpr std::size_t LINE = sizeof(T) >= 64 ? 1 : 64 / sizeof(T);
+
+    template<typename Sorted>
+    void fill(const Sorted& sorted, std::size_t k, std::size_t& next) {
+        if (k > keys.size()) {
+            return;
+        }
+        fill(sorted, 2 * k, next);
+        keys[k - 1] = sorted[next++];
+        fill(sorted, 2 * k + 1, next);
+    }
+
+    /**
+     * @brief Position in sorted order of node k, by arithmetic alone (no memory reads).
+     *
+     * In the perfect tree of the same height, node k at depth d has rank
+     * (2 (k - 2^d) + 1) 2^(height - d) - 1. Every other position of that tree
+     * is a last-level slot; only the first n - (2^height - 1) of them exist,
+     * so the missing slots before the node are subtracted.
+     */
+    std::size_t rankOf(std::size_t k) const {
+        std::size_t depth = 0;
+        for (std::size_t x = k; x > 1; x >>= 1) {
+            ++depth;
+        }
+        std::size_t perfect = ((2 * (k - (std::size_t(1) << depth)) + 1) << (height - depth)) - 1;
+        std::size_t slots_before = (perfect + 1) / 2;
+        std::size_t present = keys.size() - ((std::size_t(1) << height) - 1);
+        return slots_before > present ? perfect - (slots_before - present) : perfect;
+    }
+
+    /**
+     * @brief Node (1-based) of the first element for which goes_right is
+     *        false, or 0 if there is none.
+     */
+    template<typename GoesRight>
+    std::size_t descend(GoesRight goes_right) const {
+        std::size_t n = keys.size();
+        const T* base = keys.data();
+        std::size_t k = 1;
+        while (k <= n) {
+#if defined(__GNUC__) || defined(__clang__)
+            // Prefetch the first and last descendant log2(LINE) levels down (the array is
+            // not line aligned, so those descendants may span two lines)
+            __builtin_prefetch(base + (std::min(k * LINE, n) - 1));
+            __builtin_prefetch(base + (std::min(k * LINE + LINE - 1, n) - 1));
+#endif
+            k = 2 * k + static_cast<std::size_t>(goes_right(base[k - 1]));
+        }
+        // Undo the right turns after the last left turn: that node is the answer
+        while (k & 1) {
+            k >>= 1;
+        }
+        return k >> 1;
+    }
+
+    /**
+     * @brief Rank of the first element for which goes_right is false.
+     */
+    template<typename GoesRight>
+    std::size_t search(GoesRight goes_right) const {
+        std::size_t k = descend(goes_right);
+        return k == 0 ? keys.size() : rankOf(k);
+    }
+
+public:
+    /**
+     * @brief Lay out a sorted array. O(n).
+     *
+     * @param sorted  Elements in ascending order.
+     */
+    template<typename Sorted>
+    explicit EytzingerIndex(const Sorted& sorted)
+        : keys(sorted.begin(), sorted.end()), height(0)
+    {
+        for (std::size_t x = keys.size(); x > 1; x >>= 1) {
+            ++height;
+        }
+        std::size_t next = 0;
+        fill(sorted, 1, next);
+    }
+
+    std::size_t size() const noexcept {
+        return keys.size();
+    }
+
+    /// Number of elements smaller than value (std::lower_bound position)
+    std::size_t lowerRank(const T& value) const {
+        return search([&value](const T& key) { return key < value; });
+    }
+
+    /// Number of elements not greater than value (std::upper_bound position)
+    std::size_t upperRank(const T& value) const {
+        return search([&value](const T& key) { return !(value < key); });
+    }
+
+    /// Whether some element equals value (no rank computed)
+    bool contains(const T& value) const {
+        std::size_t k = descend([&value](const T& key) { return key < value; });
+        return k != 0 && !(value < keys[k - 1]);
+    }
+};
+
+} // namespace ariel
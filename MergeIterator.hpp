@@ -0,0 +1,299 @@
+//dor.cohen15@msmail.ariel.ac.il
+
+#pragma once
+
+#include <vector>
+#include <memory>      // for std::allocator, std::shared_ptr
+#include <utility>     // for std::swap
+#include <cstddef>     // for std::size_t
+#include <cstdint>     // for std::uint64_t
+#include <stdexcept>   // for std::out_of_range
+
+#include "MyContainer.hpp"
+
+namespace ariel {
+
+/**
+ * @brief Iterator that merges several sorted runs into one sorted stream.
+ *
+ * Every run is a shared vector of elements that is already ordered, either by
+ * value or - when the run carries keys - by a parallel vector of increasing
+ * sequence numbers (the insertion order of a ShardedContainer). Runs are read
+ * front to back for an ascending stream, or back to front for a descending
+ * one. The next element is picked with a loser tree (tournament tree) over the
+ * current head of every run: each step replays the log2 k matches on one
+ * leaf-to-root path, so a full traversal costs O(total * log k) for k runs.
+ * Equal elements are yielded in the order of their runs.
+ *
+ * The runs are shared, not copied: iterators over the same runs (and any
+ * MyContainer iterator sharing the same sorted data) do not duplicate them.
+ *
+ * @tparam T      Element type.
+ * @tparam Alloc  Allocator of the run vectors.
+ */
+template<typename T, typename Alloc = std::allocator<T>>
+class MergeIterator {
+public:
+    /// One sorted input of the merge
+    struct Run {
+        /// Elements of the run
+        std::shared_ptr<const std::vector<T, Alloc>> values;
+        /// Increasing sort keys parallel to values, or null to order by value
+        std::shared_ptr<const std::vector<std::uint64_t>> keys;
+    };
+
+private:
+    /// Read position in one run
+    struct Cursor {
+        /// Current head element
+        const T* value;
+        /// Key of the head element, or null when ordering by value
+        const std::uint64_t* key;
+        /// Elements left in the run, the head included
+        std::size_t left;
+    };
+
+    /// Inputs of the merge (kept alive while the cursors point into them)
+    std::vector<Run> runs;
+    /// Read position in every run
+    std::vector<Cursor> heads;
+    /// Loser tree: tree[0] is the run holding the next element, tree[i] for
+    /// 0 < i < k the run that lost the match at internal node i (the leaves,
+    /// nodes k .. 2k - 1, are the runs themselves)
+    std::vector<std::size_t> tree;
+    /// Whether the runs are read back to front, largest first
+    bool descending;
+    /// Number of elements yielded so far
+    std::size_t index;
+
+    /// Whether the head of run a is yielded before the head of run b; an
+    /// exhausted run loses every match and ties go to the lower run
+    bool beats(std::size_t a, std::size_t b) const {
+        const Cursor& ca = heads[a];
+        const Cursor& cb = heads[b];
+        if (ca.left == 0 || cb.left == 0) {
+            return ca.left != 0 || (cb.left == 0 && a < b);
+        }
+        bool a_first;
+        bool b_first;
+        if (ca.key != nullptr) {
+            a_first = descending ? *cb.key < *ca.key : *ca.key < *cb.key;
+            b_first = descending ? *ca.key < *cb.key : *cb.key < *ca.key;
+        } else {
+            a_first = descending ? *cb.value < *ca.value : *ca.value < *cb.value;
+            b_first = descending ? *ca.value < *cb.value : *cb.value < *ca.value;
+        }
+        return a_first || (!b_first && a < b);
+    }
+
+    /// Move run r past its head element
+    void advance(std::size_t r) {
+        Cursor& c = heads[r];
+        if (--c.left == 0) {
+            return;
+        }
+        if (descending) {
+            --c.value;
+            if (c.key != nullptr) {
+                --c.key;
+            }
+        } else {
+            ++c.value;
+            if (c.key != nullptr) {
+                ++c.key;
+            }
+        }
+    }
+
+    /**
+     * @brief Play the matches of the subtree at node, recording the losers.
+     *
+     * @return std::size_t  The run that wins the subtree.
+     */
+    std::size_t build(std::size_t node) {
+        std::size_t k = runs.size();
+        if (node >= k) {
+            return node - k; // leaf
+        }
+        std::size_t left = build(2 * node);
+        std::size_t right = build(2 * node + 1);
+        if (beats(left, right)) {
+            tree[node] = right;
+            return left;
+        }
+        tree[node] = left;
+        return right;
+    }
+
+public:
+    /**
+     * @brief Construct an iterator at the first element of the merge.
+     *
+     * @param inputs         Sorted runs; all of them ordered by value, or all by keys.
+     * @param largest_first  true to yield the largest element (or key) first.
+     */
+    MergeIterator(std::vector<Run> inputs, bool largest_first = false)
+        : runs(std::move(inputs)), heads(), tree(), descending(largest_first), index(0)
+    {
+        heads.reserve(runs.size());
+        for (const Run& run : runs) {
+            std::size_t n = run.values ? run.values->size() : 0;
+            Cursor c{nullptr, nullptr, n};
+            if (n > 0) {
+                std::size_t first = descending ? n - 1 : 0;
+                c.value = run.values->data() + first;
+                c.key = run.keys ? run.keys->data() + first : nullptr;
+            }
+            heads.push_back(c);
+        }
+        if (!runs.empty()) {
+            tree.assign(runs.size(), 0);
+            tree[0] = build(1);
+        }
+    }
+
+    /**
+     * @brief Construct the end iterator of a merge of total elements.
+     */
+    explicit MergeIterator(std::size_t total)
+        : runs(), heads(), tree(), descending(false), index(total) {}
+
+    /**
+     * @brief Dereference operator.
+     *
+     * @return const T&  The smallest (largest when descending) remaining head.
+     * @throws std::out_of_range if every run is exhausted.
+     */
+    const T& operator*() const {
+        if (tree.empty() || heads[tree[0]].left == 0) {
+            throw std::out_of_range("Iterator is out of bounds");
+        }
+        return *heads[tree[0]].value;
+    }
+
+    /**
+     * @brief Prefix increment operator: move past the current element.
+     *
+     * Replays only the matches on the path from the winner's leaf to the
+     * root: ceil(log2 k) comparisons.
+     *
+     * @throws std::out_of_range if every run is exhausted.
+     */
+    MergeIterator& operator++() {
+        if (tree.empty() || heads[tree[0]].left == 0) {
+            throw std::out_of_range("Cannot increment iterator: out of bounds");
+        }
+        std::size_t winner = tree[0];
+        advance(winner);
+        for (std::size_t node = (winner + runs.size()) / 2; node > 0; node /= 2) {
+            if (beats(tree[node], winner)) {
+                std::swap(tree[node], winner);
+            }
+        }
+        tree[0] = winner;
+        ++index;
+        return *this;
+    }
+
+    /**
+     * @brief Postfix increment operator.
+     *
+     * @return MergeIterator  Copy of this iterator before increment.
+     * @throws std::out_of_range if every run is exhausted.
+     */
+    MergeIterator operator++(int) {
+        MergeIterator copy = *this;
+        ++(*this);
+        return copy;
+    }
+
+    /**
+     * @brief Equality comparison: both iterators yielded the same number of elements.
+     */
+    bool operator==(const MergeIterator& other) const {
+        return index == other.index;
+    }
+
+    bool operator!=(const MergeIterator& other) const {
+        return !(*this == other);
+    }
+};
+
+/**
+ * @brief Global ascending / descending traversal of many containers at once,
+ *        without copying or re-sorting them.
+ *
+ * The view takes every container's shared sorted data (see
+ * MyContainer::sortedView) when it is constructed and merges those runs with
+ * a MergeIterator. Later changes to the containers are not visible through
+ * the view.
+ *
+ * @tparam T        Element type.
+ * @tparam Storage  Storage policy of the containers.
+ */
+template<typename T = int, typename Storage = std::vector<T>>
+class MergedView {
+public:
+    using ScratchAlloc = typename ScratchAllocator<Storage, T>::type;
+    using merge_iterator = MergeIterator<T, ScratchAlloc>;
+
+private:
+    std::vector<typename merge_iterator::Run> runs;
+    /// Number of elements over all runs
+    std::size_t total;
+
+    void add(const MyContainer<T, Storage>& c) {
+        runs.push_back({c.sortedView(), nullptr});
+        total += runs.back().values->size();
+    }
+
+public:
+    /**
+     * @brief View over the containers pointed to (null pointers are skipped).
+     */
+    explicit MergedView(const std::vector<const MyContainer<T, Storage>*>& containers)
+        : runs(), total(0)
+    {
+        runs.reserve(containers.size());
+        for (const MyContainer<T, Storage>* c : containers) {
+            if (c != nullptr) {
+                add(*c);
+            }
+        }
+    }
+
+    /**
+     * @brief View over every container of a vector.
+     */
+    explicit MergedView(const std::vector<MyContainer<T, Storage>>& containers)
+        : runs(), total(0)
+    {
+        runs.reserve(containers.size());
+        for (const MyContainer<T, Storage>& c : containers) {
+            add(c);
+        }
+    }
+
+    /// Number of elements over all containers
+    std::size_t size() const noexcept {
+        return total;
+    }
+
+    merge_iterator begin_ascending_order() const {
+        return merge_iterator(runs, false);
+    }
+
+    merge_iterator end_ascending_order() const {
+        return merge_iterator(total);
+    }
+
+    merge_iterator begin_descending_order() const {
+        return merge_iterator(runs, true);
+    }
+
+    merge_iterator end_descending_order() const {
+        return merge_iterator(total);
+    }
+};
+
+} // namespace ariel
@@ -4,6 +4,7 @@
 
 #include "MyContainer.hpp"
 #include <vector>
+#include <memory>      // for std::allocator
 #include <algorithm>   // for std::sort
 #include <cstddef>     // for std::size_t
 #include <stdexcept>   // for std::out_of_range
@@ -15,12 +16,14 @@ namespace ariel {
  * 
  * MiddleOutOrderIterator takes a copy of the container’s data, sorts it in
  * Middle Out order, and then allows sequential access via iterator semantics.
+ * 
+ * @tparam Alloc  Allocator of the scratch copy (chosen by the container's storage).
  */
-template<typename T>
+template<typename T, typename Alloc = std::allocator<T>>
 class MiddleOutOrderIterator {
 private:
     /// Sorted copy of all elements, in MiddleOut order
-    std::vector<T> sorted_data;
+    std::vector<T, Alloc> sorted_data;
     /// Current index within sorted_data (0-based)
     std::size_t index;
 
@@ -33,7 +36,7 @@ public:
      * @param all_data  Copy of the container’s data (will be moved into sorted_data).
      * @param idx       Starting index (default 0).
      */
-    MiddleOutOrderIterator(std::vector<T> all_data, std::size_t idx = 0)
+    MiddleOutOrderIterator(std::vector<T, Alloc> all_data, std::size_t idx = 0)
         : sorted_data(), index(idx)
     {
         //check that we do have elements
@@ -43,7 +46,7 @@ public:
         }
        
         // we will create another vector that will contain the MiddleOut Sort:
-        std::vector<T> alternating;
+        std::vector<T, Alloc> alternating;
         alternating.reserve(all_data.size());
         
         int middle_idx = n / 2; // i choose to round up the inx;
@@ -0,0 +1,307 @@
+//dor.cohen15@msmail.ariel.ac.il
+
+#pragma once
+
+#include <sys/mman.h>  // for mmap, mremap, madvise, munmap
+#include <cstddef>     // for std::size_t
+#include <cstdint>     // for std::uint64_t
+#include <cstring>     // for std::memcpy, std::memmove
+#include <new>         // for std::bad_alloc
+#include <type_traits> // for std::is_trivially_copyable
+#include <utility>     // for std::swap
+
+namespace ariel {
+
+/// Size of a transparent huge page on x86-64 / arm64 Linux
+constexpr std::size_t HUGE_PAGE_SIZE = std::size_t(2) << 20;
+
+/**
+ * @brief Map an anonymous, private, read-write region and ask for huge pages.
+ *
+ * @param bytes  Length of the mapping (a multiple of the page size).
+ * @return void* Start of the mapping.
+ * @throws std::bad_alloc if the kernel refuses the mapping.
+ */
+inline void* mapAnonymous(std::size_t bytes) {
+    void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+#ifdef MADV_HUGEPAGE
+    ::madvise(p, bytes, MADV_HUGEPAGE); // only a hint; failure is harmless
+#endif
+    return p;
+}
+
+/// Round bytes up to a whole number of huge pages.
+inline std::size_t roundToHugePages(std::size_t bytes) {
+    return (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+}
+
+/**
+ * @brief Allocator that serves large blocks from huge-page backed mmap regions.
+ *
+ * Used for the scratch buffers the iterators sort into. Blocks smaller than a
+ * huge page are not worth a mapping and come from operator new.
+ */
+template<typename T>
+class MmapAllocator {
+public:
+    using value_type = T;
+
+    MmapAllocator() noexcept = default;
+
+    template<typename U>
+    MmapAllocator(const MmapAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        std::size_t bytes = n * sizeof(T);
+        if (bytes < HUGE_PAGE_SIZE) {
+            return static_cast<T*>(::operator new(bytes));
+        }
+        return static_cast<T*>(mapAnonymous(roundToHugePages(bytes)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept {
+        std::size_t bytes = n * sizeof(T);
+        if (bytes < HUGE_PAGE_SIZE) {
+            ::operator delete(p);
+            return;
+        }
+        ::munmap(p, roundToHugePages(bytes));
+    }
+
+    template<typename U>
+    bool operator==(const MmapAllocator<U>&) const noexcept { return true; }
+
+    template<typename U>
+    bool operator!=(const MmapAllocator<U>&) const noexcept { return false; }
+};
+
+/**
+ * @brief Storage policy backed by one anonymous huge-page mapping.
+ *
+ * The elements live in a single mmap'ed region advised with MADV_HUGEPAGE, which
+ * cuts page faults and TLB misses for very large containers. When the region is
+ * full it is grown with mremap, so the kernel moves page-table entries instead of
+ * copying the elements. Restricted to trivially copyable T, since the kernel may
+ * move the elements to another address without running any constructor.
+ *
+ * MyContainer also uses scratch_allocator for the buffers its iterators sort.
+ *
+ * The storage can also adopt a private (copy-on-write) mapping of a container
+ * file written by MyContainer::saveFile. The elements are then read straight
+ * from the page cache without being copied; the first append moves them into
+ * an anonymous mapping.
+ *
+ * @tparam T  Element type (must be trivially copyable).
+ */
+template<typename T>
+class MmapStorage {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "MmapStorage requires a trivially copyable element type");
+
+private:
+    /// Start of the mapping (nullptr while nothing is mapped)
+    T* ptr;
+    /// Number of elements stored
+    std::size_t count;
+    /// Length of the mapping in bytes (from ptr on)
+    std::size_t bytes;
+    /// Start of the adopted file mapping (nullptr when the region is anonymous)
+    void* file_base;
+    /// Length of the adopted file mapping in bytes
+    std::size_t file_bytes;
+    /// Sorted permutation stored in the adopted file (nullptr if none or stale)
+    const std::uint64_t* permutation;
+
+    /**
+     * @brief Make room for at least n elements, mapping or remapping as needed.
+     */
+    void grow(std::size_t n) {
+        std::size_t wanted = roundToHugePages(n * sizeof(T));
+        if (wanted <= bytes) {
+            return;
+        }
+        if (ptr == nullptr) {
+            ptr = static_cast<T*>(mapAnonymous(wanted));
+        } else if (file_base != nullptr) {
+            // leave the file mapping: copy the elements out once
+            T* fresh = static_cast<T*>(mapAnonymous(wanted));
+            std::memcpy(fresh, ptr, count * sizeof(T));
+            ::munmap(file_base, file_bytes);
+            file_base = nullptr;
+            file_bytes = 0;
+            permutation = nullptr;
+            ptr = fresh;
+        } else {
+            void* p = ::mremap(ptr, bytes, wanted, MREMAP_MAYMOVE);
+            if (p == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+#ifdef MADV_HUGEPAGE
+            ::madvise(p, wanted, MADV_HUGEPAGE);
+#endif
+            ptr = static_cast<T*>(p);
+        }
+        bytes = wanted;
+    }
+
+    void release() noexcept {
+        if (file_base != nullptr) {
+            ::munmap(file_base, file_bytes);
+        } else if (ptr != nullptr) {
+            ::munmap(ptr, bytes);
+        }
+        ptr = nullptr;
+        count = 0;
+        bytes = 0;
+        file_base = nullptr;
+        file_bytes = 0;
+        permutation = nullptr;
+    }
+
+public:
+    using value_type        = T;
+    using size_type         = std::size_t;
+    using iterator          = T*;
+    using const_iterator    = const T*;
+    using scratch_allocator = MmapAllocator<T>;
+
+    MmapStorage()
+        : ptr(nullptr), count(0), bytes(0), file_base(nullptr), file_bytes(0), permutation(nullptr) {}
+
+    /**
+     * @brief Adopt a private mapping of a container file.
+     *
+     * The storage takes ownership of the mapping and unmaps it when destroyed.
+     *
+     * @param base         Start of the file mapping.
+     * @param length       Length of the file mapping in bytes.
+     * @param data_offset  Offset of the first element from base.
+     * @param n            Number of elements in the file.
+     * @param perm         Sorted permutation inside the mapping, or nullptr.
+     */
+    MmapStorage(void* base, std::size_t length, std::size_t data_offset, std::size_t n,
+                const std::uint64_t* perm = nullptr)
+        : ptr(reinterpret_cast<T*>(static_cast<char*>(base) + data_offset)), count(n),
+          bytes(n * sizeof(T)), file_base(base), file_bytes(length), permutation(perm) {}
+
+    MmapStorage(const MmapStorage& other) : MmapStorage() {
+        reserve(other.count);
+        if (other.count > 0) {
+            std::memcpy(ptr, other.ptr, other.count * sizeof(T));
+        }
+        count = other.count;
+    }
+
+    MmapStorage(MmapStorage&& other) noexcept : MmapStorage() {
+        swap(other);
+    }
+
+    MmapStorage& operator=(MmapStorage other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~MmapStorage() {
+        release();
+    }
+
+    void swap(MmapStorage& other) noexcept {
+        std::swap(ptr, other.ptr);
+        std::swap(count, other.count);
+        std::swap(bytes, other.bytes);
+        std::swap(file_base, other.file_base);
+        std::swap(file_bytes, other.file_bytes);
+        std::swap(permutation, other.permutation);
+    }
+
+    /**
+     * @brief Append an element, doubling the mapping with mremap when full.
+     *
+     * @param value  Element to append.
+     */
+    void push_back(const T& value) {
+        if ((count + 1) * sizeof(T) > bytes) {
+            grow(count == 0 ? 1 : 2 * count);
+        }
+        ptr[count++] = value;
+    }
+
+    void pop_back() noexcept {
+        --count;
+        permutation = nullptr;
+    }
+
+    /**
+     * @brief Make sure the mapping can hold at least n elements.
+     *
+     * @param n  Number of elements to make room for.
+     */
+    void reserve(std::size_t n) {
+        grow(n);
+    }
+
+    /**
+     * @brief Change the number of elements; new elements are zero-filled.
+     *
+     * @param n  New number of elements.
+     */
+    void resize(std::size_t n) {
+        grow(n);
+        if (n > count) {
+            std::memset(ptr + count, 0, (n - count) * sizeof(T));
+        }
+        count = n;
+        permutation = nullptr;
+    }
+
+    /**
+     * @brief Remove all elements and unmap the region.
+     */
+    void clear() noexcept {
+        release();
+    }
+
+    std::size_t size() const noexcept { return count; }
+
+    bool empty() const noexcept { return count == 0; }
+
+    std::size_t capacity() const noexcept { return bytes / sizeof(T); }
+
+    /**
+     * @brief Indices of the elements in ascending order, as stored in the
+     *        adopted file; nullptr once the elements were modified.
+     */
+    const std::uint64_t* sortedPermutation() const noexcept { return permutation; }
+
+    T* data() noexcept { return ptr; }
+    const T* data() const noexcept { return ptr; }
+
+    T& operator[](std::size_t i) { return ptr[i]; }
+    const T& operator[](std::size_t i) const { return ptr[i]; }
+
+    iterator begin() noexcept { return ptr; }
+    iterator end() noexcept { return ptr + count; }
+    const_iterator begin() const noexcept { return ptr; }
+    const_iterator end() const noexcept { return ptr + count; }
+
+    /**
+     * @brief Erase the elements in [first, last) by sliding the tail down.
+     *
+     * @return iterator  Iterator to the element that followed the erased range.
+     */
+    iterator erase(const_iterator first, const_iterator last) {
+        T* from = ptr + (first - ptr);
+        std::size_t tail = static_cast<std::size_t>(end() - last);
+        if (tail > 0) {
+            std::memmove(from, last, tail * sizeof(T));
+        }
+        count -= static_cast<std::size_t>(last - first);
+        permutation = nullptr;
+        return from;
+    }
+};
+
+} // namespace ariel
@@ -5,8 +5,23 @@
 
 #include <stdexcept> // to use exceptions
 #include <vector> // to store elements.
+#include <memory> // for std::allocator, std::shared_ptr, std::atomic_load
+#include <type_traits> // for std::void_t
 #include <algorithm>
 #include <ostream> // to print
+#include <istream> // to parse
+#include <fstream> // for saveFile
+#include <numeric> // for std::iota
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <mutex> // for the background sort slot
+#include <condition_variable>
+#include <iterator> // for std::back_inserter, std::iterator_traits
+#include <utility> // for std::pair
+#include <optional> // for the cached extremes
+#include <cmath> // for std::ceil, std::isnan
+#include <limits> // for std::numeric_limits
 
 #include "OrderIterator.hpp"
 #include "AscendingOrderIterator.hpp"
@@ -14,120 +29,1906 @@
 #include "SideCrossOrderIterator.hpp"
 #include "ReverseOrderIterator.hpp"
 #include "MiddleOutOrderIterator.hpp"
+#include "PartialSortIterator.hpp"
+#include "DistinctView.hpp"
+#include "SetOperations.hpp"
+#include "SortMergeJoin.hpp"
+#include "SegmentedStorage.hpp"
+#include "CountedStorage.hpp"
+#include "MmapStorage.hpp"
+#include "BinaryFormat.hpp"
+#include "TextParser.hpp"
+#include "TextFormatter.hpp"
+#include "Order.hpp"
+#include "WorkStealingPool.hpp"
+#include "SortedRuns.hpp"
+#include "OrderStatisticTree.hpp"
+#include "EytzingerIndex.hpp"
 
 namespace ariel {
-    template<typename T = int> //should default be int
+
+    /**
+     * @brief Allocator used for the iterators' scratch copies.
+     *
+     * A storage policy may name one as Storage::scratch_allocator (MmapStorage
+     * does); otherwise std::allocator<T> is used.
+     */
+    template<typename Storage, typename T, typename = void>
+    struct ScratchAllocator {
+        using type = std::allocator<T>;
+    };
+
+    template<typename Storage, typename T>
+    struct ScratchAllocator<Storage, T, std::void_t<typename Storage::scratch_allocator>> {
+        using type = typename Storage::scratch_allocator;
+    };
+
+    /**
+     * @brief Detects storage policies that can hand out a precomputed sorted
+     *        permutation of their elements (MmapStorage over a container file).
+     */
+    template<typename Storage, typename = void>
+    struct HasSortedPermutation : std::false_type {};
+
+    template<typename Storage>
+    struct HasSortedPermutation<Storage, std::void_t<decltype(std::declval<const Storage&>().sortedPermutation())>>
+        : std::true_type {};
+
+    /**
+     * @brief Detects contiguous storage policies (those with data()).
+     */
+    template<typename Storage, typename = void>
+    struct IsContiguousStorage : std::false_type {};
+
+    template<typename Storage>
+    struct IsContiguousStorage<Storage, std::void_t<decltype(std::declval<const Storage&>().data())>>
+        : std::true_type {};
+
+    /**
+     * @brief Detects storage policies that can be resized in place (those with
+     *        resize(n)), which parallel compaction scatters into.
+     */
+    template<typename Storage, typename = void>
+    struct HasResize : std::false_type {};
+
+    template<typename Storage>
+    struct HasResize<Storage, std::void_t<decltype(std::declval<Storage&>().resize(std::size_t()))>>
+        : std::true_type {};
+
+    /**
+     * @brief Detects storage policies that keep distinct values with counts
+     *        and hand out their sorted order as a CountedRun (CountedStorage).
+     */
+    template<typename Storage, typename = void>
+    struct HasCountedRun : std::false_type {};
+
+    template<typename Storage>
+    struct HasCountedRun<Storage, std::void_t<decltype(std::declval<const Storage&>().countedRun())>>
+        : std::true_type {};
+
+    /**
+     * @brief Detects storage policies that erase matching elements themselves
+     *        (those with eraseIf(pred)) instead of through writable iterators.
+     */
+    template<typename Storage, typename = void>
+    struct HasEraseIf : std::false_type {};
+
+    template<typename Storage>
+    struct HasEraseIf<Storage, std::void_t<decltype(std::declval<Storage&>().eraseIf(
+        std::declval<bool (*&)(const typename Storage::value_type&)>()))>>
+        : std::true_type {};
+
+    /**
+     * @brief Generic container of comparable elements.
+     *
+     * @tparam T        Element type (default int).
+     * @tparam Storage  Storage policy holding the elements in insertion order.
+     *                  std::vector<T> by default; SegmentedStorage<T> avoids the
+     *                  regrowth copies of a single contiguous array.
+     */
+    template<typename T = int, typename Storage = std::vector<T>> //should default be int
     class MyContainer {
     
         // will be able to use all private class memebers.
-        template<typename U> friend class OrderIterator;
+        template<typename U, typename S> friend class OrderIterator;
+
+        template<typename U, typename A> friend class AscendingOrderIterator;
 
-        template<typename U> friend class AscendingOrderIterator;
+        template<typename U, typename A> friend class DescendingOrderIterator;
 
-        template<typename U> friend class DescendingOrderIterator;
+        template<typename U, typename A> friend class SideCrossOrderIterator;
 
-        template<typename U> friend class SideCrossOrderIterator;
+        template<typename U, typename A> friend class MiddleOutOrderIterator;
 
-        template<typename U> friend class MiddleOutOrderIterator;
+        template<typename U, typename A> friend class ReverseOrderIterator;
 
-        template<typename U> friend class ReverseOrderIterator;
+        template<typename U, typename S> friend class MyContainer;
 
+        template<typename U, typename S> friend class ShardedContainer;
         
 
         private:
-            std::vector<T> data; 
+            /// Allocator for the scratch copies the iterators reorder
+            using ScratchAlloc = typename ScratchAllocator<Storage, T>::type;
+
+            /// Elements in ascending order, shared by the sorted iterators
+            using SortedData = std::vector<T, ScratchAlloc>;
+
+            Storage data; 
+
+            /**
+             * @brief Sorted index of data, LSM style: a large sorted base run, a
+             *        small sorted delta run of later appends, and deletion
+             *        markers for the values removed from the base.
+             *
+             * An index is immutable once published; every change publishes a
+             * new one, so iterators keep reading the runs they started with.
+             */
+            struct SortedIndex {
+                /// Large sorted run; its copies of the deleted values are dead
+                std::shared_ptr<const SortedData> base;
+                /// Sorted run of elements appended after base was built (null: none)
+                std::shared_ptr<const SortedData> delta;
+                /// Values removed since base was built, sorted and unique
+                std::vector<T> deleted;
+                /// Number of live elements of base and delta: they are data[0, covered)
+                std::size_t covered;
+                /// Number of removes applied since base was built
+                std::uint64_t removals;
+                /// Eytzinger layout of base, when the search accelerator is on (null: none yet)
+                std::shared_ptr<const EytzingerIndex<T, ScratchAlloc>> search;
+            };
+
+            /// Sorted index, built on first sorted use (null: none yet). Appends
+            /// and remove() keep it; removeIf and the load functions drop it
+            mutable std::shared_ptr<const SortedIndex> sorted;
+
+            /// State of the background merge of the sorted index
+            struct Rebuild {
+                std::mutex lock;
+                std::condition_variable done;
+                /// Whether a merge is queued or running
+                bool pending = false;
+                /// Finished merge of result_from, not adopted yet
+                std::shared_ptr<const SortedData> result;
+                std::shared_ptr<const SortedIndex> result_from;
+            };
+
+            /// Whether delta runs are merged in the background (see setBackgroundSort)
+            bool background_sort;
+            /// Rebuild slot, shared with the queued merge; null when background sort is off
+            mutable std::shared_ptr<Rebuild> rebuild;
+
+            /// Whether seeks use an Eytzinger layout of the base (see setSearchAccelerator)
+            bool search_accelerator;
+
+            /// Whether the sorted orders are served by tree (see setTreeIndex)
+            bool tree_index;
+            /// Order-statistic tree of data, updated by every modification while tree_index is on
+            OrderStatisticTree<T> tree;
+
+            /// Smallest and largest element, kept by every modification (both
+            /// empty: unknown, e.g. after mapFile; min() and max() then look them up)
+            std::optional<T> low;
+            std::optional<T> high;
+
+            /// Update the extremes for an appended value (already in data)
+            void noteAdded(const T& value) noexcept {
+                try {
+                    if (data.size() == 1) {
+                        low = value;
+                        high = value;
+                    } else if (low) {
+                        if (value < *low) {
+                            low = value;
+                        }
+                        if (*high < value) {
+                            high = value;
+                        }
+                    }
+                } catch (...) { // copying failed: forget them
+                    low.reset();
+                    high.reset();
+                }
+            }
+
+            /// min() (largest: false) or max(), looked up if not known
+            T extreme(bool largest) const {
+                std::size_t n = data.size();
+                if (n == 0) {
+                    throw std::runtime_error("Container is empty");
+                }
+                if (low) {
+                    return largest ? *high : *low;
+                }
+                bool lookup = tree_index || HasCountedRun<Storage>::value || std::atomic_load(&sorted);
+                if constexpr (HasSortedPermutation<Storage>::value) {
+                    lookup = lookup || data.sortedPermutation() != nullptr;
+                }
+                if (lookup) {
+                    return nth(largest ? n - 1 : 0);
+                }
+                return largest ? *std::max_element(data.begin(), data.end())
+                               : *std::min_element(data.begin(), data.end());
+            }
+
+            /**
+             * @brief The k smallest elements in ascending order, or the k
+             *        largest in descending order (all of them if k >= size()).
+             *
+             * Read from the sorted index, the tree or a stored permutation if
+             * there is one (O(k), plus a delta merge); otherwise selected in
+             * one pass with a bounded heap of k elements, O(n log k).
+             */
+            std::vector<T> firstInOrder(std::size_t k, bool largest) const {
+                std::size_t n = data.size();
+                k = std::min(k, n);
+                std::vector<T> out;
+                out.reserve(k);
+                if (k == 0) {
+                    return out;
+                }
+                if (tree_index || HasCountedRun<Storage>::value || std::atomic_load(&sorted)) {
+                    SortedRuns<T, ScratchAlloc> runs = sortedRuns();
+                    typename SortedRuns<T, ScratchAlloc>::Cursor at{0, 0};
+                    if (largest) {
+                        at = typename SortedRuns<T, ScratchAlloc>::Cursor{runs.baseSize(), runs.delta().size()};
+                    }
+                    while (out.size() < k) {
+                        if (largest) {
+                            out.push_back(runs.previous(at));
+                            runs.retreat(at);
+                        } else {
+                            out.push_back(runs.next(at));
+                            runs.advance(at);
+                        }
+                    }
+                    return out;
+                }
+                if constexpr (HasSortedPermutation<Storage>::value) {
+                    const std::uint64_t* perm = data.sortedPermutation();
+                    for (std::size_t i = 0; perm != nullptr && i < k; ++i) {
+                        std::uint64_t at = perm[largest ? n - 1 - i : i];
+                        if (at >= n) { // corrupt file: select instead
+                            out.clear();
+                            break;
+                        }
+                        out.push_back(data[static_cast<std::size_t>(at)]);
+                    }
+                    if (out.size() == k) {
+                        return out;
+                    }
+                }
+                // heap of the best k so far; its front is the worst of them
+                auto before = [largest](const T& a, const T& b) { return largest ? b < a : a < b; };
+                for (const T& value : data) {
+                    if (out.size() < k) {
+                        out.push_back(value);
+                        std::push_heap(out.begin(), out.end(), before);
+                    } else if (before(value, out.front())) {
+                        std::pop_heap(out.begin(), out.end(), before);
+                        out.back() = value;
+                        std::push_heap(out.begin(), out.end(), before);
+                    }
+                }
+                std::sort_heap(out.begin(), out.end(), before);
+                return out;
+            }
+
+            /// Recompute the extremes with one pass over data. O(n).
+            void findExtremes() noexcept {
+                low.reset();
+                high.reset();
+                if (data.size() > 0) {
+                    try {
+                        auto range = std::minmax_element(data.begin(), data.end());
+                        low = *range.first;
+                        high = *range.second;
+                    } catch (...) { // copying failed: leave them unknown
+                        low.reset();
+                        high.reset();
+                    }
+                }
+            }
+
+            /**
+             * @brief Copy of the elements in insertion order, for the iterators
+             *        that reorder their own copy.
+             */
+            std::vector<T, ScratchAlloc> copyData() const {
+                return std::vector<T, ScratchAlloc>(data.begin(), data.end());
+            }
+
+            /**
+             * @brief Publish next as the sorted index if it is still expected.
+             *
+             * Const members may run concurrently on one container; when two
+             * readers race, one index wins and both results are correct.
+             *
+             * @return next, for the caller to use either way.
+             */
+            std::shared_ptr<const SortedIndex> publish(std::shared_ptr<const SortedIndex> expected,
+                                                       std::shared_ptr<const SortedIndex> next) const {
+                std::atomic_compare_exchange_strong(&sorted, &expected, next);
+                return next;
+            }
+
+            /// Index made of one clean sorted run
+            static std::shared_ptr<const SortedIndex> baseIndex(std::shared_ptr<const SortedData> base) {
+                std::size_t n = base->size();
+                return std::make_shared<const SortedIndex>(SortedIndex{std::move(base), nullptr, {}, n, 0, nullptr});
+            }
+
+            /**
+             * @brief Sort every element from scratch (or gather them through the
+             *        storage's sorted permutation).
+             */
+            std::shared_ptr<const SortedIndex> buildIndex() const {
+                SortedData values;
+                if (!gatherSorted(values)) {
+                    values.assign(data.begin(), data.end());
+                    if (values.size() >= parallel_sort_threshold) {
+                        parallelSort(values, defaultPool());
+                    } else {
+                        std::sort(values.begin(), values.end());
+                    }
+                }
+                return baseIndex(std::make_shared<const SortedData>(std::move(values)));
+            }
+
+            /**
+             * @brief Merge the live elements of an index into one sorted run in
+             *        a single linear pass (on equal values base comes first).
+             */
+            static SortedData mergeIndex(const SortedIndex& index) {
+                static const SortedData none;
+                const SortedData& base = *index.base;
+                const SortedData& delta = index.delta ? *index.delta : none;
+                SortedData merged;
+                merged.reserve(index.covered);
+                auto marker = index.deleted.begin();
+                std::size_t j = 0;
+                for (const T& value : base) {
+                    while (marker != index.deleted.end() && *marker < value) {
+                        ++marker;
+                    }
+                    if (marker != index.deleted.end() && !(value < *marker)) {
+                        continue; // deleted
+                    }
+                    while (j < delta.size() && delta[j] < value) {
+                        merged.push_back(delta[j++]);
+                    }
+                    merged.push_back(value);
+                }
+                merged.insert(merged.end(), delta.begin() + j, delta.end());
+                return merged;
+            }
+
+            /**
+             * @brief The index with every copy of value removed: marked deleted
+             *        in the base, dropped from the (small) delta.
+             */
+            static std::shared_ptr<const SortedIndex> withoutValue(const SortedIndex& index, const T& value) {
+                SortedIndex next = index;
+                auto marker = std::lower_bound(next.deleted.begin(), next.deleted.end(), value);
+                if (marker == next.deleted.end() || value < *marker) {
+                    auto dead = std::equal_range(index.base->begin(), index.base->end(), value);
+                    if (dead.first != dead.second) {
+                        next.deleted.insert(marker, value);
+                        next.covered -= static_cast<std::size_t>(dead.second - dead.first);
+                    }
+                }
+                if (index.delta) {
+                    auto dead = std::equal_range(index.delta->begin(), index.delta->end(), value);
+                    if (dead.first != dead.second) {
+                        SortedData rest(index.delta->begin(), dead.first);
+                        rest.insert(rest.end(), dead.second, index.delta->end());
+                        next.covered -= static_cast<std::size_t>(dead.second - dead.first);
+                        next.delta = rest.empty() ? nullptr : std::make_shared<const SortedData>(std::move(rest));
+                    }
+                }
+                ++next.removals;
+                return std::make_shared<const SortedIndex>(std::move(next));
+            }
+
+            /**
+             * @brief Publish a finished background merge in place of index if no
+             *        remove happened since it started; the elements appended
+             *        meanwhile become the new delta. Call with rebuild->lock held.
+             *
+             * @return The sorted index, replaced or not.
+             */
+            std::shared_ptr<const SortedIndex> adoptRebuild(std::shared_ptr<const SortedIndex> index) const {
+                if (!rebuild->result) {
+                    return index;
+                }
+                std::shared_ptr<const SortedData> base = std::move(rebuild->result);
+                std::shared_ptr<const SortedIndex> from = std::move(rebuild->result_from);
+                rebuild->result.reset();
+                rebuild->result_from.reset();
+                if (from->base != index->base || from->removals != index->removals) {
+                    return index; // merged from an older state
+                }
+                SortedData appended(data.begin() + from->covered, data.end());
+                std::sort(appended.begin(), appended.end());
+                SortedIndex next{std::move(base), nullptr, {}, data.size(), 0, nullptr};
+                if (!appended.empty()) {
+                    next.delta = std::make_shared<const SortedData>(std::move(appended));
+                }
+                return publish(std::move(index), std::make_shared<const SortedIndex>(std::move(next)));
+            }
+
+            /**
+             * @brief Queue the merge of index on defaultPool(), unless one is pending.
+             */
+            void scheduleRebuild(const std::shared_ptr<const SortedIndex>& index) const {
+                std::shared_ptr<Rebuild> slot = rebuild;
+                std::lock_guard<std::mutex> guard(slot->lock);
+                if (slot->pending) {
+                    return;
+                }
+                slot->pending = true;
+                defaultPool().submit([slot, index]() {
+                    std::shared_ptr<const SortedData> merged;
+                    try {
+                        merged = std::make_shared<const SortedData>(mergeIndex(*index));
+                    } catch (...) {
+                        // out of memory: queries keep merging on the fly
+                    }
+                    std::lock_guard<std::mutex> done_guard(slot->lock);
+                    if (merged) {
+                        slot->result = std::move(merged);
+                        slot->result_from = index;
+                    }
+                    slot->pending = false;
+                    slot->done.notify_all();
+                });
+            }
+
+            /**
+             * @brief Index made of the elements of the tree, read in order (no sort).
+             */
+            std::shared_ptr<const SortedIndex> indexFromTree() const {
+                SortedData values;
+                values.reserve(tree.size());
+                tree.forEach([&values](const T& value) { values.push_back(value); });
+                return baseIndex(std::make_shared<const SortedData>(std::move(values)));
+            }
+
+            /**
+             * @brief Drop the sorted index after data was replaced or filtered,
+             *        recompute the extremes and rebuild the tree if it is enabled.
+             */
+            void contentsChanged() {
+                sorted.reset();
+                findExtremes();
+                if (tree_index) {
+                    std::shared_ptr<const SortedIndex> index = buildIndex();
+                    tree = OrderStatisticTree<T>::fromSorted(index->base->begin(), index->base->end());
+                    if (!HasCountedRun<Storage>::value) {
+                        sorted = std::move(index);
+                    }
+                }
+            }
+
+            /**
+             * @brief The sorted index, brought up to date with data.
+             *
+             * Built from scratch on first use (read from the tree, if enabled). After that only the elements
+             * appended since the last update are sorted and merged into the
+             * delta run, so the base is never re-sorted.
+             */
+            std::shared_ptr<const SortedIndex> currentIndex() const {
+                std::shared_ptr<const SortedIndex> index = std::atomic_load(&sorted);
+                if (!index) {
+                    return publish(nullptr, tree_index ? indexFromTree() : buildIndex());
+                }
+                if (rebuild) {
+                    std::lock_guard<std::mutex> guard(rebuild->lock);
+                    index = adoptRebuild(std::move(index));
+                }
+                if (index->covered == data.size()) {
+                    return index;
+                }
+                SortedData appended(data.begin() + index->covered, data.end());
+                std::sort(appended.begin(), appended.end());
+                if (index->delta) {
+                    SortedData merged;
+                    merged.reserve(index->delta->size() + appended.size());
+                    std::merge(index->delta->begin(), index->delta->end(),
+                               appended.begin(), appended.end(), std::back_inserter(merged));
+                    appended.swap(merged);
+                }
+                SortedIndex next{index->base, std::make_shared<const SortedData>(std::move(appended)),
+                                 index->deleted, data.size(), index->removals, index->search};
+                return publish(std::move(index), std::make_shared<const SortedIndex>(std::move(next)));
+            }
+
+            /**
+             * @brief The elements in ascending order, as one clean sorted run.
+             *
+             * The result is shared by every sorted iterator created until the
+             * next modification. Brings the index up to date and merges its
+             * delta and deletion markers into the base (linear) if it has any.
+             * Counted storage expands its counted run instead, once per version
+             * (CountedRun::expanded); the sorted iterators, print() and view()
+             * read the counts directly and never need it.
+             */
+            std::shared_ptr<const SortedData> sortedData() const {
+                if constexpr (HasCountedRun<Storage>::value) {
+                    if (!tree_index) {
+                        return data.countedRun()->expanded();
+                    }
+                }
+                std::shared_ptr<const SortedIndex> index = currentIndex();
+                if (index->delta || !index->deleted.empty()) {
+                    index = publish(index, baseIndex(std::make_shared<const SortedData>(mergeIndex(*index))));
+                }
+                return index->base;
+            }
+
+            /**
+             * @brief The elements in ascending order as the base run plus the
+             *        delta run, for the sorted iterators to merge on the fly.
+             *
+             * Deletion markers are merged away first (the runs hold no dead
+             * elements). A delta larger than delta_merge_threshold is merged
+             * into the base here; with background sort on, any delta is merged
+             * on defaultPool() instead while the queries read both runs.
+             * With the tree index on, the runs are a snapshot of the tree; with
+             * counted storage, the storage's counted run (no index at all). With
+             * the search accelerator on, the base comes with its Eytzinger
+             * layout, built once per base.
+             */
+            SortedRuns<T, ScratchAlloc> sortedRuns() const {
+                if (tree_index) {
+                    return SortedRuns<T, ScratchAlloc>(tree);
+                }
+                if constexpr (HasCountedRun<Storage>::value) {
+                    return SortedRuns<T, ScratchAlloc>(data.countedRun());
+                }
+                std::shared_ptr<const SortedIndex> index = currentIndex();
+                std::size_t pending = index->delta ? index->delta->size() : 0;
+                if (!index->deleted.empty() || (!background_sort && pending > delta_merge_threshold)) {
+                    index = publish(index, baseIndex(std::make_shared<const SortedData>(mergeIndex(*index))));
+                } else if (background_sort && pending > 0) {
+                    scheduleRebuild(index);
+                }
+                if (search_accelerator && !index->search) {
+                    SortedIndex next = *index;
+                    next.search = std::make_shared<const EytzingerIndex<T, ScratchAlloc>>(*index->base);
+                    index = publish(index, std::make_shared<const SortedIndex>(std::move(next)));
+                }
+                return SortedRuns<T, ScratchAlloc>(index->base, index->delta, index->search);
+            }
+
+            /**
+             * @brief Fill values from the storage's precomputed sorted
+             *        permutation or counted run, if it has one (linear, no sort).
+             *
+             * @return false if there is no usable permutation or run.
+             */
+            bool gatherSorted(SortedData& values) const {
+                if constexpr (HasSortedPermutation<Storage>::value) {
+                    const std::uint64_t* perm = data.sortedPermutation();
+                    if (perm == nullptr) {
+                        return false;
+                    }
+                    std::size_t n = data.size();
+                    values.reserve(n);
+                    for (std::size_t i = 0; i < n; ++i) {
+                        if (perm[i] >= n) { // corrupt file: fall back to sorting
+                            values.clear();
+                            return false;
+                        }
+                        values.push_back(data[perm[i]]);
+                    }
+                    return true;
+                } else if constexpr (HasCountedRun<Storage>::value) {
+                    std::shared_ptr<const CountedRun<T>> run = data.countedRun();
+                    values.reserve(run->size());
+                    for (std::size_t i = 0; i < run->values.size(); ++i) {
+                        values.insert(values.end(), run->ends[i] - run->firstRank(i), run->values[i]);
+                    }
+                    return true;
+                } else {
+                    (void)values;
+                    return false;
+                }
+            }
+
+            /// true when elements are written as raw bytes, false for length-prefixed strings
+            static constexpr bool RAW_ELEMENTS = std::is_trivially_copyable<T>::value;
+
+            /// element_size recorded in the header (0 for length-prefixed elements)
+            static constexpr std::uint32_t ENCODED_SIZE = RAW_ELEMENTS ? sizeof(T) : 0;
+
+            /// Number of elements moved per block by the bulk read/write paths
+            static constexpr std::size_t BLOCK = 1 << 14;
+
+            /**
+             * @brief Write all elements, in insertion order, to a byte sink.
+             *
+             * Trivially copyable elements are written as raw bytes: with one
+             * call for contiguous storage, through a block buffer otherwise.
+             * std::string elements are written as length + bytes.
+             */
+            template<typename Sink>
+            void writeElements(Sink& sink) const {
+                static_assert(RAW_ELEMENTS || std::is_same<T, std::string>::value,
+                              "binary I/O supports trivially copyable types and std::string");
+                if constexpr (!RAW_ELEMENTS) {
+                    for (std::size_t i = 0; i < data.size(); ++i) {
+                        std::uint64_t length = data[i].size();
+                        sink.write(&length, sizeof(length));
+                        sink.write(data[i].data(), data[i].size());
+                    }
+                } else if constexpr (IsContiguousStorage<Storage>::value) {
+                    sink.write(data.data(), data.size() * sizeof(T));
+                } else {
+                    std::vector<T> block;
+                    block.reserve(BLOCK);
+                    for (std::size_t i = 0; i < data.size(); i += BLOCK) {
+                        block.assign(data.begin() + i, data.begin() + std::min(data.size(), i + BLOCK));
+                        sink.write(block.data(), block.size() * sizeof(T));
+                    }
+                }
+            }
+
+            /**
+             * @brief Read n elements written by writeElements into out.
+             *
+             * n and the string lengths come from the input, so nothing is
+             * allocated on their word alone: a buffer source checks them
+             * against the bytes it has left, and a stream source grows the
+             * output block by block as the bytes arrive (a short stream then
+             * fails in read()). Contiguous storage is read into directly.
+             *
+             * @throws std::runtime_error if the input holds fewer elements.
+             */
+            template<typename Source>
+            static void readElements(Source& source, Storage& out, std::uint64_t n) {
+                if constexpr (!RAW_ELEMENTS) {
+                    source.require(n, sizeof(std::uint64_t));
+                    for (std::uint64_t i = 0; i < n; ++i) {
+                        std::uint64_t length = 0;
+                        source.read(&length, sizeof(length));
+                        source.require(length, 1);
+                        std::string value;
+                        for (std::uint64_t done = 0; done < length; done += BLOCK) {
+                            std::size_t step = static_cast<std::size_t>(std::min<std::uint64_t>(BLOCK, length - done));
+                            value.resize(static_cast<std::size_t>(done) + step);
+                            source.read(&value[static_cast<std::size_t>(done)], step);
+                        }
+                        out.push_back(std::move(value));
+                    }
+                } else {
+                    source.require(n, sizeof(T));
+                    if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+                        throw std::runtime_error("Container data is truncated");
+                    }
+                    if constexpr (IsContiguousStorage<Storage>::value) {
+                        out.reserve(static_cast<std::size_t>(Source::KNOWN_SIZE ? n : std::min<std::uint64_t>(n, BLOCK)));
+                        for (std::size_t done = 0; done < n; done += BLOCK) {
+                            std::size_t step = static_cast<std::size_t>(std::min<std::uint64_t>(BLOCK, n - done));
+                            out.resize(done + step);
+                            source.read(out.data() + done, step * sizeof(T));
+                        }
+                    } else {
+                        std::vector<T> block(BLOCK);
+                        for (std::size_t done = 0; done < n; done += BLOCK) {
+                            std::size_t step = static_cast<std::size_t>(std::min<std::uint64_t>(BLOCK, n - done));
+                            source.read(block.data(), step * sizeof(T));
+                            for (std::size_t i = 0; i < step; ++i) {
+                                out.push_back(block[i]);
+                            }
+                        }
+                    }
+                }
+            }
+
+            /// Write the header and the elements (see save()).
+            template<typename Sink>
+            void saveTo(Sink& sink) const {
+                FileHeader header = FileHeader::make(ENCODED_SIZE, data.size(), false);
+                if (!RAW_ELEMENTS) {
+                    header.flags |= FileHeader::LENGTH_PREFIXED;
+                }
+                sink.write(&header, sizeof(header));
+                writeElements(sink);
+            }
+
+            /// Read a header and its elements, replacing the contents (see load()).
+            template<typename Source>
+            void loadFrom(Source& source) {
+                FileHeader header;
+                source.read(&header, sizeof(header));
+                header.checkFormat(ENCODED_SIZE);
+                Storage fresh;
+                readElements(source, fresh, header.count);
+                data = std::move(fresh);
+                contentsChanged();
+            }
+
+            /// Elements per block of the parallel compaction
+            static constexpr std::size_t COMPACT_BLOCK = 1 << 16;
+
+            /**
+             * @brief Parallel stable compaction: every block counts the elements
+             *        it keeps, an exclusive prefix sum of the counts gives each
+             *        block its output offset, and the blocks then scatter their
+             *        survivors into a fresh storage in parallel.
+             *
+             * pred runs once per element. If it throws, the container is unchanged.
+             *
+             * @return std::size_t  Number of elements removed.
+             */
+            template<typename Pred>
+            std::size_t compactParallel(Pred& pred) {
+                std::size_t n = data.size();
+                std::size_t blocks = (n + COMPACT_BLOCK - 1) / COMPACT_BLOCK;
+                std::vector<unsigned char> drop(n);
+                std::vector<std::size_t> offset(blocks + 1, 0);
+                WorkStealingPool& pool = defaultPool();
+
+                pool.parallelFor(blocks, 1, [&](std::size_t first, std::size_t last) {
+                    for (std::size_t b = first; b < last; ++b) {
+                        std::size_t end = std::min(n, (b + 1) * COMPACT_BLOCK);
+                        std::size_t kept = 0;
+                        for (std::size_t i = b * COMPACT_BLOCK; i < end; ++i) {
+                            drop[i] = pred(static_cast<const T&>(data[i])) ? 1 : 0;
+                            kept += 1 - drop[i];
+                        }
+                        offset[b + 1] = kept;
+                    }
+                });
+                for (std::size_t b = 0; b < blocks; ++b) {
+                    offset[b + 1] += offset[b];
+                }
+                std::size_t total = offset[blocks];
+                if (total == n) {
+                    return 0;
+                }
+
+                Storage fresh;
+                fresh.resize(total);
+                pool.parallelFor(blocks, 1, [&](std::size_t first, std::size_t last) {
+                    for (std::size_t b = first; b < last; ++b) {
+                        std::size_t end = std::min(n, (b + 1) * COMPACT_BLOCK);
+                        std::size_t out = offset[b];
+                        for (std::size_t i = b * COMPACT_BLOCK; i < end; ++i) {
+                            if (!drop[i]) {
+                                fresh[out++] = data[i];
+                            }
+                        }
+                    }
+                });
+                data = std::move(fresh);
+                return n - total;
+            }
+
+            /**
+             * @brief Remove the elements matching pred, keeping the order of the
+             *        others; in parallel (compactParallel) for large containers.
+             *        The sorted index is left to the caller.
+             *
+             * @return std::size_t  Number of elements removed.
+             */
+            template<typename Pred>
+            std::size_t eraseMatching(Pred& pred) {
+                if constexpr (HasEraseIf<Storage>::value) {
+                    return data.eraseIf(pred);
+                } else {
+                    if constexpr (HasResize<Storage>::value && std::is_default_constructible<T>::value) {
+                        if (data.size() >= parallel_remove_threshold) {
+                            return compactParallel(pred);
+                        }
+                    }
+                    auto newEnd = std::remove_if(data.begin(), data.end(),
+                                                 [&pred](const T& value) { return pred(value); });
+                    std::size_t removed = static_cast<std::size_t>(data.end() - newEnd);
+                    if (removed > 0) {
+                        data.erase(newEnd, data.end());
+                    }
+                    return removed;
+                }
+            }
+
+            /**
+             * @brief A new container holding the result of op on this and
+             *        other, in ascending order (see set_operation).
+             *
+             * Two clean vector runs are combined by setOperationSorted in one
+             * tight loop; other runs (a delta, the tree) through a
+             * SetOperationIterator. The result is already sorted, so its
+             * sorted index is the result itself and never sorted again.
+             * Counted storage combines the counts of each distinct value
+             * instead (see combineCounted).
+             */
+            MyContainer combine(SetOperation op, const MyContainer& other) const {
+                if constexpr (HasCountedRun<Storage>::value) {
+                    return combineCounted(op, other);
+                }
+                SortedRuns<T, ScratchAlloc> left = sortedRuns();
+                SortedRuns<T, ScratchAlloc> right = other.sortedRuns();
+                SortedData values;
+                if (left.baseRun() && right.baseRun() && left.delta().empty() && right.delta().empty()) {
+                    setOperationSorted(op, *left.baseRun(), *right.baseRun(), values);
+                } else {
+                    SetOperationView<T, ScratchAlloc> view(op, std::move(left), std::move(right));
+                    for (const T& value : view) {
+                        values.push_back(value);
+                    }
+                }
+                MyContainer result;
+                for (const T& value : values) {
+                    result.data.push_back(value);
+                }
+                if (!values.empty()) {
+                    result.low = values.front();
+                    result.high = values.back();
+                }
+                result.sorted = baseIndex(std::make_shared<const SortedData>(std::move(values)));
+                return result;
+            }
+
+            /**
+             * @brief combine() for counted storage: one pass over the distinct
+             *        values of both counted runs, appending each result value
+             *        with its number of copies at once. O(d1 + d2 + n) with the
+             *        n ids of the result; no element is expanded and no sorted
+             *        index is built (counted storage reads its own run).
+             */
+            MyContainer combineCounted(SetOperation op, const MyContainer& other) const {
+                MyContainer result;
+                if constexpr (HasCountedRun<Storage>::value) {
+                    std::shared_ptr<const CountedRun<T>> l = data.countedRun();
+                    std::shared_ptr<const CountedRun<T>> r = other.data.countedRun();
+                    auto copiesOf = [](const CountedRun<T>& run, std::size_t slot) {
+                        return run.ends[slot] - run.firstRank(slot);
+                    };
+                    auto emit = [&result](const T& value, std::size_t copies) {
+                        if (copies == 0) {
+                            return;
+                        }
+                        result.data.append(value, copies);
+                        if (!result.low) {
+                            result.low = value;
+                        }
+                        result.high = value;
+                    };
+                    std::size_t i = 0;
+                    std::size_t j = 0;
+                    while (i < l->values.size() || j < r->values.size()) {
+                        bool take_left = j == r->values.size()
+                            || (i < l->values.size() && !(r->values[j] < l->values[i]));
+                        bool take_right = i == l->values.size()
+                            || (j < r->values.size() && !(l->values[i] < r->values[j]));
+                        std::size_t m = take_left ? copiesOf(*l, i) : 0;
+                        std::size_t k = take_right ? copiesOf(*r, j) : 0;
+                        const T& value = take_left ? l->values[i] : r->values[j];
+                        switch (op) {
+                        case SetOperation::Merge:
+                            emit(value, m + k);
+                            break;
+                        case SetOperation::Union:
+                            emit(value, std::max(m, k));
+                            break;
+                        case SetOperation::Intersection:
+                            emit(value, std::min(m, k));
+                            break;
+                        case SetOperation::Difference:
+                            emit(value, m > k ? m - k : 0);
+                            break;
+                        }
+                        i += take_left ? 1 : 0;
+                        j += take_right ? 1 : 0;
+                    }
+                } else {
+                    (void)op;
+                    (void)other;
+                }
+                return result;
+            }
+
         public:
-            MyContainer() : data{} {}
+            /**
+             * @brief Containers of at least this many elements remove in parallel
+             *        (vector and mmap storage; segmented storage always compacts
+             *        serially).
+             */
+            static inline std::size_t parallel_remove_threshold = std::size_t(1) << 20;
+
+            /**
+             * @brief Containers of at least this many elements build their sorted
+             *        cache with parallelSort on defaultPool().
+             */
+            static inline std::size_t parallel_sort_threshold = std::size_t(1) << 20;
+
+            /**
+             * @brief Sorted queries merge the delta run of recent appends into
+             *        the sorted base once it holds more than this many elements;
+             *        below that the sorted iterators merge the two on the fly.
+             */
+            static inline std::size_t delta_merge_threshold = std::size_t(1) << 12;
+
+            MyContainer() : data{}, sorted{}, background_sort(false), rebuild{},
+                            search_accelerator(false), tree_index(false), tree{}, low{}, high{} {}
+
+            /// Copies share the source's sorted index (read atomically, see
+            /// currentIndex()) and get their own background rebuild slot.
+            MyContainer(const MyContainer& other)
+                : data(other.data), sorted(std::atomic_load(&other.sorted)),
+                  background_sort(other.background_sort),
+                  rebuild(other.background_sort ? std::make_shared<Rebuild>() : nullptr),
+                  search_accelerator(other.search_accelerator), tree_index(other.tree_index), tree(other.tree),
+                  low(other.low), high(other.high) {}
+
+            MyContainer(MyContainer&& other) noexcept = default;
+
+            MyContainer& operator=(const MyContainer& other) {
+                if (this != &other) {
+                    data = other.data;
+                    sorted = std::atomic_load(&other.sorted);
+                    background_sort = other.background_sort;
+                    rebuild = other.background_sort ? std::make_shared<Rebuild>() : nullptr;
+                    search_accelerator = other.search_accelerator;
+                    tree_index = other.tree_index;
+                    tree = other.tree;
+                    low = other.low;
+                    high = other.high;
+                }
+                return *this;
+            }
+
+            MyContainer& operator=(MyContainer&& other) noexcept = default;
 
             ~MyContainer() = default;
 
+            /// Appends leave the sorted index alone; the next sorted query
+            /// sorts only the new elements into its delta run. With the tree
+            /// index on, value is inserted into the tree instead (O(log n)).
+            /// min() and max() are updated in O(1).
             void addElement(const T& value){
                 data.push_back(value);
+                if (tree_index) {
+                    try {
+                        tree.insert(value);
+                    } catch (...) {
+                        data.pop_back();
+                        throw;
+                    }
+                    sorted.reset();
+                }
+                noteAdded(value);
+            }
+
+            /**
+             * @brief Append every value of [first, last) in one batch.
+             *
+             * The storage is reserved once (for forward iterators), the values
+             * are pushed straight into it and, with the tree index on, inserted
+             * into the tree afterwards with one reset of the sorted index. Like
+             * addElement, the next sorted query sorts them into its delta run.
+             * If an element cannot be stored, the batch is undone and nothing
+             * is appended.
+             */
+            template<typename InputIt>
+            void addElements(InputIt first, InputIt last) {
+                std::size_t before = data.size();
+                std::size_t inserted = 0;
+                try {
+                    using Category = typename std::iterator_traits<InputIt>::iterator_category;
+                    if constexpr (std::is_base_of<std::forward_iterator_tag, Category>::value) {
+                        data.reserve(before + static_cast<std::size_t>(std::distance(first, last)));
+                    }
+                    for (; first != last; ++first) {
+                        const T& value = *first;
+                        data.push_back(value);
+                        noteAdded(value);
+                    }
+                    if (tree_index) {
+                        for (std::size_t i = before; i < data.size(); ++i, ++inserted) {
+                            tree.insert(data[i]);
+                        }
+                        sorted.reset();
+                    }
+                } catch (...) {
+                    for (std::size_t i = before; i < before + inserted; ++i) {
+                        tree.eraseAt(tree.lowerRank(data[i]));
+                    }
+                    while (data.size() > before) {
+                        data.pop_back();
+                    }
+                    low.reset(); // unknown: min() and max() look them up
+                    high.reset();
+                    throw;
+                }
+            }
+
+            /**
+             * @brief Reserve storage for n elements in total, so that appends up
+             *        to that size do not grow it step by step.
+             */
+            void reserve(std::size_t n) {
+                data.reserve(n);
+            }
+
+            /**
+             * @brief Merge the delta run of recent appends into the sorted base
+             *        on a background worker instead of the query thread.
+             *
+             * With the option on, a sorted query that finds a delta queues the
+             * merge of base and delta on defaultPool() and reads both runs,
+             * merged on the fly, until a later query adopts the merged base.
+             * Deletion markers are still merged on the query thread.
+             *
+             * @param enabled  true to turn the option on, false to go back to
+             *                 rebuilding on the query thread.
+             */
+            void setBackgroundSort(bool enabled) {
+                if (enabled == background_sort) {
+                    return;
+                }
+                background_sort = enabled;
+                rebuild = enabled ? std::make_shared<Rebuild>() : nullptr;
+            }
+
+            bool backgroundSort() const noexcept {
+                return background_sort;
+            }
+
+            /**
+             * @brief Keep the elements in an order-statistic B+-tree as well,
+             *        for workloads that interleave single updates and sorted reads.
+             *
+             * While enabled, addElement and remove update the tree in O(log n),
+             * the sorted iterators walk a snapshot of it leaf by leaf and
+             * kthSmallest() descends it in O(log n); nothing is sorted or merged
+             * per query. removeIf and the load functions rebuild it.
+             *
+             * @param enabled  true to build the tree, false to drop it.
+             */
+            void setTreeIndex(bool enabled) {
+                if (enabled == tree_index) {
+                    return;
+                }
+                if (enabled) {
+                    std::shared_ptr<const SortedData> values = sortedData();
+                    tree = OrderStatisticTree<T>::fromSorted(values->begin(), values->end());
+                } else {
+                    tree = OrderStatisticTree<T>();
+                }
+                tree_index = enabled;
+            }
+
+            bool treeIndex() const noexcept {
+                return tree_index;
+            }
+
+            /**
+             * @brief Keep an Eytzinger (breadth-first) copy of the sorted base
+             *        for contains, count and the range seeks.
+             *
+             * Binary search over a large sorted array misses the cache on almost
+             * every step; the Eytzinger layout keeps the top of the search in a
+             * few cache lines and prefetches the rest. The layout is built with
+             * the sorted base (one extra copy of the elements, O(n)) and rebuilt
+             * whenever the base is. Not used with the tree index.
+             *
+             * @param enabled  true to build the layout with the next sorted base.
+             */
+            void setSearchAccelerator(bool enabled) {
+                search_accelerator = enabled;
+            }
+
+            bool searchAccelerator() const noexcept {
+                return search_accelerator;
+            }
+
+            /**
+             * @brief Whether some element equals value. O(log n) on the sorted
+             *        index, O(log d) with counted storage.
+             */
+            bool contains(const T& value) const {
+                if constexpr (HasCountedRun<Storage>::value) {
+                    return data.count(value) > 0;
+                }
+                return sortedRuns().contains(value);
+            }
+
+            /**
+             * @brief Number of elements equal to value. O(log n) on the sorted
+             *        index, O(log d) with counted storage.
+             */
+            std::size_t count(const T& value) const {
+                if constexpr (HasCountedRun<Storage>::value) {
+                    return data.count(value);
+                }
+                SortedRuns<T, ScratchAlloc> runs = sortedRuns();
+                typename SortedRuns<T, ScratchAlloc>::Cursor first = runs.lowerBound(value);
+                typename SortedRuns<T, ScratchAlloc>::Cursor last = runs.upperBound(value);
+                return (last.base + last.delta) - (first.base + first.delta);
+            }
+
+            /**
+             * @brief Number of copies of value; the same as count(). O(log n).
+             */
+            std::size_t count_of(const T& value) const {
+                return count(value);
+            }
+
+            /**
+             * @brief The distinct values in ascending order, each once, read
+             *        from the sorted index (no extra sort, no map).
+             *
+             * Each value costs O(min(copies, log n)); the iterator's count()
+             * gives the number of copies. The view keeps the sorted runs it
+             * was made from, so later modifications do not show through it.
+             */
+            DistinctView<T, ScratchAlloc> distinct_ascending() const {
+                return DistinctView<T, ScratchAlloc>(sortedRuns());
+            }
+
+            /**
+             * @brief The value distribution as (value, count) pairs in ascending
+             *        order of value, read from the sorted index like
+             *        distinct_ascending().
+             */
+            HistogramView<T, ScratchAlloc> histogram() const {
+                return HistogramView<T, ScratchAlloc>(sortedRuns());
+            }
+
+            /**
+             * @brief The result of op on this container (left) and other, in
+             *        ascending order, computed lazily from both sorted indexes
+             *        in one linear pass (see SetOperationIterator).
+             *
+             * The view keeps the sorted runs it was made from, so later
+             * modifications of either container do not show through it.
+             */
+            SetOperationView<T, ScratchAlloc> set_operation(SetOperation op, const MyContainer& other) const {
+                return SetOperationView<T, ScratchAlloc>(op, sortedRuns(), other.sortedRuns());
+            }
+
+            /**
+             * @brief A new container with the elements of both (each value
+             *        m + k times), in ascending order. O(n + m) on the sorted
+             *        indexes; the result's sorted index is built from the same pass.
+             */
+            MyContainer merge(const MyContainer& other) const {
+                return combine(SetOperation::Merge, other);
+            }
+
+            /**
+             * @brief A new container with each value max(m, k) times, in
+             *        ascending order. Cost as merge().
+             */
+            MyContainer set_union(const MyContainer& other) const {
+                return combine(SetOperation::Union, other);
+            }
+
+            /**
+             * @brief A new container with each value min(m, k) times, in
+             *        ascending order. Cost as merge(), or O(small log large)
+             *        for containers of very different sizes.
+             */
+            MyContainer set_intersection(const MyContainer& other) const {
+                return combine(SetOperation::Intersection, other);
+            }
+
+            /**
+             * @brief A new container with each value of this one max(m - k, 0)
+             *        times, in ascending order. Cost as merge().
+             */
+            MyContainer set_difference(const MyContainer& other) const {
+                return combine(SetOperation::Difference, other);
+            }
+
+            /**
+             * @brief Sort-merge join with other: every (left, right) pair of
+             *        elements whose keys are equal, streamed in ascending key
+             *        order from both sorted indexes (see JoinIterator).
+             *
+             * Duplicates on both sides give every combination, one pair at a
+             * time; nothing is hashed or materialized. O(n + m + pairs).
+             * The keys must not go down along the ascending order of each
+             * container (e.g. the first field operator< compares); both
+             * sides are checked first, in O(n + m).
+             *
+             * @param other      Right side (any element type).
+             * @param left_key   Projection of this container's elements (callable
+             *                   or member pointer).
+             * @param right_key  Projection of other's elements.
+             * @throws std::runtime_error if a key goes down on either side
+             *         (before any pair is produced).
+             */
+            template<typename U, typename S, typename KeyL, typename KeyR>
+            JoinView<T, ScratchAlloc, U, typename MyContainer<U, S>::ScratchAlloc, KeyL, KeyR>
+            join(const MyContainer<U, S>& other, KeyL left_key, KeyR right_key) const {
+                return JoinView<T, ScratchAlloc, U, typename MyContainer<U, S>::ScratchAlloc, KeyL, KeyR>(
+                    sortedRuns(), other.sortedRuns(), std::move(left_key), std::move(right_key));
+            }
+
+            /// Join with the same projection on both sides.
+            template<typename U, typename S, typename Key>
+            JoinView<T, ScratchAlloc, U, typename MyContainer<U, S>::ScratchAlloc, Key, Key>
+            join(const MyContainer<U, S>& other, Key key) const {
+                return join(other, key, key);
+            }
+
+            /// Join on the elements themselves.
+            template<typename U, typename S>
+            JoinView<T, ScratchAlloc, U, typename MyContainer<U, S>::ScratchAlloc, IdentityKey, IdentityKey>
+            join(const MyContainer<U, S>& other) const {
+                return join(other, IdentityKey{}, IdentityKey{});
+            }
+
+            /**
+             * @brief Wait until no background merge is pending and adopt its
+             *        result (no-op with background sort off).
+             */
+            void waitForBackgroundSort() const {
+                std::shared_ptr<Rebuild> slot = rebuild;
+                if (!slot) {
+                    return;
+                }
+                std::unique_lock<std::mutex> guard(slot->lock);
+                slot->done.wait(guard, [&slot]() { return !slot->pending; });
+                std::shared_ptr<const SortedIndex> index = std::atomic_load(&sorted);
+                if (index) {
+                    adoptRebuild(std::move(index));
+                }
             }
 
             void remove(const T& value){
                 if (this->size() == 0 )
                     throw std::runtime_error("Container is empty");
                 
-                auto newEnd = std::remove(data.begin(), data.end(), value); // logicly moves all elemets that are not value to the start of the vector.
-                                                                            // and returns an iterator that points to where the removal values starts.
-                if (newEnd == data.end()) {
+                // moves all elements that are not value to the front, in order (in parallel above
+                // parallel_remove_threshold), and drops the rest.
+                auto matches = [&value](const T& element) { return element == value; };
+                if (eraseMatching(matches) == 0) {
                     throw std::runtime_error("Value to remove not found in container");
                 }
-                data.erase(newEnd, data.end());
+                // the sorted index keeps its base and records a deletion marker
+                if (tree_index) {
+                    tree.eraseAll(value);
+                    sorted.reset();
+                } else if (sorted && !HasCountedRun<Storage>::value) { // counted storage reads its own run
+                    sorted = withoutValue(*sorted, value);
+                }
+                // one more pass only when an extreme itself was removed
+                if (!low || *low == value || *high == value) {
+                    findExtremes();
+                }
+            }
+
+            /**
+             * @brief Remove every element for which pred returns true, keeping
+             *        the order of the others.
+             *
+             * Above parallel_remove_threshold elements the compaction runs in
+             * parallel on defaultPool(); pred is then called concurrently (once
+             * per element), so it must be safe to call from several threads.
+             *
+             * @param pred  Callable taking const T&, returning bool.
+             * @return std::size_t  Number of elements removed (0 is not an error).
+             */
+            template<typename Pred>
+            std::size_t removeIf(Pred pred){
+                std::size_t removed = eraseMatching(pred);
+                if (removed > 0) {
+                    contentsChanged();
+                }
+                return removed;
             }
 
             size_t size() const noexcept{
                 return data.size();
             }
 
-            friend std::ostream& operator<<(std::ostream& os, const MyContainer<T>& c){
-                if (c.size() == 0)
-                {
-                    os << "[]";
-                    return os;
+            /**
+             * @brief The k-th smallest element (k = 0 is the smallest).
+             *
+             * O(log n) with the tree index; otherwise a binary search over the
+             * runs of the sorted index (brought up to date first).
+             *
+             * @throws std::out_of_range if k >= size().
+             */
+            T kthSmallest(std::size_t k) const {
+                if (k >= data.size()) {
+                    throw std::out_of_range("Position is out of bounds");
                 }
-                os << "[";
-                for (size_t i = 0; i < c.data.size(); ++i) {
-                    os << c.data[i];
-                    if (i + 1 < c.data.size()) os << ", ";
+                if (tree_index) {
+                    return tree.kth(k);
                 }
-                os << "]";
+                SortedRuns<T, ScratchAlloc> runs = sortedRuns();
+                return runs.next(runs.split(k));
+            }
+
+            /**
+             * @brief The smallest element. O(1): kept up to date by every
+             *        modification (looked up once after mapFile).
+             *
+             * @throws std::runtime_error if the container is empty.
+             */
+            T min() const {
+                return extreme(false);
+            }
+
+            /**
+             * @brief The largest element. O(1), as min().
+             *
+             * @throws std::runtime_error if the container is empty.
+             */
+            T max() const {
+                return extreme(true);
+            }
+
+            /**
+             * @brief The k-th smallest element (k = 0 is the smallest), without
+             *        sorting when there is nothing sorted yet.
+             *
+             * With a sorted index (or the tree index, counted storage, or a
+             * mapped file's sorted permutation) this is a lookup: O(1) on a clean
+             * index, O(log n) with a delta run or the tree, O(log d) on counted
+             * storage's run of d distinct values. Otherwise the element is selected
+             * with std::nth_element on a scratch copy in O(n) and no index is
+             * built; use kthSmallest() to build one for repeated queries.
+             *
+             * @throws std::out_of_range if k >= size().
+             */
+            T nth(std::size_t k) const {
+                if (k >= data.size()) {
+                    throw std::out_of_range("Position is out of bounds");
+                }
+                if (tree_index || HasCountedRun<Storage>::value || std::atomic_load(&sorted)) {
+                    return kthSmallest(k);
+                }
+                if constexpr (HasSortedPermutation<Storage>::value) {
+                    const std::uint64_t* perm = data.sortedPermutation();
+                    if (perm != nullptr && perm[k] < data.size()) {
+                        return data[static_cast<std::size_t>(perm[k])];
+                    }
+                }
+                SortedData scratch(data.begin(), data.end());
+                std::nth_element(scratch.begin(), scratch.begin() + static_cast<std::ptrdiff_t>(k), scratch.end());
+                return scratch[k];
+            }
+
+            /**
+             * @brief The median: the lower of the two middle elements when the
+             *        size is even (T need not support averaging). Cost as nth().
+             *
+             * @throws std::runtime_error if the container is empty.
+             */
+            T median() const {
+                if (data.size() == 0) {
+                    throw std::runtime_error("Container is empty");
+                }
+                return nth((data.size() - 1) / 2);
+            }
+
+            /**
+             * @brief The p-th percentile by the nearest-rank method: the
+             *        smallest element not below p percent of the elements
+             *        (p = 0 gives min(), p = 100 gives max()). Cost as nth().
+             *
+             * @param p  Percentile in [0, 100].
+             * @throws std::out_of_range if p is outside [0, 100].
+             * @throws std::runtime_error if the container is empty.
+             */
+            T percentile(double p) const {
+                if (std::isnan(p) || p < 0 || p > 100) {
+                    throw std::out_of_range("Percentile is out of range");
+                }
+                if (data.size() == 0) {
+                    throw std::runtime_error("Container is empty");
+                }
+                std::size_t n = data.size();
+                std::size_t rank = static_cast<std::size_t>(std::ceil(p / 100 * static_cast<double>(n)));
+                return nth(rank == 0 ? 0 : std::min(rank, n) - 1);
+            }
+
+            /**
+             * @brief The element the Middle-Out order starts from (position
+             *        size() / 2 in insertion order). O(1), no iterator copy.
+             *
+             * @throws std::runtime_error if the container is empty.
+             */
+            T middle() const {
+                if (data.size() == 0) {
+                    throw std::runtime_error("Container is empty");
+                }
+                return data[middleOutIndex(0, data.size())];
+            }
+
+            /**
+             * @brief The k largest elements, largest first (the first k of the
+             *        descending order; all elements if k >= size()).
+             *
+             * Read from the sorted index when there is one, in O(k); otherwise
+             * selected in one pass with a bounded heap, O(n log k) time and
+             * O(k) memory, without sorting or building an index.
+             */
+            std::vector<T> top_k(std::size_t k) const {
+                return firstInOrder(k, true);
+            }
+
+            /**
+             * @brief The k smallest elements, smallest first. Cost as top_k().
+             */
+            std::vector<T> bottom_k(std::size_t k) const {
+                return firstInOrder(k, false);
+            }
+
+            /**
+             * @brief The elements in ascending order, shared with the sorted
+             *        iterators (sorted on first use after a modification).
+             *
+             * The vector stays valid and unchanged for as long as it is held,
+             * even if the container is modified or destroyed.
+             */
+            std::shared_ptr<const std::vector<T, ScratchAlloc>> sortedView() const {
+                return sortedData();
+            }
+
+            /**
+             * @brief Print the elements in insertion order as "[a, b, c]" or "[]".
+             *
+             * Numeric elements take the buffered std::to_chars path of
+             * formatList; the output is the same as inserting each element.
+             */
+            friend std::ostream& operator<<(std::ostream& os, const MyContainer<T, Storage>& c){
+                formatList<T>(os, c.data.size(), [&c](std::size_t i) -> decltype(auto) { return c.data[i]; });
                 return os;
             }
 
-            OrderIterator<T> begin_order () const {
+            /**
+             * @brief Print the elements as "[a, b, c]" in any of the six orders.
+             *
+             * The elements are streamed straight from the container: the
+             * sorted orders walk the sorted runs with cursors, as the sorted
+             * iterators do (the base and delta of the index, the tree, or the
+             * counts of counted storage, which are never expanded), the
+             * others index the insertion order. No reordered copy is made and
+             * the output goes through the bounded buffer of ListWriter.
+             *
+             * @param os     Stream to print to.
+             * @param order  Traversal order.
+             */
+            void print(std::ostream& os, Order order) const {
+                std::size_t n = data.size();
+                auto list = [&os, n](auto get) { formatList<T>(os, n, get); };
+                switch (order) {
+                    case Order::Insertion:
+                        list([this](std::size_t i) -> decltype(auto) { return data[i]; });
+                        break;
+                    case Order::Reverse:
+                        list([this, n](std::size_t i) -> decltype(auto) { return data[n - 1 - i]; });
+                        break;
+                    case Order::MiddleOut:
+                        list([this, n](std::size_t i) -> decltype(auto) { return data[middleOutIndex(i, n)]; });
+                        break;
+                    case Order::Ascending:
+                    case Order::Descending:
+                    case Order::SideCross: {
+                        // formatList asks for the positions in turn: the front
+                        // cursor moves forwards, the back cursor backwards
+                        SortedRuns<T, ScratchAlloc> runs = sortedRuns();
+                        using Cursor = typename SortedRuns<T, ScratchAlloc>::Cursor;
+                        Cursor front{0, 0};
+                        Cursor back{runs.baseSize(), runs.delta().size()};
+                        auto forward = [&runs, &front]() -> const T& {
+                            const T& value = runs.next(front);
+                            runs.advance(front);
+                            return value;
+                        };
+                        auto backward = [&runs, &back]() -> const T& {
+                            const T& value = runs.previous(back);
+                            runs.retreat(back);
+                            return value;
+                        };
+                        if (order == Order::Ascending) {
+                            list([&forward](std::size_t) -> const T& { return forward(); });
+                        } else if (order == Order::Descending) {
+                            list([&backward](std::size_t) -> const T& { return backward(); });
+                        } else {
+                            list([&forward, &backward](std::size_t i) -> const T& {
+                                return i % 2 == 0 ? forward() : backward();
+                            });
+                        }
+                        break;
+                    }
+                }
+            }
+
+            /**
+             * @brief Random access to the elements in one of the six orders:
+             *        view[k] is the k-th element the order's iterator yields.
+             *
+             * The sorted orders read the shared sorted copy held by the view
+             * (with counted storage, the counted run: no expanded copy, and
+             * O(log d) per access); the others index the container's storage,
+             * so those must not be used after the container is modified.
+             */
+            class OrderView {
+                private:
+                    const Storage* elements;
+                    std::shared_ptr<const SortedData> sorted_elements;
+                    std::shared_ptr<const CountedRun<T>> counted;
+                    Order order;
+                    std::size_t count;
+
+                    /// Element of the given rank in ascending order
+                    const T& sortedAt(std::size_t rank) const {
+                        if (counted) {
+                            return counted->values[counted->slotOf(rank)];
+                        }
+                        return (*sorted_elements)[rank];
+                    }
+
+                public:
+                    OrderView(const MyContainer& c, Order o)
+                        : elements(&c.data), sorted_elements(), counted(), order(o), count(c.data.size()) {
+                        if (o == Order::Ascending || o == Order::Descending || o == Order::SideCross) {
+                            if constexpr (HasCountedRun<Storage>::value) {
+                                if (!c.tree_index) {
+                                    counted = c.data.countedRun();
+                                    return;
+                                }
+                            }
+                            sorted_elements = c.sortedData();
+                        }
+                    }
+
+                    std::size_t size() const noexcept {
+                        return count;
+                    }
+
+                    /// The k-th element in the view's order (k < size(), unchecked)
+                    const T& operator[](std::size_t k) const {
+                        switch (order) {
+                            case Order::Ascending:
+                                return sortedAt(k);
+                            case Order::Descending:
+                                return sortedAt(count - 1 - k);
+                            case Order::SideCross:
+                                return sortedAt(sideCrossIndex(k, count));
+                            case Order::Reverse:
+                                return (*elements)[count - 1 - k];
+                            case Order::MiddleOut:
+                                return (*elements)[middleOutIndex(k, count)];
+                            case Order::Insertion:
+                            default:
+                                return (*elements)[k];
+                        }
+                    }
+
+                    /**
+                     * @brief The k-th element in the view's order.
+                     *
+                     * @throws std::out_of_range if k >= size().
+                     */
+                    const T& at(std::size_t k) const {
+                        if (k >= count) {
+                            throw std::out_of_range("Position is out of bounds");
+                        }
+                        return (*this)[k];
+                    }
+            };
+
+            /**
+             * @brief Random access view of the elements in the given order
+             *        (see OrderView).
+             */
+            OrderView view(Order order) const {
+                return OrderView(*this, order);
+            }
+
+            /**
+             * @brief Serialize the container to a binary stream.
+             *
+             * Writes a FileHeader followed by the elements in insertion order:
+             * raw bytes in one bulk write for trivially copyable T, length-prefixed
+             * for std::string. Open the stream in binary mode.
+             *
+             * @param os  Stream to write to.
+             */
+            void save(std::ostream& os) const {
+                StreamSink sink{os};
+                saveTo(sink);
+            }
+
+            /**
+             * @brief Serialize the container, appending the bytes to buffer.
+             *
+             * @param buffer  Buffer to append to.
+             */
+            void save(std::vector<char>& buffer) const {
+                buffer.reserve(buffer.size() + sizeof(FileHeader) + data.size() * sizeof(T));
+                BufferSink sink{buffer};
+                saveTo(sink);
+            }
+
+            /**
+             * @brief Replace the contents with a container read by save().
+             *
+             * On error the container keeps its previous contents.
+             *
+             * @param is  Stream to read from.
+             * @throws std::runtime_error if the data is not a valid container
+             *         of T or is truncated.
+             */
+            void load(std::istream& is) {
+                StreamSource source{is};
+                loadFrom(source);
+            }
+
+            /**
+             * @brief Replace the contents with a container serialized into a buffer.
+             *
+             * @param buffer  Start of the serialized bytes.
+             * @param length  Number of bytes available.
+             * @throws std::runtime_error if the data is invalid or truncated.
+             */
+            void load(const char* buffer, std::size_t length) {
+                BufferSource source{buffer, length};
+                loadFrom(source);
+            }
+
+            /**
+             * @brief Write the container to a binary container file.
+             *
+             * The file (see FileHeader) holds the elements in insertion order
+             * and, optionally, the permutation that sorts them, so that
+             * mapFile() can serve the sorted iterators right away.
+             *
+             * @param path              File to create or overwrite.
+             * @param with_permutation  Also store the sorted permutation.
+             * @throws std::runtime_error if the file cannot be written.
+             */
+            void saveFile(const std::string& path, bool with_permutation = true) const {
+                static_assert(std::is_trivially_copyable<T>::value,
+                              "saveFile requires a trivially copyable element type");
+                std::ofstream out(path, std::ios::binary | std::ios::trunc);
+                if (!out) {
+                    throw std::runtime_error("Cannot open file: " + path);
+                }
+                FileHeader header = FileHeader::make(sizeof(T), data.size(), with_permutation);
+                out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                StreamSink sink{out};
+                writeElements(sink);
+                if (with_permutation) {
+                    std::uint64_t written = header.data_offset + data.size() * sizeof(T);
+                    static const char zeros[8] = {};
+                    out.write(zeros, static_cast<std::streamsize>(header.permutation_offset - written));
+
+                    std::vector<std::uint64_t> perm(data.size());
+                    std::iota(perm.begin(), perm.end(), std::uint64_t(0));
+                    std::stable_sort(perm.begin(), perm.end(), [this](std::uint64_t a, std::uint64_t b) {
+                        return data[a] < data[b];
+                    });
+                    out.write(reinterpret_cast<const char*>(perm.data()),
+                              static_cast<std::streamsize>(perm.size() * sizeof(std::uint64_t)));
+                }
+                if (!out) {
+                    throw std::runtime_error("Failed to write file: " + path);
+                }
+            }
+
+            /**
+             * @brief Open a container file written by saveFile() without copying it.
+             *
+             * The file is mapped privately and the returned container reads its
+             * elements straight from the mapping (modifications stay in memory).
+             * If the file holds a sorted permutation, the sorted iterators use
+             * it instead of sorting.
+             *
+             * @param path  Container file to map.
+             * @return MyContainer<T, MmapStorage<T>>  Container over the mapping.
+             * @throws std::runtime_error if the file is missing or invalid.
+             */
+            static MyContainer<T, MmapStorage<T>> mapFile(const std::string& path) {
+                std::size_t length = 0;
+                void* base = mapWholeFile(path, length);
+                FileHeader header;
+                std::memcpy(&header, base, sizeof(header));
+                try {
+                    header.validate(sizeof(T), length);
+                    if (header.data_offset % alignof(T) != 0) {
+                        throw std::runtime_error("Container file data is misaligned");
+                    }
+                } catch (...) {
+                    ::munmap(base, length);
+                    throw;
+                }
+                const std::uint64_t* perm = nullptr;
+                if (header.flags & FileHeader::HAS_PERMUTATION) {
+                    perm = reinterpret_cast<const std::uint64_t*>(
+                        static_cast<const char*>(base) + header.permutation_offset);
+                }
+                MyContainer<T, MmapStorage<T>> result;
+                result.data = MmapStorage<T>(base, length, header.data_offset, header.count, perm);
+                return result;
+            }
+
+            /**
+             * @brief Read a container in the "[a, b, c]" format of operator<<.
+             *
+             * Replaces the contents of c. Values are separated by commas and
+             * trimmed of surrounding whitespace; numbers are parsed with
+             * std::from_chars. On a malformed list the stream's failbit is set
+             * and c is left unchanged.
+             */
+            friend std::istream& operator>>(std::istream& is, MyContainer<T, Storage>& c){
+                char open = 0;
+                if (!(is >> open) || open != '[') {
+                    is.setstate(std::ios::failbit);
+                    return is;
+                }
+                std::string body;
+                std::getline(is, body, ']');
+                if (is.eof()) { // no closing bracket
+                    is.setstate(std::ios::failbit);
+                    return is;
+                }
+                Storage fresh;
+                fresh.reserve(static_cast<std::size_t>(std::count(body.begin(), body.end(), ',')) + 1);
+                if (!parseBracketBody<T>(body, [&fresh](const T& v) { fresh.push_back(v); })) {
+                    is.setstate(std::ios::failbit);
+                    return is;
+                }
+                c.data = std::move(fresh);
+                c.contentsChanged();
+                return is;
+            }
+
+            /**
+             * @brief Append every value of a whitespace- and/or comma-separated
+             *        text stream (e.g. a CSV column or a dump with one value per line).
+             *
+             * The stream is read in 1 MB chunks and numbers are parsed in place
+             * with std::from_chars. For seekable streams the storage is reserved
+             * once from the density of the first chunk.
+             *
+             * @param is  Stream to read until its end.
+             * @return std::size_t  Number of values appended.
+             * @throws std::runtime_error on a value that does not parse; the
+             *         values before it stay appended.
+             */
+            std::size_t loadText(std::istream& is) {
+                std::size_t before = data.size();
+                return parseDelimited<T>(is,
+                    [this](const T& v) { addElement(v); },
+                    [this, before](std::size_t estimate) { data.reserve(before + estimate); });
+            }
+
+            OrderIterator<T, Storage> begin_order () const {
                 return OrderIterator(this, 0);
             }
             
-            OrderIterator<T> end_order () const {
+            OrderIterator<T, Storage> end_order () const {
                 return OrderIterator(this, data.size());
             }
 
-            AscendingOrderIterator<T> begin_ascending_order () const{
-                return AscendingOrderIterator(data,0);
+            AscendingOrderIterator<T, ScratchAlloc> begin_ascending_order () const{
+                return AscendingOrderIterator<T, ScratchAlloc>(sortedRuns(),0);
             }
 
-            AscendingOrderIterator<T> end_ascending_order () const{
-                return AscendingOrderIterator(data,data.size());
+            AscendingOrderIterator<T, ScratchAlloc> end_ascending_order () const{
+                return AscendingOrderIterator<T, ScratchAlloc>(SortedRuns<T, ScratchAlloc>(),data.size());
             }
 
-            DescendingOrderIterator<T> begin_descending_order () const {
-                return DescendingOrderIterator(data,0);
+            DescendingOrderIterator<T, ScratchAlloc> begin_descending_order () const {
+                return DescendingOrderIterator<T, ScratchAlloc>(sortedRuns(),0);
             }
 
-            DescendingOrderIterator<T> end_descending_order () const{
-                return DescendingOrderIterator(data,data.size());
+            DescendingOrderIterator<T, ScratchAlloc> end_descending_order () const{
+                return DescendingOrderIterator<T, ScratchAlloc>(SortedRuns<T, ScratchAlloc>(),data.size());
             }
 
-            SideCrossOrderIterator<T> begin_side_cross_order () const{
-                return SideCrossOrderIterator(data,0);
+            SideCrossOrderIterator<T, ScratchAlloc> begin_side_cross_order () const{
+                return SideCrossOrderIterator<T, ScratchAlloc>(sortedRuns(),0);
             }
 
-            SideCrossOrderIterator<T> end_side_cross_order () const{
-                return SideCrossOrderIterator(data,data.size());
+            SideCrossOrderIterator<T, ScratchAlloc> end_side_cross_order () const{
+                return SideCrossOrderIterator<T, ScratchAlloc>(SortedRuns<T, ScratchAlloc>(),data.size());
             }
 
-            ReverseOrderIterator<T> begin_reverse_order () const{
-                return ReverseOrderIterator(data,0);
+            /**
+             * @brief Ascending iterator at the first element not less than value
+             *        (like std::lower_bound); iterate up to end_ascending_order().
+             *
+             * The seek is a binary search of the sorted index, so reading the
+             * k elements of a range costs O(log n + k) once the index is up to date.
+             */
+            AscendingOrderIterator<T, ScratchAlloc> begin_ascending_order_from (const T& value) const{
+                SortedRuns<T, ScratchAlloc> runs = sortedRuns();
+                typename SortedRuns<T, ScratchAlloc>::Cursor at = runs.lowerBound(value);
+                return AscendingOrderIterator<T, ScratchAlloc>(std::move(runs), at);
             }
 
-            ReverseOrderIterator<T> end_reverse_order () const{
-                return ReverseOrderIterator(data,data.size());
+            /**
+             * @brief Descending iterator at the last element not greater than
+             *        value; iterate up to end_descending_order(). O(log n) seek.
+             */
+            DescendingOrderIterator<T, ScratchAlloc> begin_descending_order_from (const T& value) const{
+                SortedRuns<T, ScratchAlloc> runs = sortedRuns();
+                typename SortedRuns<T, ScratchAlloc>::Cursor at = runs.upperBound(value);
+                return DescendingOrderIterator<T, ScratchAlloc>(std::move(runs), at);
             }
 
+            /**
+             * @brief The elements equal to value, as a pair of ascending
+             *        iterators [first, last) (like std::equal_range). O(log n) seek.
+             */
+            std::pair<AscendingOrderIterator<T, ScratchAlloc>, AscendingOrderIterator<T, ScratchAlloc>>
+            equal_range (const T& value) const{
+                SortedRuns<T, ScratchAlloc> runs = sortedRuns();
+                typename SortedRuns<T, ScratchAlloc>::Cursor first = runs.lowerBound(value);
+                typename SortedRuns<T, ScratchAlloc>::Cursor last = runs.upperBound(value);
+                return {AscendingOrderIterator<T, ScratchAlloc>(runs, first),
+                        AscendingOrderIterator<T, ScratchAlloc>(std::move(runs), last)};
+            }
 
-            MiddleOutOrderIterator<T> begin_middle_out_order () const {
-                return MiddleOutOrderIterator(data,0);
+            /**
+             * @brief Ascending traversal that sorts only as far as it is read
+             *        (see PartialSortIterator): the first m elements cost
+             *        O(n + m log m). No sorted index is built or used.
+             */
+            PartialSortIterator<T, ScratchAlloc> begin_partial_ascending_order () const{
+                return PartialSortIterator<T, ScratchAlloc>(copyData(), 0);
             }
 
-            MiddleOutOrderIterator<T> end_middle_out_order () const{
-                return MiddleOutOrderIterator(data,data.size());
+            PartialSortIterator<T, ScratchAlloc> end_partial_ascending_order () const{
+                return PartialSortIterator<T, ScratchAlloc>(std::vector<T, ScratchAlloc>(), data.size());
+            }
+
+            /**
+             * @brief Descending traversal that sorts only as far as it is read,
+             *        for readers of the first few largest elements.
+             */
+            PartialSortIterator<T, ScratchAlloc, true> begin_partial_descending_order () const{
+                return PartialSortIterator<T, ScratchAlloc, true>(copyData(), 0);
+            }
+
+            PartialSortIterator<T, ScratchAlloc, true> end_partial_descending_order () const{
+                return PartialSortIterator<T, ScratchAlloc, true>(std::vector<T, ScratchAlloc>(), data.size());
+            }
+
+            ReverseOrderIterator<T, ScratchAlloc> begin_reverse_order () const{
+                return ReverseOrderIterator(copyData(),0);
+            }
+
+            ReverseOrderIterator<T, ScratchAlloc> end_reverse_order () const{
+                return ReverseOrderIterator(copyData(),data.size());
+            }
+
+
+            MiddleOutOrderIterator<T, ScratchAlloc> begin_middle_out_order () const {
+                return MiddleOutOrderIterator(copyData(),0);
+            }
+
+            MiddleOutOrderIterator<T, ScratchAlloc> end_middle_out_order () const{
+                return MiddleOutOrderIterator(copyData(),data.size());
             }
 
 
     };
 
+    /// MyContainer whose elements live in fixed-size chunks (no regrowth copies).
+    template<typename T = int>
+    using SegmentedContainer = MyContainer<T, SegmentedStorage<T>>;
+
+    /// MyContainer that stores each distinct value once, with a count and an id log.
+    template<typename T = int>
+    using CountedContainer = MyContainer<T, CountedStorage<T>>;
+
+    /// MyContainer whose elements and sort scratch buffers live in huge-page mmap regions.
+    template<typename T = int>
+    using MmapContainer = MyContainer<T, MmapStorage<T>>;
 
 };
 
@@ -0,0 +1,52 @@
+//dor.cohen15@msmail.ariel.ac.il
+
+#pragma once
+
+#include <cstddef>     // for std::size_t
+
+namespace ariel {
+
+/**
+ * @brief The six traversal orders of MyContainer, one per iterator type.
+ */
+enum class Order {
+    Insertion,   ///< OrderIterator
+    Ascending,   ///< AscendingOrderIterator
+    Descending,  ///< DescendingOrderIterator
+    SideCross,   ///< SideCrossOrderIterator
+    Reverse,     ///< ReverseOrderIterator
+    MiddleOut    ///< MiddleOutOrderIterator
+};
+
+/**
+ * @brief Position in the ascending sorted elements of the k-th Side-Cross element.
+ *
+ * Even steps take the next smallest element, odd steps the next largest.
+ *
+ * @param k  Position in Side-Cross order (k < n).
+ * @param n  Number of elements.
+ */
+inline std::size_t sideCrossIndex(std::size_t k, std::size_t n) {
+    return (k % 2 == 0) ? k / 2 : n - 1 - k / 2;
+}
+
+/**
+ * @brief Position in insertion order of the k-th Middle-Out element.
+ *
+ * The traversal starts at n / 2 and then alternates one step to the left and
+ * one step to the right; the left side has one element more when n is even,
+ * so it is always the right side that runs out first.
+ *
+ * @param k  Position in Middle-Out order (k < n).
+ * @param n  Number of elements.
+ */
+inline std::size_t middleOutIndex(std::size_t k, std::size_t n) {
+    std::size_t middle = n / 2;
+    if (k == 0) {
+        return middle;
+    }
+    std::size_t step = (k - 1) / 2 + 1;
+    return ((k - 1) % 2 == 0) ? middle - step : middle + step;
+}
+
+} // namespace ariel
@@ -10,7 +10,7 @@
 namespace ariel {
 
 //fw declaration:
-template<typename T> class MyContainer;
+template<typename T, typename Storage> class MyContainer;
 
 /**
  * @brief Iterator for MyContainer that traverses elements in insertion order.
@@ -19,11 +19,11 @@ template<typename T> class MyContainer;
  * up to the last. Supports both prefix and postfix increment, dereference, and
  * comparison operators.
  */
-template<typename T>
+template<typename T, typename Storage = std::vector<T>>
 class OrderIterator {
 private:
     /// Reference to the container being iterated over
-    const MyContainer<T>& container;
+    const MyContainer<T, Storage>& container;
     /// Current index within the container (0-based)
     std::size_t index;
 
@@ -34,7 +34,7 @@ public:
      * @param cont Reference to the MyContainer to iterate over.
      * @param idx  Starting index (default is 0, i.e. the first element).
      */
-    OrderIterator(const MyContainer<T>* cont, std::size_t idx = 0)
+    OrderIterator(const MyContainer<T, Storage>* cont, std::size_t idx = 0)
         : container(*cont), index(idx) {
             
         }
@@ -0,0 +1,339 @@
+//dor.cohen15@msmail.ariel.ac.il
+
+#pragma once
+
+#include <vector>
+#include <memory>      // for std::shared_ptr
+#include <algorithm>   // for std::upper_bound, std::lower_bound
+#include <cstddef>     // for std::size_t
+#include <stdexcept>   // for std::out_of_range
+#include <utility>     // for std::move
+
+namespace ariel {
+
+/**
+ * @brief Sorted multiset as a B+-tree whose nodes know their subtree sizes:
+ *        O(log n) insert, erase, rank and k-th element.
+ *
+ * Leaves hold up to LEAF_CAPACITY elements in one contiguous sorted array
+ * (about 512 bytes, eight cache lines); internal nodes hold up to FANOUT
+ * children, their subtree counts and separator keys. Equal elements keep
+ * their insertion order. Nodes emptied by erase are dropped; nodes are not
+ * merged, so the height is bounded by the largest size the tree had.
+ *
+ * Copying a tree is O(1): the copy shares every node, and a node is copied
+ * only when one of the trees modifies it while it is shared (copy on write).
+ * A copy is therefore a stable snapshot for iterators to read.
+ *
+ * @tparam T  Element type (needs operator<).
+ */
+template<typename T>
+class OrderStatisticTree {
+public:
+    /// Elements per leaf
+    static constexpr std::size_t LEAF_CAPACITY = sizeof(T) >= 64 ? 8 : 512 / sizeof(T);
+    /// Children per internal node
+    static constexpr std::size_t FANOUT = 32;
+
+    /// One leaf: a contiguous sorted piece of the elements
+    struct Chunk {
+        /// First element of the leaf
+        const T* values;
+        /// Rank of values[0] in the whole tree
+        std::size_t first;
+        /// Number of elements in the leaf
+        std::size_t size;
+    };
+
+private:
+    struct Node {
+        /// Number of elements in the subtree
+        std::size_t count = 0;
+        /// Sorted elements (leaves only)
+        std::vector<T> values;
+        /// Children (internal nodes only)
+        std::vector<std::shared_ptr<Node>> children;
+        /// keys[i] separates children[i] and children[i + 1]: no element of
+        /// the first is greater, no element of the second is smaller
+        std::vector<T> keys;
+
+        bool leaf() const noexcept {
+            return children.empty();
+        }
+    };
+
+    std::shared_ptr<Node> root;
+
+    /// Make p the sole owner of its node, copying it if it is shared
+    static Node& own(std::shared_ptr<Node>& p) {
+        if (p.use_count() > 1) {
+            p = std::make_shared<Node>(*p);
+        }
+        return *p;
+    }
+
+    /// Smallest element of a subtree (a copy: std::vector<bool> has no references)
+    static T smallest(const Node& node) {
+        const Node* n = &node;
+        while (!n->leaf()) {
+            n = n->children.front().get();
+        }
+        return n->values.front();
+    }
+
+    /**
+     * @brief Insert value into the subtree of node (owned by the caller).
+     *
+     * @return The new right sibling if node overflowed and split, else null.
+     */
+    static std::shared_ptr<Node> insertInto(Node& node, const T& value) {
+        ++node.count;
+        if (node.leaf()) {
+            node.values.insert(std::upper_bound(node.values.begin(), node.values.end(), value), value);
+            if (node.values.size() <= LEAF_CAPACITY) {
+                return nullptr;
+            }
+            std::size_t half = node.values.size() / 2;
+            auto right = std::make_shared<Node>();
+            right->values.assign(node.values.begin() + half, node.values.end());
+            node.values.erase(node.values.begin() + half, node.values.end());
+            right->count = right->values.size();
+            node.count = node.values.size();
+            return right;
+        }
+        std::size_t i = static_cast<std::size_t>(
+            std::upper_bound(node.keys.begin(), node.keys.end(), value) - node.keys.begin());
+        std::shared_ptr<Node> split = insertInto(own(node.children[i]), value);
+        if (!split) {
+            return nullptr;
+        }
+        node.keys.insert(node.keys.begin() + i, smallest(*split));
+        node.children.insert(node.children.begin() + i + 1, std::move(split));
+        if (node.children.size() <= FANOUT) {
+            return nullptr;
+        }
+        std::size_t half = node.children.size() / 2;
+        auto right = std::make_shared<Node>();
+        right->children.assign(node.children.begin() + half, node.children.end());
+        right->keys.assign(node.keys.begin() + half, node.keys.end());
+        node.children.erase(node.children.begin() + half, node.children.end());
+        node.keys.erase(node.keys.begin() + (half - 1), node.keys.end());
+        for (const auto& child : right->children) {
+            right->count += child->count;
+        }
+        node.count -= right->count;
+        return right;
+    }
+
+    /// Erase the element of the given rank from the subtree of node (owned by the caller)
+    static void eraseFrom(Node& node, std::size_t rank) {
+        --node.count;
+        if (node.leaf()) {
+            node.values.erase(node.values.begin() + rank);
+            return;
+        }
+        std::size_t i = 0;
+        while (rank >= node.children[i]->count) {
+            rank -= node.children[i]->count;
+            ++i;
+        }
+        Node& child = own(node.children[i]);
+        eraseFrom(child, rank);
+        if (child.count == 0) {
+            node.children.erase(node.children.begin() + i);
+            node.keys.erase(node.keys.begin() + (i == 0 ? 0 : i - 1));
+        }
+    }
+
+    /// Leaf holding the element of the given rank, and the rank of its first element
+    const Node& leafAt(std::size_t& rank) const {
+        const Node* node = root.get();
+        while (!node->leaf()) {
+            std::size_t i = 0;
+            while (rank >= node->children[i]->count) {
+                rank -= node->children[i]->count;
+                ++i;
+            }
+            node = node->children[i].get();
+        }
+        return *node;
+    }
+
+    /// Number of elements before the first one not passing `before`
+    template<typename Before>
+    std::size_t rankOf(Before before) const {
+        std::size_t rank = 0;
+        const Node* node = root.get();
+        if (node == nullptr) {
+            return 0;
+        }
+        while (!node->leaf()) {
+            std::size_t i = static_cast<std::size_t>(
+                std::partition_point(node->keys.begin(), node->keys.end(), before) - node->keys.begin());
+            for (std::size_t j = 0; j < i; ++j) {
+                rank += node->children[j]->count;
+            }
+            node = node->children[i].get();
+        }
+        return rank + static_cast<std::size_t>(
+            std::partition_point(node->values.begin(), node->values.end(), before) - node->values.begin());
+    }
+
+    template<typename F>
+    static void visit(const Node& node, F& f) {
+        if (node.leaf()) {
+            for (const T& value : node.values) {
+                f(value);
+            }
+            return;
+        }
+        for (const auto& child : node.children) {
+            visit(*child, f);
+        }
+    }
+
+public:
+    OrderStatisticTree() = default;
+
+    /**
+     * @brief Build a tree from a sorted range in O(n), with leaves and nodes
+     *        three quarters full.
+     */
+    template<typename It>
+    static OrderStatisticTree fromSorted(It first, It last) {
+        std::vector<std::shared_ptr<Node>> level;
+        const std::size_t leaf_fill = LEAF_CAPACITY - LEAF_CAPACITY / 4;
+        while (first != last) {
+            auto leaf = std::make_shared<Node>();
+            leaf->values.reserve(leaf_fill);
+            for (; first != last && leaf->values.size() < leaf_fill; ++first) {
+                leaf->values.push_back(*first);
+            }
+            leaf->count = leaf->values.size();
+            level.push_back(std::move(leaf));
+        }
+        const std::size_t node_fill = FANOUT - FANOUT / 4;
+        while (level.size() > 1) {
+            std::vector<std::shared_ptr<Node>> parents;
+            for (std::size_t i = 0; i < level.size(); i += node_fill) {
+                auto parent = std::make_shared<Node>();
+                std::size_t end = std::min(level.size(), i + node_fill);
+                for (std::size_t j = i; j < end; ++j) {
+                    if (j > i) {
+                        parent->keys.push_back(smallest(*level[j]));
+                    }
+                    parent->count += level[j]->count;
+                    parent->children.push_back(std::move(level[j]));
+                }
+                parents.push_back(std::move(parent));
+            }
+            level.swap(parents);
+        }
+        OrderStatisticTree tree;
+        if (!level.empty()) {
+            tree.root = std::move(level.front());
+        }
+        return tree;
+    }
+
+    std::size_t size() const noexcept {
+        return root ? root->count : 0;
+    }
+
+    /**
+     * @brief Insert value after the elements equal to it. O(log n).
+     */
+    void insert(const T& value) {
+        if (!root) {
+            root = std::make_shared<Node>();
+        }
+        std::shared_ptr<Node> split = insertInto(own(root), value);
+        if (split) {
+            auto top = std::make_shared<Node>();
+            top->count = root->count + split->count;
+            top->keys.push_back(smallest(*split));
+            top->children.push_back(std::move(root));
+            top->children.push_back(std::move(split));
+            root = std::move(top);
+        }
+    }
+
+    /**
+     * @brief Erase the element of the given rank (0 = smallest). O(log n).
+     *
+     * @throws std::out_of_range if rank >= size().
+     */
+    void eraseAt(std::size_t rank) {
+        if (rank >= size()) {
+            throw std::out_of_range("Position is out of bounds");
+        }
+        eraseFrom(own(root), rank);
+        if (root->count == 0) {
+            root.reset();
+            return;
+        }
+        while (!root->leaf() && root->children.size() == 1) {
+            std::shared_ptr<Node> only = root->children.front();
+            root = std::move(only);
+        }
+    }
+
+    /**
+     * @brief Erase every element equal to value. O((copies + 1) log n).
+     *
+     * @return std::size_t  Number of elements erased.
+     */
+    std::size_t eraseAll(const T& value) {
+        std::size_t first = lowerRank(value);
+        std::size_t copies = upperRank(value) - first;
+        for (std::size_t i = 0; i < copies; ++i) {
+            eraseAt(first);
+        }
+        return copies;
+    }
+
+    /// Number of elements smaller than value. O(log n).
+    std::size_t lowerRank(const T& value) const {
+        return rankOf([&value](const T& x) { return x < value; });
+    }
+
+    /// Number of elements not greater than value. O(log n).
+    std::size_t upperRank(const T& value) const {
+        return rankOf([&value](const T& x) { return !(value < x); });
+    }
+
+    /**
+     * @brief The k-th smallest element (k = 0 is the smallest). O(log n).
+     *
+     * @throws std::out_of_range if k >= size().
+     */
+    const T& kth(std::size_t k) const {
+        if (k >= size()) {
+            throw std::out_of_range("Position is out of bounds");
+        }
+        const Node& leaf = leafAt(k);
+        return leaf.values[k];
+    }
+
+    /**
+     * @brief The leaf holding the element of the given rank (< size()), for
+     *        sequential readers that step through a whole leaf at a time.
+     */
+    Chunk chunkAt(std::size_t rank) const {
+        std::size_t offset = rank;
+        const Node& leaf = leafAt(offset);
+        return Chunk{leaf.values.data(), rank - offset, leaf.values.size()};
+    }
+
+    /**
+     * @brief Call f(value) on every element in ascending order. O(n).
+     */
+    template<typename F>
+    void forEach(F f) const {
+        if (root) {
+            visit(*root, f);
+        }
+    }
+};
+
+} // namespace ariel
@@ -0,0 +1,148 @@
+//dor.cohen15@msmail.ariel.ac.il
+
+#pragma once
+
+#include <cstddef>     // for std::size_t
+#include <type_traits> // for std::is_invocable
+#include <utility>     // for std::move
+#include <optional>    // for the block results
+#include <vector>
+
+#include "MyContainer.hpp"
+#include "WorkStealingPool.hpp"
+
+namespace ariel {
+
+/**
+ * @brief Call fn on every element of c, in parallel, in the given order.
+ *
+ * The positions 0 .. size - 1 of the order are split by index over the pool
+ * (see WorkStealingPool::parallelFor); every element is reached by random
+ * access (MyContainer::view), so no reordered copy is made. Calls on
+ * different elements run concurrently and in no particular sequence; within
+ * one piece of the range they follow the order.
+ *
+ * @param c      Container to traverse; must not be modified meanwhile.
+ * @param order  Traversal order defining the positions.
+ * @param fn     Callable taking (const T&) or (std::size_t position, const T&).
+ * @param grain  Most positions handled by one task (0: automatic).
+ * @param pool   Pool to run on.
+ * @throws Rethrows the first exception thrown by fn.
+ */
+template<typename T, typename Storage, typename Fn>
+void parallel_for_each(const MyContainer<T, Storage>& c, Order order, Fn fn,
+                       std::size_t grain = 0, WorkStealingPool& pool = defaultPool()) {
+    auto view = c.view(order);
+    pool.parallelFor(view.size(), grain, [&view, &fn](std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k) {
+            if constexpr (std::is_invocable<Fn&, std::size_t, const T&>::value) {
+                fn(k, view[k]);
+            } else {
+                fn(view[k]);
+            }
+        }
+    });
+}
+
+/**
+ * @brief Fold the elements of c in fixed blocks, in parallel, and combine the
+ *        block results into init in position order.
+ *
+ * Every block starts from seed(its first element) and folds each of its other
+ * elements with fold(R, const T&); the block results are then folded into
+ * init with combine(R, R), left to right. No neutral value is needed: the
+ * result equals a serial fold from init for any associative combine when
+ * combine(a, seed(x)) and fold(a, x) agree (std::reduce semantics).
+ */
+template<typename T, typename Storage, typename R, typename Seed, typename Fold, typename Combine>
+R foldBlocks(const MyContainer<T, Storage>& c, Order order, R init,
+             Seed& seed, Fold& fold, Combine& combine, std::size_t grain, WorkStealingPool& pool) {
+    auto view = c.view(order);
+    std::size_t n = view.size();
+    if (n == 0) {
+        return init;
+    }
+    if (grain == 0) {
+        grain = n / (8 * (pool.workerCount() + 1));
+    }
+    if (grain == 0) {
+        grain = 1;
+    }
+    // One partial result per fixed block, so the final fold keeps position order
+    std::size_t blocks = (n + grain - 1) / grain;
+    std::vector<std::optional<R>> partial(blocks);
+    pool.parallelFor(blocks, 1, [&](std::size_t first, std::size_t last) {
+        for (std::size_t b = first; b < last; ++b) {
+            std::size_t begin = b * grain;
+            std::size_t end = (begin + grain < n) ? begin + grain : n;
+            R acc = seed(view[begin]);
+            for (std::size_t k = begin + 1; k < end; ++k) {
+                acc = fold(std::move(acc), view[k]);
+            }
+            partial[b].emplace(std::move(acc));
+        }
+    });
+    R result = std::move(init);
+    for (std::optional<R>& part : partial) {
+        result = combine(std::move(result), std::move(*part));
+    }
+    return result;
+}
+
+/**
+ * @brief Combine every element of c with op, in parallel, in the given order.
+ *
+ * Every piece of the range is folded left to right starting from its first
+ * element, and the piece results are then folded into init in position order:
+ * the result equals op(...op(op(init, e0), e1)..., en-1) for any associative
+ * op, commutative or not (sum, product, min, max, concatenation). No identity
+ * is assumed, so init only enters the result once. Folds that treat an element
+ * differently from a partial result (counting, max of a projection) need
+ * parallel_transform_reduce.
+ *
+ * @param c      Container to reduce; must not be modified meanwhile.
+ * @param order  Traversal order defining the positions.
+ * @param init   Initial value (returned as is for an empty container).
+ * @param op     Associative callable taking (R, const T&) and (R, R), returning R;
+ *               R must be constructible from const T&.
+ * @param grain  Most positions handled by one task (0: automatic).
+ * @param pool   Pool to run on.
+ * @throws Rethrows the first exception thrown by op.
+ */
+template<typename T, typename Storage, typename R, typename Op>
+R parallel_reduce(const MyContainer<T, Storage>& c, Order order, R init, Op op,
+                  std::size_t grain = 0, WorkStealingPool& pool = defaultPool()) {
+    auto seed = [](const T& value) { return R(value); };
+    return foldBlocks(c, order, std::move(init), seed, op, op, grain, pool);
+}
+
+/**
+ * @brief Map every element of c to R with transform and combine the results,
+ *        in parallel, in the given order.
+ *
+ * The result equals combine(...combine(combine(init, transform(e0)),
+ * transform(e1))..., transform(en-1)) for an associative combine. Counting is
+ * transform = (x >= 5 ? 1 : 0), combine = +; the largest key is
+ * transform = key, combine = max.
+ *
+ * @param c          Container to reduce; must not be modified meanwhile.
+ * @param order      Traversal order defining the positions.
+ * @param init       Initial value (returned as is for an empty container).
+ * @param transform  Callable taking const T&, returning R.
+ * @param combine    Associative callable taking (R, R), returning R.
+ * @param grain      Most positions handled by one task (0: automatic).
+ * @param pool       Pool to run on.
+ * @throws Rethrows the first exception thrown by transform or combine.
+ */
+template<typename T, typename Storage, typename R, typename Transform, typename Combine>
+R parallel_transform_reduce(const MyContainer<T, Storage>& c, Order order, R init,
+                            Transform transform, Combine combine,
+                            std::size_t grain = 0, WorkStealingPool& pool = defaultPool()) {
+    auto seed = [&transform](const T& value) { return R(transform(value)); };
+    auto fold = [&transform, &combine](R acc, const T& value) {
+        return combine(std::move(acc), transform(value));
+    };
+    return foldBlocks(c, order, std::move(init), seed, fold, combine, grain, pool);
+}
+
+} // namespace ariel
@@ -0,0 +1,143 @@
+//dor.cohen15@msmail.ariel.ac.il
+
+#pragma once
+
+#include <vector>
+#include <memory>      // for std::allocator, std::shared_ptr
+#include <algorithm>   // for std::nth_element, std::sort, std::min
+#include <cstddef>     // for std::size_t
+#include <stdexcept>   // for std::out_of_range
+
+namespace ariel {
+
+/**
+ * @brief Iterator that yields a container’s elements in ascending (or
+ *        descending) order, sorting only as far as it is read.
+ *
+ * The copy is ordered in batches: the next batch of smallest (largest)
+ * remaining elements is selected with std::nth_element, O(n), then sorted.
+ * Batches double in size, so reading the first m elements costs
+ * O(n + m log m) instead of a full O(n log n) sort; reading everything is
+ * still O(n log n).
+ *
+ * Copies of an iterator share the copy and its sorted prefix (sorting more
+ * for one never moves the elements the others have read), so they must be
+ * used from one thread.
+ *
+ * @tparam T           Element type (needs operator<).
+ * @tparam Alloc       Allocator of the copy (chosen by the container's storage).
+ * @tparam Descending  true to yield the largest elements first.
+ */
+template<typename T, typename Alloc = std::allocator<T>, bool Descending = false>
+class PartialSortIterator {
+private:
+    /// Elements in the first batch
+    static constexpr std::size_t FIRST_BATCH = 64;
+
+    struct State {
+        /// Copy of the elements; [0, ready) is in final order
+        std::vector<T, Alloc> values;
+        std::size_t ready = 0;
+        /// Size of the next batch
+        std::size_t batch = FIRST_BATCH;
+    };
+
+    /// Shared partially sorted copy (null for end iterators)
+    std::shared_ptr<State> state;
+    /// Current index in the yielded order (0-based)
+    std::size_t index;
+
+    static bool before(const T& a, const T& b) {
+        return Descending ? b < a : a < b;
+    }
+
+    std::size_t total() const {
+        return state ? state->values.size() : 0;
+    }
+
+    /// Sort batches until values[index] is in its final place
+    void settle() const {
+        State& s = *state;
+        auto comp = [](const T& a, const T& b) { return before(a, b); };
+        while (s.ready <= index) {
+            std::size_t end = std::min(s.values.size(), s.ready + s.batch);
+            auto first = s.values.begin() + static_cast<std::ptrdiff_t>(s.ready);
+            auto last = s.values.begin() + static_cast<std::ptrdiff_t>(end);
+            if (last != s.values.end()) {
+                std::nth_element(first, last, s.values.end(), comp);
+            }
+            std::sort(first, last, comp);
+            s.ready = end;
+            s.batch *= 2;
+        }
+    }
+
+public:
+    /**
+     * @brief Construct a new PartialSortIterator. Nothing is sorted yet.
+     *
+     * @param all_data  Copy of the container’s data (moved into the shared state).
+     * @param idx       Starting index (default 0; end iterators may pass an
+     *                  empty copy and the size).
+     */
+    PartialSortIterator(std::vector<T, Alloc> all_data, std::size_t idx = 0)
+        : state(), index(idx)
+    {
+        if (!all_data.empty()) {
+            state = std::make_shared<State>();
+            state->values = std::move(all_data);
+        }
+    }
+
+    /**
+     * @brief Dereference operator: the current element, sorting the next
+     *        batch first if the iterator has reached the end of the sorted prefix.
+     *
+     * @return const T&  Reference into the shared copy.
+     * @throws std::out_of_range if the iterator is at the end.
+     */
+    const T& operator*() const {
+        if (index >= total()) {
+            throw std::out_of_range("Iterator is out of bounds");
+        }
+        settle();
+        return state->values[index];
+    }
+
+    /**
+     * @brief Prefix increment operator.
+     *
+     * @return PartialSortIterator&  Reference to this iterator after increment.
+     * @throws std::out_of_range if the iterator is at the end.
+     */
+    PartialSortIterator& operator++() {
+        if (index >= total()) {
+            throw std::out_of_range("Cannot increment iterator: out of bounds");
+        }
+        ++index;
+        return *this;
+    }
+
+    /**
+     * @brief Postfix increment operator.
+     *
+     * @return PartialSortIterator  Copy of this iterator before increment.
+     * @throws std::out_of_range if the iterator is at the end.
+     */
+    PartialSortIterator operator++(int) {
+        PartialSortIterator copy = *this;
+        ++(*this);
+        return copy;
+    }
+
+    /// Iterators over the same container are equal when their indices are.
+    bool operator==(const PartialSortIterator& other) const {
+        return index == other.index;
+    }
+
+    bool operator!=(const PartialSortIterator& other) const {
+        return !(*this == other);
+    }
+};
+
+} // namespace ariel
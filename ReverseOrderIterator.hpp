@@ -4,6 +4,7 @@
 
 #include "MyContainer.hpp"
 #include <vector>
+#include <memory>      // for std::allocator
 #include <algorithm>   // for std::sort
 #include <cstddef>     // for std::size_t
 #include <stdexcept>   // for std::out_of_range
@@ -15,12 +16,14 @@ namespace ariel {
  * 
  * ReverseOrderIterator takes a copy of the container’s data, sorts it in
  * Reverse order, and then allows sequential access via iterator semantics.
+ * 
+ * @tparam Alloc  Allocator of the scratch copy (chosen by the container's storage).
  */
-template<typename T>
+template<typename T, typename Alloc = std::allocator<T>>
 class ReverseOrderIterator {
 private:
     /// Sorted copy of all elements, in Reverse order
-    std::vector<T> sorted_data;
+    std::vector<T, Alloc> sorted_data;
     /// Current index within sorted_data (0-based)
     std::size_t index;
 
@@ -33,7 +36,7 @@ public:
      * @param all_data  Copy of the container’s data (will be moved into sorted_data).
      * @param idx       Starting index (default 0).
      */
-    ReverseOrderIterator(std::vector<T> all_data, std::size_t idx = 0)
+    ReverseOrderIterator(std::vector<T, Alloc> all_data, std::size_t idx = 0)
         : sorted_data(std::move(all_data)), index(idx)
     {
         if (sorted_data.empty()) {
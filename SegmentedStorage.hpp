@@ -0,0 +1,225 @@
+//dor.cohen15@msmail.ariel.ac.il
+
+#pragma once
+
+#include <vector>
+#include <cstddef>     // for std::size_t, std::ptrdiff_t
+#include <iterator>    // for std::random_access_iterator_tag
+#include <type_traits> // for std::conditional_t
+#include <utility>     // for std::move
+
+namespace ariel {
+
+/**
+ * @brief Chunked storage policy for MyContainer.
+ *
+ * SegmentedStorage keeps its elements in fixed-size chunks that are listed in a
+ * chunk directory. A chunk is allocated once with room for ChunkSize elements and
+ * is never moved afterwards, so push_back is O(1) and never relocates elements
+ * the way std::vector does when it grows past its capacity. Only the directory
+ * (one small handle per chunk) is ever reallocated.
+ *
+ * The class exposes the subset of the std::vector interface that MyContainer
+ * uses: push_back, size, operator[], random-access iterators and erase.
+ *
+ * @tparam T          Element type.
+ * @tparam ChunkSize  Number of elements per chunk (must be a power of two).
+ */
+template<typename T, std::size_t ChunkSize = 4096>
+class SegmentedStorage {
+    static_assert(ChunkSize > 0 && (ChunkSize & (ChunkSize - 1)) == 0,
+                  "ChunkSize must be a power of two");
+
+private:
+    /// Chunk directory; every chunk is reserved to exactly ChunkSize elements
+    std::vector<std::vector<T>> chunks;
+    /// Total number of elements over all chunks
+    std::size_t count;
+
+    /**
+     * @brief Random-access iterator over the chunks, addressed by a flat index.
+     *
+     * @tparam Const  true for const_iterator, false for iterator.
+     */
+    template<bool Const>
+    class Iterator {
+    private:
+        using Owner = std::conditional_t<Const, const SegmentedStorage, SegmentedStorage>;
+        /// Storage being iterated over
+        Owner* owner;
+        /// Flat index of the current element
+        std::size_t pos;
+
+        friend class SegmentedStorage;
+        friend class Iterator<!Const>;
+
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type        = T;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = std::conditional_t<Const, const T*, T*>;
+        using reference         = std::conditional_t<Const, const T&, T&>;
+
+        Iterator(Owner* o = nullptr, std::size_t p = 0) : owner(o), pos(p) {}
+
+        /// Allows converting an iterator into a const_iterator.
+        template<bool C = Const, typename = std::enable_if_t<C>>
+        Iterator(const Iterator<false>& other) : owner(other.owner), pos(other.pos) {}
+
+        reference operator*() const { return (*owner)[pos]; }
+        pointer operator->() const { return &(*owner)[pos]; }
+        reference operator[](difference_type n) const { return (*owner)[pos + n]; }
+
+        Iterator& operator++() { ++pos; return *this; }
+        Iterator operator++(int) { Iterator copy = *this; ++pos; return copy; }
+        Iterator& operator--() { --pos; return *this; }
+        Iterator operator--(int) { Iterator copy = *this; --pos; return copy; }
+
+        Iterator& operator+=(difference_type n) { pos += n; return *this; }
+        Iterator& operator-=(difference_type n) { pos -= n; return *this; }
+        Iterator operator+(difference_type n) const { return Iterator(owner, pos + n); }
+        Iterator operator-(difference_type n) const { return Iterator(owner, pos - n); }
+        friend Iterator operator+(difference_type n, const Iterator& it) { return it + n; }
+        difference_type operator-(const Iterator& other) const {
+            return static_cast<difference_type>(pos) - static_cast<difference_type>(other.pos);
+        }
+
+        bool operator==(const Iterator& other) const { return pos == other.pos; }
+        bool operator!=(const Iterator& other) const { return pos != other.pos; }
+        bool operator<(const Iterator& other) const { return pos < other.pos; }
+        bool operator>(const Iterator& other) const { return pos > other.pos; }
+        bool operator<=(const Iterator& other) const { return pos <= other.pos; }
+        bool operator>=(const Iterator& other) const { return pos >= other.pos; }
+    };
+
+public:
+    using value_type     = T;
+    using size_type      = std::size_t;
+    using iterator       = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    /// Number of elements stored in each chunk
+    static constexpr std::size_t chunk_size = ChunkSize;
+
+    SegmentedStorage() : chunks{}, count(0) {}
+
+    /**
+     * @brief Copy every chunk into a fresh chunk reserved to ChunkSize.
+     *
+     * Copying a std::vector only reserves its size, so a plain copy of a
+     * partial last chunk would reallocate (and move) on the next push_back.
+     */
+    SegmentedStorage(const SegmentedStorage& other) : chunks{}, count(other.count) {
+        chunks.reserve(other.chunks.size());
+        for (const std::vector<T>& chunk : other.chunks) {
+            chunks.emplace_back();
+            chunks.back().reserve(ChunkSize);
+            chunks.back().insert(chunks.back().end(), chunk.begin(), chunk.end());
+        }
+    }
+
+    SegmentedStorage(SegmentedStorage&& other) noexcept = default;
+
+    SegmentedStorage& operator=(const SegmentedStorage& other) {
+        if (this != &other) {
+            SegmentedStorage copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    /// Moves hand over the chunks themselves, with their reservation.
+    SegmentedStorage& operator=(SegmentedStorage&& other) noexcept = default;
+
+    /**
+     * @brief Append an element at the end.
+     *
+     * Allocates a new chunk when the last one is full; existing elements are
+     * never copied or moved.
+     *
+     * @param value  Element to append.
+     */
+    void push_back(const T& value) {
+        if (count % ChunkSize == 0 && count / ChunkSize == chunks.size()) {
+            chunks.emplace_back();
+            chunks.back().reserve(ChunkSize);
+        }
+        chunks[count / ChunkSize].push_back(value);
+        ++count;
+    }
+
+    /**
+     * @brief Remove the last element.
+     *
+     * Releases the last chunk once it becomes empty.
+     */
+    void pop_back() {
+        --count;
+        std::vector<T>& last = chunks[count / ChunkSize];
+        last.pop_back();
+        if (last.empty() && count / ChunkSize + 1 == chunks.size()) {
+            chunks.pop_back();
+        }
+    }
+
+    /**
+     * @brief Pre-allocate chunks for at least n elements.
+     *
+     * @param n  Number of elements to make room for.
+     */
+    void reserve(std::size_t n) {
+        std::size_t needed = (n + ChunkSize - 1) / ChunkSize;
+        chunks.reserve(needed);
+        while (chunks.size() < needed) {
+            chunks.emplace_back();
+            chunks.back().reserve(ChunkSize);
+        }
+    }
+
+    /**
+     * @brief Remove all elements and release every chunk.
+     */
+    void clear() noexcept {
+        chunks.clear();
+        count = 0;
+    }
+
+    std::size_t size() const noexcept { return count; }
+
+    bool empty() const noexcept { return count == 0; }
+
+    T& operator[](std::size_t i) { return chunks[i / ChunkSize][i % ChunkSize]; }
+
+    const T& operator[](std::size_t i) const { return chunks[i / ChunkSize][i % ChunkSize]; }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, count); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, count); }
+
+    /**
+     * @brief Erase the elements in [first, last).
+     *
+     * The elements after last are shifted down to close the gap, then the
+     * surplus tail is popped. When last == end() (the std::remove idiom used by
+     * MyContainer::remove) no element is shifted at all.
+     *
+     * @param first  Start of the range to erase.
+     * @param last   End of the range to erase.
+     * @return iterator  Iterator to the element that followed the erased range.
+     */
+    iterator erase(const_iterator first, const_iterator last) {
+        std::size_t from = first.pos;
+        std::size_t to = last.pos;
+        std::size_t removed = to - from;
+        for (std::size_t i = to; i < count; ++i) {
+            (*this)[i - removed] = std::move((*this)[i]);
+        }
+        for (std::size_t i = 0; i < removed; ++i) {
+            pop_back();
+        }
+        return iterator(this, from);
+    }
+};
+
+} // namespace ariel
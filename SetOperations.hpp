@@ -0,0 +1,309 @@
+//dor.cohen15@msmail.ariel.ac.il
+
+#pragma once
+
+#include "SortedRuns.hpp"
+#include <vector>
+#include <memory>      // for std::allocator
+#include <algorithm>   // for std::merge, std::set_union, std::set_difference, std::lower_bound
+#include <iterator>    // for std::back_inserter
+#include <cstddef>     // for std::size_t
+#include <stdexcept>   // for std::out_of_range
+#include <type_traits> // for std::is_arithmetic
+#include <utility>     // for std::move
+
+namespace ariel {
+
+/**
+ * @brief The sort-merge operations between two containers. Copies are kept
+ *        as by the std algorithms of the same name: with m copies of a value
+ *        on the left and k on the right, the result has
+ */
+enum class SetOperation {
+    Merge,         ///< m + k copies (std::merge)
+    Union,         ///< max(m, k) copies (std::set_union)
+    Intersection,  ///< min(m, k) copies (std::set_intersection)
+    Difference     ///< max(m - k, 0) copies (std::set_difference)
+};
+
+/**
+ * @brief Iterator over the result of a SetOperation on two sorted runs, in
+ *        ascending order, computed while it is read.
+ *
+ * Both inputs are walked once with a cursor each. When one side has to catch
+ * up with the other (intersection, and the right side of a difference), the
+ * iterator steps a few elements one by one and then seeks with
+ * SortedRuns::lowerBound, so runs of very different sizes cost
+ * O(small * log large) instead of O(small + large).
+ *
+ * On equal values the left element is yielded first (merge), or instead of
+ * the right one (union, intersection).
+ *
+ * @tparam T      Element type (needs operator<).
+ * @tparam Alloc  Allocator of the runs.
+ */
+template<typename T, typename Alloc = std::allocator<T>>
+class SetOperationIterator {
+public:
+    using Cursor = typename SortedRuns<T, Alloc>::Cursor;
+
+private:
+    /// Elements stepped over one by one before seeking
+    static constexpr std::size_t LINEAR_STEPS = 8;
+
+    SetOperation op;
+    SortedRuns<T, Alloc> left;
+    SortedRuns<T, Alloc> right;
+    Cursor a;
+    Cursor b;
+    /// Sides the current element is taken from (both: equal heads)
+    bool take_left;
+    bool take_right;
+
+    static std::size_t position(const Cursor& c) {
+        return c.base + c.delta;
+    }
+
+    static Cursor endOf(const SortedRuns<T, Alloc>& runs) {
+        return Cursor{runs.baseSize(), runs.delta().size()};
+    }
+
+    /// Move c to the first element of runs not less than value (c's element is less)
+    static void catchUp(const SortedRuns<T, Alloc>& runs, Cursor& c, const T& value) {
+        for (std::size_t i = 0; i < LINEAR_STEPS; ++i) {
+            runs.advance(c);
+            if (position(c) == runs.size() || !(runs.next(c) < value)) {
+                return;
+            }
+        }
+        c = runs.lowerBound(value);
+    }
+
+    /// Skip to the next element of the result and record where it comes from
+    void settle() {
+        for (;;) {
+            bool a_end = position(a) == left.size();
+            bool b_end = position(b) == right.size();
+            take_left = false;
+            take_right = false;
+            if (a_end && b_end) {
+                return;
+            }
+            if (op == SetOperation::Intersection && (a_end || b_end)) {
+                a = endOf(left);
+                b = endOf(right);
+                return;
+            }
+            if (op == SetOperation::Difference && (a_end || b_end)) {
+                b = endOf(right);
+                take_left = !a_end;
+                return;
+            }
+            if (a_end || b_end) {
+                take_left = !a_end;
+                take_right = a_end;
+                return;
+            }
+            const T& x = left.next(a);
+            const T& y = right.next(b);
+            if (x < y) {
+                if (op == SetOperation::Intersection) {
+                    catchUp(left, a, y);
+                    continue;
+                }
+                take_left = true;
+                return;
+            }
+            if (y < x) {
+                if (op == SetOperation::Intersection || op == SetOperation::Difference) {
+                    catchUp(right, b, x);
+                    continue;
+                }
+                take_right = true;
+                return;
+            }
+            if (op == SetOperation::Difference) {
+                left.advance(a);
+                right.advance(b);
+                continue;
+            }
+            take_left = true;
+            take_right = op != SetOperation::Merge;
+            return;
+        }
+    }
+
+public:
+    /**
+     * @brief Construct a new SetOperationIterator at a pair of cursors.
+     *
+     * @param operation  Operation to apply.
+     * @param l          Sorted runs of the left container.
+     * @param r          Sorted runs of the right container.
+     * @param at_end     true for the end iterator.
+     */
+    SetOperationIterator(SetOperation operation, SortedRuns<T, Alloc> l, SortedRuns<T, Alloc> r, bool at_end = false)
+        : op(operation), left(std::move(l)), right(std::move(r)), a{0, 0}, b{0, 0},
+          take_left(false), take_right(false)
+    {
+        if (at_end) {
+            a = endOf(left);
+            b = endOf(right);
+        } else {
+            settle();
+        }
+    }
+
+    /**
+     * @brief Dereference operator: the current element of the result.
+     *
+     * @throws std::out_of_range if the iterator is at the end.
+     */
+    const T& operator*() const {
+        if (!take_left && !take_right) {
+            throw std::out_of_range("Iterator is out of bounds");
+        }
+        return take_left ? left.next(a) : right.next(b);
+    }
+
+    /**
+     * @brief Prefix increment: move to the next element of the result.
+     *
+     * @throws std::out_of_range if the iterator is at the end.
+     */
+    SetOperationIterator& operator++() {
+        if (!take_left && !take_right) {
+            throw std::out_of_range("Cannot increment iterator: out of bounds");
+        }
+        if (take_left) {
+            left.advance(a);
+        }
+        if (take_right) {
+            right.advance(b);
+        }
+        settle();
+        return *this;
+    }
+
+    SetOperationIterator operator++(int) {
+        SetOperationIterator copy = *this;
+        ++(*this);
+        return copy;
+    }
+
+    /// Iterators over the same inputs are equal when both cursors are.
+    bool operator==(const SetOperationIterator& other) const {
+        return position(a) == position(other.a) && position(b) == position(other.b);
+    }
+
+    bool operator!=(const SetOperationIterator& other) const {
+        return !(*this == other);
+    }
+};
+
+/**
+ * @brief Range of the result of a SetOperation on two containers, in
+ *        ascending order (see MyContainer::set_operation).
+ *
+ * The view holds the shared sorted runs it was made from: it stays valid,
+ * and unchanged, when the containers are modified or destroyed.
+ */
+template<typename T, typename Alloc = std::allocator<T>>
+class SetOperationView {
+public:
+    using iterator = SetOperationIterator<T, Alloc>;
+
+private:
+    SetOperation op;
+    SortedRuns<T, Alloc> left;
+    SortedRuns<T, Alloc> right;
+
+public:
+    SetOperationView(SetOperation operation, SortedRuns<T, Alloc> l, SortedRuns<T, Alloc> r)
+        : op(operation), left(std::move(l)), right(std::move(r)) {}
+
+    iterator begin() const {
+        return iterator(op, left, right);
+    }
+
+    iterator end() const {
+        return iterator(op, left, right, true);
+    }
+};
+
+/**
+ * @brief Append the result of a SetOperation on two sorted vectors to out,
+ *        with one tight loop over the arrays.
+ *
+ * The intersection of arithmetic values is branch-free: every step writes the
+ * left element and moves each index by a comparison result, so unpredictable
+ * inputs cost no branch mispredictions. When one side is over
+ * SKEW times longer, the intersection instead binary-searches the longer side
+ * for each element of the shorter one.
+ */
+template<typename T, typename A, typename Out>
+void setOperationSorted(SetOperation op, const std::vector<T, A>& l, const std::vector<T, A>& r, Out& out) {
+    constexpr std::size_t SKEW = 32;
+    switch (op) {
+    case SetOperation::Merge:
+        std::merge(l.begin(), l.end(), r.begin(), r.end(), std::back_inserter(out));
+        return;
+    case SetOperation::Union:
+        std::set_union(l.begin(), l.end(), r.begin(), r.end(), std::back_inserter(out));
+        return;
+    case SetOperation::Difference:
+        std::set_difference(l.begin(), l.end(), r.begin(), r.end(), std::back_inserter(out));
+        return;
+    case SetOperation::Intersection:
+        break;
+    }
+    std::size_t n = l.size();
+    std::size_t m = r.size();
+    if (n > SKEW * m) {
+        auto from = l.begin();
+        for (const T& y : r) {
+            from = std::lower_bound(from, l.end(), y);
+            if (from == l.end()) {
+                return;
+            }
+            if (!(y < *from)) {
+                out.push_back(*from++);
+            }
+        }
+        return;
+    }
+    if (m > SKEW * n) {
+        auto from = r.begin();
+        for (const T& x : l) {
+            from = std::lower_bound(from, r.end(), x);
+            if (from == r.end()) {
+                return;
+            }
+            if (!(x < *from)) {
+                out.push_back(x);
+                ++from;
+            }
+        }
+        return;
+    }
+    if constexpr (std::is_arithmetic<T>::value) {
+        std::size_t start = out.size();
+        out.resize(start + std::min(n, m));
+        std::size_t i = 0;
+        std::size_t j = 0;
+        std::size_t k = start;
+        while (i < n && j < m) {
+            T x = l[i];
+            T y = r[j];
+            out[k] = x;
+            k += static_cast<std::size_t>(!(x < y) & !(y < x));
+            i += static_cast<std::size_t>(!(y < x));
+            j += static_cast<std::size_t>(!(x < y));
+        }
+        out.resize(k);
+    } else {
+        std::set_intersection(l.begin(), l.end(), r.begin(), r.end(), std::back_inserter(out));
+    }
+}
+
+} // namespace ariel
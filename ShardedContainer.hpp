@@ -0,0 +1,341 @@
+//dor.cohen15@msmail.ariel.ac.il
+
+#pragma once
+
+#include <vector>
+#include <memory>      // for std::unique_ptr, std::shared_ptr
+#include <mutex>       // for std::mutex, std::lock_guard
+#include <thread>      // for std::thread::hardware_concurrency
+#include <atomic>      // for std::atomic
+#include <functional>  // for std::hash
+#include <type_traits> // for std::void_t
+#include <utility>     // for std::declval
+#include <stdexcept>   // for std::runtime_error
+#include <cstddef>     // for std::size_t
+#include <cstdint>     // for std::uint64_t
+#include <ostream>
+
+#include "MyContainer.hpp"
+#include "MergeIterator.hpp"
+
+namespace ariel {
+
+/// Whether std::hash<T> is enabled (hash routing needs it)
+template<typename T, typename = void>
+struct IsHashable : std::false_type {};
+
+template<typename T>
+struct IsHashable<T, std::void_t<decltype(std::hash<T>{}(std::declval<const T&>()))>> : std::true_type {};
+
+/**
+ * @brief Container split into independent MyContainer shards for multi-core
+ *        ingest, with the six traversal orders over all shards together.
+ *
+ * Every shard has its own lock, so threads adding to different shards never
+ * contend; addElementTo() lets a thread own a shard outright. addElement()
+ * routes round-robin, or by std::hash of the value (then all copies of a value
+ * live in one shard and remove() only locks that shard). Round-robin works
+ * for any T; hash routing needs std::hash<T>.
+ *
+ * Every element is stamped with a global sequence number, increasing within
+ * each shard. Global insertion (and reverse) order is a k-way merge of the
+ * shards by sequence number; ascending and descending order are a k-way merge
+ * of the shards' own cached sorted data, so nothing is re-sorted. Side-cross
+ * and middle-out order are built from those merged streams.
+ *
+ * Iterators work on a snapshot of the shards taken when begin_*() is called.
+ * Take the begin / end pair while no writer runs, since end_*() is computed
+ * from size().
+ *
+ * @tparam T        Element type.
+ * @tparam Storage  Storage policy of every shard.
+ */
+template<typename T = int, typename Storage = std::vector<T>>
+class ShardedContainer {
+public:
+    /// How addElement picks a shard
+    enum class Routing {
+        RoundRobin,  ///< Shards in turn, for the most even load
+        Hash         ///< std::hash of the value, equal values share a shard
+    };
+
+    /// Allocator of the scratch copies the iterators read
+    using ScratchAlloc = typename ScratchAllocator<Storage, T>::type;
+    /// Iterator of the orders served straight by the merge
+    using merge_iterator = MergeIterator<T, ScratchAlloc>;
+
+private:
+    using Run = typename merge_iterator::Run;
+
+    struct Shard {
+        /// Serializes access to this shard
+        mutable std::mutex lock;
+        /// Elements of the shard, in the order they were added
+        MyContainer<T, Storage> values;
+        /// Global sequence number of every element of values
+        std::vector<std::uint64_t> seq;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    Routing routing;
+    /// Next global sequence number
+    std::atomic<std::uint64_t> next_seq;
+    /// Next shard for round-robin routing
+    std::atomic<std::size_t> next_shard;
+
+    /// Shard of value under hash routing (only called with hash routing, see the constructor)
+    std::size_t hashShard(const T& value) const {
+        if constexpr (IsHashable<T>::value) {
+            return std::hash<T>{}(value) % shards.size();
+        } else {
+            (void)value;
+            throw std::runtime_error("Hash routing needs std::hash of the element type");
+        }
+    }
+
+    std::size_t route(const T& value) {
+        if (routing == Routing::Hash) {
+            return hashShard(value);
+        }
+        return next_shard.fetch_add(1, std::memory_order_relaxed) % shards.size();
+    }
+
+    void addTo(Shard& shard, const T& value) {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        // Taken under the shard lock, so numbers increase within every shard
+        shard.seq.push_back(next_seq.fetch_add(1, std::memory_order_relaxed));
+        try {
+            shard.values.addElement(value);
+        } catch (...) {
+            shard.seq.pop_back();
+            throw;
+        }
+    }
+
+    /**
+     * @brief Remove every copy of value from one shard.
+     *
+     * @return false if the shard does not hold value.
+     */
+    bool removeFrom(Shard& shard, const T& value) {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        std::vector<std::uint64_t> kept;
+        kept.reserve(shard.seq.size());
+        std::size_t i = 0;
+        for (auto it = shard.values.begin_order(); it != shard.values.end_order(); ++it, ++i) {
+            if (!(*it == value)) {
+                kept.push_back(shard.seq[i]);
+            }
+        }
+        if (kept.size() == shard.seq.size()) {
+            return false;
+        }
+        shard.values.remove(value); // keeps the survivors in order, like kept
+        shard.seq.swap(kept);
+        return true;
+    }
+
+    /// Every shard's cached sorted data, ordered by value
+    std::vector<Run> sortedRuns() const {
+        std::vector<Run> runs;
+        runs.reserve(shards.size());
+        for (const auto& shard : shards) {
+            std::lock_guard<std::mutex> guard(shard->lock);
+            runs.push_back(Run{shard->values.sortedData(), nullptr});
+        }
+        return runs;
+    }
+
+    /// A copy of every shard in insertion order, ordered by sequence number
+    std::vector<Run> insertionRuns() const {
+        std::vector<Run> runs;
+        runs.reserve(shards.size());
+        for (const auto& shard : shards) {
+            std::lock_guard<std::mutex> guard(shard->lock);
+            runs.push_back(Run{
+                std::make_shared<const std::vector<T, ScratchAlloc>>(shard->values.copyData()),
+                std::make_shared<const std::vector<std::uint64_t>>(shard->seq)});
+        }
+        return runs;
+    }
+
+    /// All elements of one merge, in merge order
+    static std::vector<T, ScratchAlloc> collect(std::vector<Run> runs, bool largest_first) {
+        std::size_t total = 0;
+        for (const Run& run : runs) {
+            total += run.values->size();
+        }
+        std::vector<T, ScratchAlloc> out;
+        out.reserve(total);
+        merge_iterator end(total);
+        for (merge_iterator it(std::move(runs), largest_first); it != end; ++it) {
+            out.push_back(*it);
+        }
+        return out;
+    }
+
+public:
+    /**
+     * @brief Construct an empty container.
+     *
+     * @param shard_count  Number of shards (0: one per hardware thread).
+     * @param route_by     How addElement picks a shard.
+     * @throws std::runtime_error for hash routing if std::hash<T> is not enabled.
+     */
+    explicit ShardedContainer(std::size_t shard_count = 0, Routing route_by = Routing::RoundRobin)
+        : shards(), routing(route_by), next_seq(0), next_shard(0)
+    {
+        if (route_by == Routing::Hash && !IsHashable<T>::value) {
+            throw std::runtime_error("Hash routing needs std::hash of the element type");
+        }
+        if (shard_count == 0) {
+            shard_count = std::thread::hardware_concurrency();
+        }
+        if (shard_count == 0) {
+            shard_count = 1;
+        }
+        shards.reserve(shard_count);
+        for (std::size_t i = 0; i < shard_count; ++i) {
+            shards.push_back(std::make_unique<Shard>());
+        }
+    }
+
+    ShardedContainer(const ShardedContainer&) = delete;
+    ShardedContainer& operator=(const ShardedContainer&) = delete;
+
+    std::size_t shardCount() const noexcept {
+        return shards.size();
+    }
+
+    /**
+     * @brief Total number of elements over all shards.
+     */
+    std::size_t size() const {
+        std::size_t total = 0;
+        for (const auto& shard : shards) {
+            std::lock_guard<std::mutex> guard(shard->lock);
+            total += shard->values.size();
+        }
+        return total;
+    }
+
+    /**
+     * @brief Add value to the shard chosen by the routing policy. Thread-safe.
+     */
+    void addElement(const T& value) {
+        addTo(*shards[route(value)], value);
+    }
+
+    /**
+     * @brief Add value to a given shard, e.g. the one owned by the calling
+     *        thread. Thread-safe.
+     *
+     * @throws std::runtime_error if shard >= shardCount().
+     */
+    void addElementTo(std::size_t shard, const T& value) {
+        if (shard >= shards.size()) {
+            throw std::runtime_error("Shard index out of range");
+        }
+        addTo(*shards[shard], value);
+    }
+
+    /**
+     * @brief Remove every copy of value from the container. Thread-safe.
+     *
+     * With hash routing only the value's shard is searched.
+     *
+     * @throws std::runtime_error if the container is empty or value is not found.
+     */
+    void remove(const T& value) {
+        if (size() == 0) {
+            throw std::runtime_error("Container is empty");
+        }
+        bool found = false;
+        if (routing == Routing::Hash) {
+            found = removeFrom(*shards[hashShard(value)], value);
+        } else {
+            for (auto& shard : shards) {
+                found = removeFrom(*shard, value) || found;
+            }
+        }
+        if (!found) {
+            throw std::runtime_error("Value to remove not found in container");
+        }
+    }
+
+    /**
+     * @brief Run f(shard_index, shard) on every shard in parallel on
+     *        defaultPool(), each call holding its shard's lock.
+     *
+     * @param f  Callable taking (std::size_t, const MyContainer<T, Storage>&).
+     * @throws Rethrows the first exception thrown by f, after all calls finish.
+     */
+    template<typename F>
+    void forEachShard(F f) const {
+        defaultPool().parallelFor(shards.size(), 1, [this, &f](std::size_t first, std::size_t last) {
+            for (std::size_t i = first; i < last; ++i) {
+                std::lock_guard<std::mutex> guard(shards[i]->lock);
+                f(i, static_cast<const MyContainer<T, Storage>&>(shards[i]->values));
+            }
+        });
+    }
+
+    /**
+     * @brief Print all elements in global insertion order, as "[a, b, c]".
+     */
+    friend std::ostream& operator<<(std::ostream& os, const ShardedContainer& c) {
+        return os << formatRange(c.begin_order(), c.end_order());
+    }
+
+    merge_iterator begin_order() const {
+        return merge_iterator(insertionRuns(), false);
+    }
+
+    merge_iterator end_order() const {
+        return merge_iterator(size());
+    }
+
+    merge_iterator begin_ascending_order() const {
+        return merge_iterator(sortedRuns(), false);
+    }
+
+    merge_iterator end_ascending_order() const {
+        return merge_iterator(size());
+    }
+
+    merge_iterator begin_descending_order() const {
+        return merge_iterator(sortedRuns(), true);
+    }
+
+    merge_iterator end_descending_order() const {
+        return merge_iterator(size());
+    }
+
+    SideCrossOrderIterator<T, ScratchAlloc> begin_side_cross_order() const {
+        return SideCrossOrderIterator<T, ScratchAlloc>(
+            std::make_shared<const std::vector<T, ScratchAlloc>>(collect(sortedRuns(), false)), 0);
+    }
+
+    SideCrossOrderIterator<T, ScratchAlloc> end_side_cross_order() const {
+        return SideCrossOrderIterator<T, ScratchAlloc>(
+            std::make_shared<const std::vector<T, ScratchAlloc>>(), size());
+    }
+
+    merge_iterator begin_reverse_order() const {
+        return merge_iterator(insertionRuns(), true);
+    }
+
+    merge_iterator end_reverse_order() const {
+        return merge_iterator(size());
+    }
+
+    MiddleOutOrderIterator<T, ScratchAlloc> begin_middle_out_order() const {
+        return MiddleOutOrderIterator<T, ScratchAlloc>(collect(insertionRuns(), false), 0);
+    }
+
+    MiddleOutOrderIterator<T, ScratchAlloc> end_middle_out_order() const {
+        return MiddleOutOrderIterator<T, ScratchAlloc>(std::vector<T, ScratchAlloc>(), size());
+    }
+};
+
+} // namespace ariel
@@ -3,7 +3,9 @@
 #pragma once
 
 #include "MyContainer.hpp"
+#include "SortedRuns.hpp"
 #include <vector>
+#include <memory>      // for std::allocator, std::shared_ptr
 #include <algorithm>   // for std::sort
 #include <cstddef>     // for std::size_t
 #include <stdexcept>   // for std::out_of_range
@@ -13,73 +15,93 @@ namespace ariel {
 /**
  * @brief Iterator that traverses a container’s elements in Side Cross order.
  * 
- * SideCrossOrderIterator takes a copy of the container’s data, sorts it in
- * Side-Cross order, and then allows sequential access via iterator semantics.
+ * SideCrossOrderIterator reads the container’s ascending sorted copy
+ * alternately from the front and from the back, which yields Side-Cross order,
+ * and allows sequential access via iterator semantics. The sorted copy is
+ * shared with the other sorted iterators, so no reordered copy is built; it
+ * may come as a base run plus a small delta run (see SortedRuns).
+ * 
+ * @tparam Alloc  Allocator of the scratch copy (chosen by the container's storage).
  */
-template<typename T>
+template<typename T, typename Alloc = std::allocator<T>>
 class SideCrossOrderIterator {
 private:
-    /// Sorted copy of all elements, in Side-Cross order
-    std::vector<T> sorted_data;
-    /// Current index within sorted_data (0-based)
+    /// Shared sorted runs of all elements, in ascending order
+    SortedRuns<T, Alloc> sorted_data;
+    /// Next smallest element not yet visited, in the merged runs
+    typename SortedRuns<T, Alloc>::Cursor low;
+    /// Right after the next largest element not yet visited
+    typename SortedRuns<T, Alloc>::Cursor high;
+    /// Current index within the Side-Cross sequence (0-based)
     std::size_t index;
 
+    void seek() {
+        std::size_t n = sorted_data.size();
+        std::size_t k = index < n ? index : n;
+        low = sorted_data.split((k + 1) / 2);
+        high = sorted_data.split(n - k / 2);
+    }
+
 public:
     /**
      * @brief Construct a new SideCrossOrderIterator.
      * 
-     * Builds a sorted copy of all_data (Side-Cross), and sets the starting index.
+     * Builds a sorted copy of all_data (ascending), and sets the starting index.
      * 
      * @param all_data  Copy of the container’s data (will be moved into sorted_data).
      * @param idx       Starting index (default 0).
      */
-    SideCrossOrderIterator(std::vector<T> all_data, std::size_t idx = 0)
-        : sorted_data(std::move(all_data)), index(idx)
+    SideCrossOrderIterator(std::vector<T, Alloc> all_data, std::size_t idx = 0)
+        : sorted_data(), low{0, 0}, high{0, 0}, index(idx)
     {
-        //check that the vector is not empty.
-        if (sorted_data.empty()) {
-            return;
-        }
-        // first we will sort by Ascending order.
-        std::sort(sorted_data.begin(), sorted_data.end()); 
-        
-        //then we will create another vector that will contain the side-cross:
-        std::vector<T> alternating;
-        alternating.reserve(sorted_data.size());
-        
-        size_t left_idx = 0;
-        size_t right_idx = sorted_data.size() -1;
-
-        while(left_idx <= right_idx){
-            
-            alternating.push_back(sorted_data[left_idx]);
-
-            if (left_idx == right_idx)
-                break;
-            
-            alternating.push_back(sorted_data[right_idx]);
+        // Sort by Ascending order; the Side-Cross order is read from both ends.
+        std::sort(all_data.begin(), all_data.end());
+        sorted_data = SortedRuns<T, Alloc>(std::make_shared<const std::vector<T, Alloc>>(std::move(all_data)));
+        seek();
+    }
 
-            ++left_idx;
-            --right_idx;
+    /**
+     * @brief Construct a new SideCrossOrderIterator over already sorted data.
+     * 
+     * @param sorted  Shared copy of the elements, in ascending order.
+     * @param idx     Starting index (default 0).
+     */
+    SideCrossOrderIterator(std::shared_ptr<const std::vector<T, Alloc>> sorted, std::size_t idx = 0)
+        : SideCrossOrderIterator(SortedRuns<T, Alloc>(std::move(sorted)), idx) {}
 
+    /**
+     * @brief Construct a new SideCrossOrderIterator over sorted runs merged on the fly.
+     * 
+     * @param runs  Shared sorted base and delta runs of the elements.
+     * @param idx   Starting index (default 0).
+     */
+    SideCrossOrderIterator(SortedRuns<T, Alloc> runs, std::size_t idx = 0)
+        : sorted_data(std::move(runs)), low{0, 0}, high{0, 0}, index(idx)
+    {
+        if (index == 0) {
+            high = {sorted_data.baseSize(), sorted_data.delta().size()};
+        } else {
+            seek();
         }
-        sorted_data = std::move(alternating);
     }
 
     /**
      * @brief Dereference operator.
      * 
-     * Returns a reference to the element at the current index in sorted_data.
-     * Throws std::out_of_range if index is beyond the last element.
+     * Even positions take the next smallest element, odd positions the next
+     * largest. Throws std::out_of_range if index is beyond the last element.
      * 
-     * @return T&  Reference to sorted_data[index]
+     * @return T&  Reference to the Side-Cross element at index
      * @throws std::out_of_range if index >= sorted_data.size()
      */
     const T& operator*() const {
         if (index >= sorted_data.size()) {
             throw std::out_of_range("Iterator is out of bounds");
         }
-        return sorted_data[index];
+        if (index % 2 == 0) {
+            return sorted_data.next(low);       // from the left
+        }
+        return sorted_data.previous(high);      // from the right
     }
 
     /**
@@ -95,6 +117,11 @@ public:
         if (index >= sorted_data.size()) {
             throw std::out_of_range("Cannot increment iterator: out of bounds");
         }
+        if (index % 2 == 0) {
+            sorted_data.advance(low);
+        } else {
+            sorted_data.retreat(high);
+        }
         ++index;
         return *this;
     }
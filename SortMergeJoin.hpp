@@ -0,0 +1,250 @@
+//dor.cohen15@msmail.ariel.ac.il
+
+#pragma once
+
+#include "SortedRuns.hpp"
+#include <memory>      // for std::allocator, std::shared_ptr
+#include <functional>  // for std::invoke
+#include <cstddef>     // for std::size_t
+#include <stdexcept>   // for std::out_of_range, std::runtime_error
+#include <utility>     // for std::pair, std::move
+
+namespace ariel {
+
+/// Projection that keys an element by itself (the default join key)
+struct IdentityKey {
+    template<typename T>
+    const T& operator()(const T& value) const noexcept {
+        return value;
+    }
+};
+
+/**
+ * @brief Iterator over the matching pairs of a sort-merge join of two
+ *        containers' sorted runs, produced while it is read.
+ *
+ * Both runs are walked once in ascending order. For each key present on both
+ * sides, every left element with the key is paired with every right element
+ * with the key (left-major order), by rewinding a cursor to the start of the
+ * right group, so only one pair exists at a time and the cross product of a
+ * group is never stored. Cost O(n + m + pairs).
+ *
+ * The projections must be ordered by the runs: walking a run in ascending
+ * order of the elements must give non-decreasing keys, e.g. a key that is the
+ * first field operator< compares. JoinView checks this for both runs before
+ * any pair is produced.
+ *
+ * @tparam L, R           Element types of the left and right runs.
+ * @tparam LAlloc, RAlloc Allocators of the runs.
+ * @tparam KeyL, KeyR     Projections (callables or member pointers) from an
+ *                        element to its key; the keys need operator< between them.
+ */
+template<typename L, typename LAlloc, typename R, typename RAlloc, typename KeyL, typename KeyR>
+class JoinIterator {
+public:
+    using reference = std::pair<const L&, const R&>;
+
+    /// The two projections, shared by the iterators of one view
+    struct Keys {
+        KeyL left;
+        KeyR right;
+    };
+
+private:
+    using LeftCursor = typename SortedRuns<L, LAlloc>::Cursor;
+    using RightCursor = typename SortedRuns<R, RAlloc>::Cursor;
+
+    SortedRuns<L, LAlloc> left;
+    SortedRuns<R, RAlloc> right;
+    std::shared_ptr<const Keys> keys;
+    /// Current left element
+    LeftCursor a;
+    /// Current right element, and the bounds of the right group of its key
+    RightCursor b;
+    RightCursor group_first;
+    RightCursor group_end;
+
+    template<typename Cursor>
+    static std::size_t position(const Cursor& c) {
+        return c.base + c.delta;
+    }
+
+    template<typename X, typename Y>
+    static bool equalKeys(const X& x, const Y& y) {
+        return !(x < y) && !(y < x);
+    }
+
+    decltype(auto) leftKey(const LeftCursor& c) const {
+        return std::invoke(keys->left, left.next(c));
+    }
+
+    decltype(auto) rightKey(const RightCursor& c) const {
+        return std::invoke(keys->right, right.next(c));
+    }
+
+    void toEnd() {
+        a = LeftCursor{left.baseSize(), left.delta().size()};
+        b = RightCursor{right.baseSize(), right.delta().size()};
+        group_first = b;
+        group_end = b;
+    }
+
+    /// Move a and b to the next pair of equal keys and find the right group
+    void settle() {
+        for (;;) {
+            if (position(a) == left.size() || position(b) == right.size()) {
+                toEnd();
+                return;
+            }
+            const auto& x = leftKey(a);
+            const auto& y = rightKey(b);
+            if (x < y) {
+                left.advance(a);
+            } else if (y < x) {
+                right.advance(b);
+            } else {
+                break;
+            }
+        }
+        group_first = b;
+        group_end = b;
+        const auto& x = leftKey(a);
+        do {
+            right.advance(group_end);
+        } while (position(group_end) != right.size() && equalKeys(x, rightKey(group_end)));
+    }
+
+public:
+    /**
+     * @brief Construct a new JoinIterator at the first pair, or at the end.
+     *
+     * @param l       Sorted runs of the left container.
+     * @param r       Sorted runs of the right container.
+     * @param k       Shared projections.
+     * @param at_end  true for the end iterator.
+     */
+    JoinIterator(SortedRuns<L, LAlloc> l, SortedRuns<R, RAlloc> r, std::shared_ptr<const Keys> k, bool at_end = false)
+        : left(std::move(l)), right(std::move(r)), keys(std::move(k)), a{0, 0}, b{0, 0},
+          group_first{0, 0}, group_end{0, 0}
+    {
+        if (at_end) {
+            toEnd();
+        } else {
+            settle();
+        }
+    }
+
+    /**
+     * @brief The current pair (left element, right element) with equal keys.
+     *
+     * The references point into the shared sorted runs the view was made from.
+     *
+     * @throws std::out_of_range if the iterator is at the end.
+     */
+    reference operator*() const {
+        if (position(a) == left.size()) {
+            throw std::out_of_range("Iterator is out of bounds");
+        }
+        return reference(left.next(a), right.next(b));
+    }
+
+    /**
+     * @brief Prefix increment: the next right element of the group, else the
+     *        next left element with the group rewound, else the next group.
+     *
+     * @throws std::out_of_range if the iterator is at the end.
+     */
+    JoinIterator& operator++() {
+        if (position(a) == left.size()) {
+            throw std::out_of_range("Cannot increment iterator: out of bounds");
+        }
+        right.advance(b);
+        if (position(b) != position(group_end)) {
+            return *this;
+        }
+        left.advance(a);
+        if (position(a) != left.size() && equalKeys(leftKey(a), rightKey(group_first))) {
+            b = group_first;
+            return *this;
+        }
+        b = group_end;
+        settle();
+        return *this;
+    }
+
+    JoinIterator operator++(int) {
+        JoinIterator copy = *this;
+        ++(*this);
+        return copy;
+    }
+
+    /// Iterators over the same runs are equal when they are at the same pair.
+    bool operator==(const JoinIterator& other) const {
+        return position(a) == position(other.a) && position(b) == position(other.b);
+    }
+
+    bool operator!=(const JoinIterator& other) const {
+        return !(*this == other);
+    }
+};
+
+/**
+ * @brief Range of the matching pairs of a sort-merge join of two containers
+ *        (see MyContainer::join).
+ *
+ * The view holds the shared sorted runs it was made from: it stays valid,
+ * and unchanged, when the containers are modified or destroyed.
+ */
+template<typename L, typename LAlloc, typename R, typename RAlloc, typename KeyL, typename KeyR>
+class JoinView {
+public:
+    using iterator = JoinIterator<L, LAlloc, R, RAlloc, KeyL, KeyR>;
+
+private:
+    SortedRuns<L, LAlloc> left;
+    SortedRuns<R, RAlloc> right;
+    std::shared_ptr<const typename iterator::Keys> keys;
+
+    /// Throw unless key never goes down along the whole of runs.
+    template<typename Runs, typename Key>
+    static void checkAscending(const Runs& runs, const Key& key) {
+        using Cursor = typename Runs::Cursor;
+        Cursor previous{0, 0};
+        Cursor c{0, 0};
+        for (std::size_t k = 1; k < runs.size(); ++k) {
+            runs.advance(c);
+            if (std::invoke(key, runs.next(c)) < std::invoke(key, runs.next(previous))) {
+                throw std::runtime_error("Join key is not in ascending order");
+            }
+            previous = c;
+        }
+    }
+
+public:
+    /**
+     * @brief Construct a new JoinView over two sorted runs.
+     *
+     * Both runs are walked once to check the projections, so a key out of
+     * order is reported before any pair is produced. O(n + m).
+     *
+     * @throws std::runtime_error if a key goes down along either run.
+     */
+    JoinView(SortedRuns<L, LAlloc> l, SortedRuns<R, RAlloc> r, KeyL left_key, KeyR right_key)
+        : left(std::move(l)), right(std::move(r)),
+          keys(std::make_shared<const typename iterator::Keys>(
+              typename iterator::Keys{std::move(left_key), std::move(right_key)}))
+    {
+        checkAscending(left, keys->left);
+        checkAscending(right, keys->right);
+    }
+
+    iterator begin() const {
+        return iterator(left, right, keys);
+    }
+
+    iterator end() const {
+        return iterator(left, right, keys, true);
+    }
+};
+
+} // namespace ariel
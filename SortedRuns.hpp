@@ -0,0 +1,254 @@
+//dor.cohen15@msmail.ariel.ac.il
+
+#pragma once
+
+#include <vector>
+#include <memory>      // for std::allocator, std::shared_ptr
+#include <cstddef>     // for std::size_t
+#include <utility>     // for std::move
+#include <algorithm>   // for std::lower_bound, std::upper_bound, std::binary_search
+
+#include "OrderStatisticTree.hpp"
+#include "EytzingerIndex.hpp"
+#include "CountedStorage.hpp"
+
+namespace ariel {
+
+/**
+ * @brief The elements in ascending order as two shared sorted runs: a large
+ *        base and a small delta, read as if merged.
+ *
+ * The merged order is the stable merge of the runs (on equal values the base
+ * element comes first). A Cursor marks a position in that order by how many
+ * elements of each run precede it, so the sorted iterators walk the merge
+ * forwards or backwards in O(1) per step without materializing it.
+ *
+ * The base may also be a snapshot of an OrderStatisticTree (with no delta);
+ * it is then read leaf by leaf, each cursor caching the leaf it is in. Or it
+ * may be a CountedRun (with no delta), read value by value, each cursor caching
+ * the run of copies it is in. A vector base may come with an EytzingerIndex,
+ * which then serves the seeks.
+ *
+ * @tparam T      Element type.
+ * @tparam Alloc  Allocator of the run vectors.
+ */
+template<typename T, typename Alloc = std::allocator<T>>
+class SortedRuns {
+public:
+    using Run = std::shared_ptr<const std::vector<T, Alloc>>;
+    using Search = std::shared_ptr<const EytzingerIndex<T, Alloc>>;
+
+    /// Position in the merged order: base and delta elements before it
+    struct Cursor {
+        std::size_t base;
+        std::size_t delta;
+        /// Contiguous piece of the base last read through this cursor
+        mutable const T* chunk = nullptr;
+        /// Rank of chunk[0] in the base, and length of the piece
+        mutable std::size_t chunk_first = 0;
+        mutable std::size_t chunk_size = 0;
+        /// Applied to offsets into chunk: all ones, or 0 when the piece is
+        /// chunk_size copies of *chunk (counted base)
+        mutable std::size_t chunk_mask = ~std::size_t(0);
+    };
+
+private:
+    Run base_run;
+    Run delta_run;
+    /// Tree base (used when base_run and base_counts are null)
+    OrderStatisticTree<T> base_tree;
+    /// Counted base (may be null)
+    std::shared_ptr<const CountedRun<T>> base_counts;
+    /// Search accelerator of base_run (may be null)
+    Search base_search;
+
+    /// Base element of the given rank, through (and refreshing) c's cached piece
+    const T& baseAt(const Cursor& c, std::size_t rank) const {
+        if (rank - c.chunk_first >= c.chunk_size) {
+            if (base_run) {
+                c.chunk = base_run->data();
+                c.chunk_first = 0;
+                c.chunk_size = base_run->size();
+                c.chunk_mask = ~std::size_t(0);
+            } else if (base_counts) {
+                std::size_t slot = base_counts->slotOf(rank);
+                c.chunk = &base_counts->values[slot];
+                c.chunk_first = base_counts->firstRank(slot);
+                c.chunk_size = base_counts->ends[slot] - c.chunk_first;
+                c.chunk_mask = 0;
+            } else {
+                typename OrderStatisticTree<T>::Chunk leaf = base_tree.chunkAt(rank);
+                c.chunk = leaf.values;
+                c.chunk_first = leaf.first;
+                c.chunk_size = leaf.size;
+                c.chunk_mask = ~std::size_t(0);
+            }
+        }
+        return c.chunk[(rank - c.chunk_first) & c.chunk_mask];
+    }
+
+    static const std::vector<T, Alloc>& empty() {
+        static const std::vector<T, Alloc> none;
+        return none;
+    }
+
+public:
+    /**
+     * @param base   Sorted base run (null: empty).
+     * @param delta  Sorted delta run (null: empty).
+     * @param search Eytzinger layout of base for the seeks (null: binary search).
+     */
+    SortedRuns(Run base = nullptr, Run delta = nullptr, Search search = nullptr)
+        : base_run(std::move(base)), delta_run(std::move(delta)), base_tree(), base_counts(),
+          base_search(std::move(search)) {}
+
+    /**
+     * @param tree  Snapshot of a tree to read as the base (no delta).
+     */
+    explicit SortedRuns(OrderStatisticTree<T> tree)
+        : base_run(), delta_run(), base_tree(std::move(tree)), base_counts(), base_search() {}
+
+    /**
+     * @param counts  Distinct values and counts to read as the base (no delta).
+     */
+    explicit SortedRuns(std::shared_ptr<const CountedRun<T>> counts)
+        : base_run(), delta_run(), base_tree(), base_counts(std::move(counts)), base_search() {}
+
+    /// Shared base run (may be null)
+    const Run& baseRun() const noexcept {
+        return base_run;
+    }
+
+    /// Shared delta run (may be null)
+    const Run& deltaRun() const noexcept {
+        return delta_run;
+    }
+
+    /// Vector base (empty when the base is a tree or counted)
+    const std::vector<T, Alloc>& base() const {
+        return base_run ? *base_run : empty();
+    }
+
+    const std::vector<T, Alloc>& delta() const {
+        return delta_run ? *delta_run : empty();
+    }
+
+    std::size_t baseSize() const {
+        return base_run ? base_run->size() : base_counts ? base_counts->size() : base_tree.size();
+    }
+
+    std::size_t size() const {
+        return baseSize() + delta().size();
+    }
+
+    /**
+     * @brief Cursor before the k-th element of the merged order (k <= size()),
+     *        found by binary search over the split point.
+     */
+    Cursor split(std::size_t k) const {
+        const std::vector<T, Alloc>& d = delta();
+        std::size_t b_size = baseSize();
+        std::size_t lo = (k > d.size()) ? k - d.size() : 0;
+        std::size_t hi = (k < b_size) ? k : b_size;
+        Cursor probe{0, 0};
+        // largest i whose base[i - 1] does not come after delta[k - i]
+        while (lo < hi) {
+            std::size_t i = (lo + hi + 1) / 2;
+            if (k - i == d.size() || !(d[k - i] < baseAt(probe, i - 1))) {
+                lo = i;
+            } else {
+                hi = i - 1;
+            }
+        }
+        Cursor c{lo, k - lo};
+        c.chunk = probe.chunk;
+        c.chunk_first = probe.chunk_first;
+        c.chunk_size = probe.chunk_size;
+        c.chunk_mask = probe.chunk_mask;
+        return c;
+    }
+
+    /// Cursor before the first element not less than value. O(log n).
+    Cursor lowerBound(const T& value) const {
+        const std::vector<T, Alloc>& d = delta();
+        std::size_t in_delta = static_cast<std::size_t>(std::lower_bound(d.begin(), d.end(), value) - d.begin());
+        std::size_t in_base = base_search ? base_search->lowerRank(value)
+            : base_run ? static_cast<std::size_t>(std::lower_bound(base_run->begin(), base_run->end(), value) - base_run->begin())
+            : base_counts ? base_counts->lowerRank(value)
+            : base_tree.lowerRank(value);
+        return Cursor{in_base, in_delta};
+    }
+
+    /// Cursor before the first element greater than value. O(log n).
+    Cursor upperBound(const T& value) const {
+        const std::vector<T, Alloc>& d = delta();
+        std::size_t in_delta = static_cast<std::size_t>(std::upper_bound(d.begin(), d.end(), value) - d.begin());
+        std::size_t in_base = base_search ? base_search->upperRank(value)
+            : base_run ? static_cast<std::size_t>(std::upper_bound(base_run->begin(), base_run->end(), value) - base_run->begin())
+            : base_counts ? base_counts->upperRank(value)
+            : base_tree.upperRank(value);
+        return Cursor{in_base, in_delta};
+    }
+
+    /// Whether some element equals value. O(log n).
+    bool contains(const T& value) const {
+        const std::vector<T, Alloc>& d = delta();
+        if (std::binary_search(d.begin(), d.end(), value)) {
+            return true;
+        }
+        if (base_search) {
+            return base_search->contains(value);
+        }
+        if (base_run) {
+            return std::binary_search(base_run->begin(), base_run->end(), value);
+        }
+        if (base_counts) {
+            return std::binary_search(base_counts->values.begin(), base_counts->values.end(), value);
+        }
+        std::size_t rank = base_tree.lowerRank(value);
+        return rank < base_tree.size() && !(value < base_tree.kth(rank));
+    }
+
+    /// Element right after cursor c (c must not be at the end)
+    const T& next(const Cursor& c) const {
+        const std::vector<T, Alloc>& d = delta();
+        if (c.delta == d.size()) {
+            return baseAt(c, c.base);
+        }
+        if (c.base < baseSize() && !(d[c.delta] < baseAt(c, c.base))) {
+            return baseAt(c, c.base);
+        }
+        return d[c.delta];
+    }
+
+    /// Move cursor c past next(c)
+    void advance(Cursor& c) const {
+        const std::vector<T, Alloc>& d = delta();
+        if (c.delta == d.size() || (c.base < baseSize() && !(d[c.delta] < baseAt(c, c.base)))) {
+            ++c.base;
+        } else {
+            ++c.delta;
+        }
+    }
+
+    /// Element right before cursor c (c must not be at the start)
+    const T& previous(const Cursor& c) const {
+        const std::vector<T, Alloc>& d = delta();
+        if (c.delta == 0 || (c.base > 0 && d[c.delta - 1] < baseAt(c, c.base - 1))) {
+            return baseAt(c, c.base - 1);
+        }
+        return d[c.delta - 1];
+    }
+
+    /// Move cursor c back over previous(c)
+    void retreat(Cursor& c) const {
+        const std::vector<T, Alloc>& d = delta();
+        if (c.delta == 0 || (c.base > 0 && d[c.delta - 1] < baseAt(c, c.base - 1))) {
+            --c.base;
+        } else {
+            --c.delta;
+        }
+    }
+};
+
+} // namespace ariel
@@ -0,0 +1,210 @@
+//dor.cohen15@msmail.ariel.ac.il
+
+#pragma once
+
+#include <charconv>    // for std::to_chars
+#include <cstddef>     // for std::size_t
+#include <locale>      // for std::locale::classic
+#include <ostream>
+#include <system_error> // for std::errc
+#include <type_traits>
+
+#include "TextParser.hpp" // for IS_CHARCONV_NUMBER
+
+namespace ariel {
+
+/**
+ * @brief Whether std::to_chars produces exactly what os << value would.
+ *
+ * That is the case in the classic locale when no flag changes the look of the
+ * number: decimal integers without showpos, and floating point in the default,
+ * fixed or scientific notation without showpos / showpoint / uppercase.
+ */
+template<typename T>
+bool toCharsMatchesStream(const std::ostream& os) {
+    if (os.getloc() != std::locale::classic()) {
+        return false;
+    }
+    std::ios::fmtflags flags = os.flags();
+    if (flags & std::ios::showpos) {
+        return false;
+    }
+    if constexpr (std::is_integral<T>::value) {
+        std::ios::fmtflags base = flags & std::ios::basefield;
+        return base == std::ios::dec || base == std::ios::fmtflags(0);
+    } else {
+        std::ios::fmtflags field = flags & std::ios::floatfield;
+        return !(flags & (std::ios::showpoint | std::ios::uppercase)) &&
+               field != std::ios::floatfield && // hexfloat
+               os.precision() >= 0;
+    }
+}
+
+/**
+ * @brief Render one number the way os << value would, with std::to_chars.
+ *
+ * Only valid when toCharsMatchesStream<T>(os) holds.
+ *
+ * @return char*  One past the last character written, or nullptr if the
+ *                number did not fit in [first, last).
+ */
+template<typename T>
+char* renderNumber(char* first, char* last, const T& value, const std::ostream& os) {
+    std::to_chars_result result;
+    if constexpr (std::is_integral<T>::value) {
+        result = std::to_chars(first, last, value);
+    } else {
+        std::ios::fmtflags field = os.flags() & std::ios::floatfield;
+        std::chars_format format = (field == std::ios::fixed)      ? std::chars_format::fixed
+                                 : (field == std::ios::scientific) ? std::chars_format::scientific
+                                                                   : std::chars_format::general;
+        result = std::to_chars(first, last, value, format, static_cast<int>(os.precision()));
+    }
+    return result.ec == std::errc() ? result.ptr : nullptr;
+}
+
+/**
+ * @brief Streams a "[a, b, c]" list (or "[]") to an std::ostream one element
+ *        at a time, in bounded memory.
+ *
+ * Numbers are rendered with std::to_chars into a 64 KB local buffer that is
+ * written to the stream in large blocks, whenever the stream's flags and
+ * locale allow it (see toCharsMatchesStream); the output is byte-identical to
+ * inserting every element with operator<<. Other types, and numbers under
+ * other formatting flags, are inserted one by one.
+ *
+ * Usage: construct, add() every element in order, then finish().
+ */
+template<typename T>
+class ListWriter {
+private:
+    static constexpr std::size_t BUFFER = 1 << 16;
+    static constexpr std::size_t MARGIN = 512; // room for one ordinary number + ", "
+
+    /// Stream being written to
+    std::ostream& os;
+    /// Whether numbers go through the to_chars buffer
+    bool fast;
+    /// Whether no element was added yet
+    bool empty;
+    /// Pending output of the fast path
+    char buffer[BUFFER];
+    /// End of the pending output in buffer
+    char* pos;
+
+    void flush() {
+        os.write(buffer, pos - buffer);
+        pos = buffer;
+    }
+
+public:
+    explicit ListWriter(std::ostream& out)
+        : os(out), fast(false), empty(true), pos(buffer) {
+        if constexpr (IS_CHARCONV_NUMBER<T>) {
+            fast = toCharsMatchesStream<T>(os);
+        }
+    }
+
+    ListWriter(const ListWriter&) = delete;
+    ListWriter& operator=(const ListWriter&) = delete;
+
+    /**
+     * @brief Append the next element, preceded by ", " unless it is the first.
+     */
+    void add(const T& value) {
+        if (empty) {
+            os << "["; // consumes any width set on the stream, as before
+            empty = false;
+        } else if (fast) {
+            *pos++ = ',';
+            *pos++ = ' ';
+        } else {
+            os << ", ";
+        }
+        if constexpr (IS_CHARCONV_NUMBER<T>) {
+            if (fast) {
+                if (static_cast<std::size_t>(buffer + BUFFER - pos) < MARGIN) {
+                    flush();
+                }
+                char* next = renderNumber(pos, buffer + BUFFER - 3, value, os);
+                if (next == nullptr) { // huge fixed-notation value: let the stream do it
+                    flush();
+                    os << value;
+                } else {
+                    pos = next;
+                }
+                return;
+            }
+        }
+        os << value;
+    }
+
+    /**
+     * @brief Close the list ("]", or "[]" if nothing was added) and flush.
+     */
+    void finish() {
+        if (empty) {
+            os << "[]";
+            return;
+        }
+        if (fast) {
+            *pos++ = ']';
+            flush();
+        } else {
+            os << "]";
+        }
+    }
+};
+
+/**
+ * @brief Print n elements as "[a, b, c]" (or "[]"), element i being get(i).
+ *
+ * @param os   Stream to print to.
+ * @param n    Number of elements.
+ * @param get  Callable returning the i-th element to print.
+ */
+template<typename T, typename Get>
+void formatList(std::ostream& os, std::size_t n, Get get) {
+    ListWriter<T> writer(os);
+    for (std::size_t i = 0; i < n; ++i) {
+        writer.add(get(i));
+    }
+    writer.finish();
+}
+
+/**
+ * @brief Stream adaptor printing the elements of any [first, last) iterator
+ *        pair as "[a, b, c]", e.g.
+ *        os << formatRange(c.begin_side_cross_order(), c.end_side_cross_order()).
+ *
+ * The elements are written as the iterator yields them, nothing is collected.
+ */
+template<typename Iterator>
+class RangeFormatter {
+private:
+    Iterator first;
+    Iterator last;
+
+public:
+    RangeFormatter(Iterator begin, Iterator end) : first(begin), last(end) {}
+
+    friend std::ostream& operator<<(std::ostream& os, const RangeFormatter& range) {
+        using Value = std::remove_cv_t<std::remove_reference_t<decltype(*range.first)>>;
+        ListWriter<Value> writer(os);
+        for (Iterator it = range.first; it != range.last; ++it) {
+            writer.add(*it);
+        }
+        writer.finish();
+        return os;
+    }
+};
+
+/**
+ * @brief Wrap an iterator pair for printing with operator<< (see RangeFormatter).
+ */
+template<typename Iterator>
+RangeFormatter<Iterator> formatRange(Iterator first, Iterator last) {
+    return RangeFormatter<Iterator>(first, last);
+}
+
+} // namespace ariel
@@ -0,0 +1,192 @@
+//dor.cohen15@msmail.ariel.ac.il
+
+#pragma once
+
+#include <charconv>    // for std::from_chars
+#include <algorithm>   // for std::copy
+#include <cstddef>     // for std::size_t
+#include <istream>
+#include <sstream>     // for the generic fallback
+#include <stdexcept>   // for std::runtime_error
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace ariel {
+
+/**
+ * @brief true for the numeric types that std::from_chars / std::to_chars handle
+ *        the same way a stream does.
+ *
+ * bool and the character types are excluded: streams read and print those as
+ * words / characters rather than numbers.
+ */
+template<typename T>
+constexpr bool IS_CHARCONV_NUMBER =
+    std::is_arithmetic<T>::value &&
+    !std::is_same<T, bool>::value &&
+    !std::is_same<T, char>::value &&
+    !std::is_same<T, signed char>::value &&
+    !std::is_same<T, unsigned char>::value &&
+    !std::is_same<T, wchar_t>::value &&
+    !std::is_same<T, char16_t>::value &&
+    !std::is_same<T, char32_t>::value;
+
+/// Separators between values in bulk text input: whitespace and commas.
+inline bool isTextSeparator(char ch) {
+    return ch == ',' || ch == ' ' || ch == '\n' || ch == '\t' || ch == '\r' || ch == '\f' || ch == '\v';
+}
+
+/**
+ * @brief Parse one value from the characters [first, last).
+ *
+ * Numbers use std::from_chars, std::string takes the characters as they are,
+ * any other type is read with its operator>>.
+ *
+ * @return true if the whole range is exactly one valid value.
+ */
+template<typename T>
+bool parseToken(const char* first, const char* last, T& out) {
+    if constexpr (IS_CHARCONV_NUMBER<T>) {
+        auto result = std::from_chars(first, last, out);
+        return result.ec == std::errc() && result.ptr == last;
+    } else if constexpr (std::is_same<T, std::string>::value) {
+        out.assign(first, last);
+        return true;
+    } else {
+        std::istringstream in(std::string(first, last));
+        in >> out;
+        return !in.fail() && (in >> std::ws).eof();
+    }
+}
+
+/**
+ * @brief Parse whitespace- and/or comma-separated values from a stream.
+ *
+ * The stream is read in large chunks; values are parsed in place with
+ * parseToken, and a value cut by a chunk boundary is carried into the next
+ * chunk. Each parsed value is passed to append.
+ *
+ * @param is       Stream to read until its end.
+ * @param append   Called with every parsed value, in order.
+ * @param reserve  Called once, after the first chunk, with an estimate of the
+ *                 number of values in the whole input (seekable streams only).
+ * @return std::size_t  Number of values parsed.
+ * @throws std::runtime_error on a value that does not parse.
+ */
+template<typename T, typename Append, typename Reserve>
+std::size_t parseDelimited(std::istream& is, Append append, Reserve reserve) {
+    constexpr std::size_t CHUNK = 1 << 20;
+
+    // Bytes left in a seekable stream, to size the storage after one chunk
+    std::streamoff total = -1;
+    std::streampos start = is.tellg();
+    if (start != std::streampos(-1)) {
+        is.seekg(0, std::ios::end);
+        total = is.tellg() - start;
+        is.seekg(start);
+    }
+
+    std::vector<char> buffer;
+    std::size_t carried = 0; // bytes of an unfinished value at the front of buffer
+    std::size_t parsed = 0;
+    bool estimated = false;
+    T value{};
+
+    while (true) {
+        buffer.resize(carried + CHUNK);
+        is.read(buffer.data() + carried, static_cast<std::streamsize>(CHUNK));
+        std::size_t got = static_cast<std::size_t>(is.gcount());
+        bool last_chunk = got < CHUNK;
+        const char* pos = buffer.data();
+        const char* end = buffer.data() + carried + got;
+
+        while (pos < end) {
+            while (pos < end && isTextSeparator(*pos)) {
+                ++pos;
+            }
+            const char* token = pos;
+            while (pos < end && !isTextSeparator(*pos)) {
+                ++pos;
+            }
+            if (token == pos) {
+                break;
+            }
+            if (pos == end && !last_chunk) {
+                pos = token; // may continue in the next chunk
+                break;
+            }
+            if (!parseToken(token, pos, value)) {
+                throw std::runtime_error("Invalid value in text input: '" + std::string(token, pos) + "'");
+            }
+            append(value);
+            ++parsed;
+        }
+
+        if (!estimated && total > 0 && parsed > 0) {
+            // values per byte of the first chunk, plus 10% slack
+            double per_byte = static_cast<double>(parsed) / static_cast<double>(got);
+            reserve(static_cast<std::size_t>(per_byte * static_cast<double>(total) * 1.1));
+            estimated = true;
+        }
+        if (last_chunk) {
+            break;
+        }
+        carried = static_cast<std::size_t>(end - pos);
+        std::copy(pos, end, buffer.data());
+    }
+    // Running into the end of the stream is how the input ends, not an error
+    if (is.eof()) {
+        is.clear(is.rdstate() & ~std::ios::failbit);
+    }
+    return parsed;
+}
+
+/**
+ * @brief Parse the inside of a "[a, b, c]" list: comma-separated values, each
+ *        with surrounding whitespace trimmed.
+ *
+ * @param body    The characters between '[' and ']'.
+ * @param append  Called with every parsed value, in order.
+ * @return false if a value does not parse (values before it were appended).
+ */
+template<typename T, typename Append>
+bool parseBracketBody(const std::string& body, Append append) {
+    const char* pos = body.data();
+    const char* end = body.data() + body.size();
+    auto isSpace = [](char ch) { return ch != ',' && isTextSeparator(ch); };
+
+    const char* probe = pos;
+    while (probe < end && isSpace(*probe)) {
+        ++probe;
+    }
+    if (probe == end) {
+        return true; // "[]" or "[   ]"
+    }
+
+    T value{};
+    while (true) {
+        const char* comma = pos;
+        while (comma < end && *comma != ',') {
+            ++comma;
+        }
+        const char* first = pos;
+        const char* last = comma;
+        while (first < last && isSpace(*first)) {
+            ++first;
+        }
+        while (last > first && isSpace(*(last - 1))) {
+            --last;
+        }
+        if (!parseToken(first, last, value)) {
+            return false;
+        }
+        append(value);
+        if (comma == end) {
+            return true;
+        }
+        pos = comma + 1;
+    }
+}
+
+} // namespace ariel
@@ -0,0 +1,400 @@
+//dor.cohen15@msmail.ariel.ac.il
+
+#pragma once
+
+#include <atomic>
+#include <algorithm>   // for std::sort, std::inplace_merge, std::min
+#include <chrono>      // for the wait back-off
+#include <condition_variable>
+#include <cstddef>     // for std::size_t
+#include <cstdlib>     // for std::getenv, std::strtoull
+#include <deque>
+#include <exception>   // for std::exception_ptr
+#include <functional>  // for std::function
+#include <memory>      // for std::unique_ptr
+#include <mutex>
+#include <stdexcept>   // for std::runtime_error
+#include <thread>
+#include <utility>     // for std::move
+#include <vector>
+
+namespace ariel {
+
+/**
+ * @brief Thread pool where every worker owns a task deque and idle workers
+ *        steal from the others.
+ *
+ * A worker pushes and pops tasks at the back of its own deque (newest first,
+ * so a split range stays cache-warm), while thieves take from the front
+ * (oldest first, which is the biggest remaining piece of a split range).
+ * Tasks submitted from outside the pool are spread round-robin.
+ *
+ * parallelFor() is the fork-join entry point: it splits an index range in
+ * halves down to a grain size, and the calling thread works on the range
+ * itself while waiting, so nested calls from inside a task cannot deadlock.
+ */
+class WorkStealingPool {
+private:
+    /// Task deque of one worker
+    struct Queue {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    /// Tasks pushed and not yet taken by anyone
+    std::atomic<std::size_t> queued;
+    /// Next queue for tasks submitted from outside the pool
+    std::atomic<std::size_t> next_queue;
+    std::mutex sleep_lock;
+    std::condition_variable wake;
+    bool stopping;
+
+    /// Pool and queue index of the calling thread, if it is a worker
+    static WorkStealingPool*& currentPool() {
+        static thread_local WorkStealingPool* pool = nullptr;
+        return pool;
+    }
+
+    static std::size_t& currentIndex() {
+        static thread_local std::size_t index = 0;
+        return index;
+    }
+
+    /// Index of the calling worker's own queue, or queues.size() if none
+    std::size_t self() const {
+        return currentPool() == this ? currentIndex() : queues.size();
+    }
+
+    void push(std::function<void()> task) {
+        std::size_t i = self();
+        if (i == queues.size()) {
+            i = next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+        }
+        {
+            std::lock_guard<std::mutex> guard(queues[i]->lock);
+            queues[i]->tasks.push_back(std::move(task));
+        }
+        queued.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> guard(sleep_lock); // no lost wake-up
+        }
+        wake.notify_one();
+    }
+
+    /**
+     * @brief Run one task: the newest of queue own, else the oldest of another queue.
+     *
+     * @return false if every queue was empty.
+     */
+    bool runOne(std::size_t own) {
+        std::function<void()> task;
+        std::size_t n = queues.size();
+        for (std::size_t k = 0; k < n && !task; ++k) {
+            std::size_t i = (own == n) ? k : (own + k) % n;
+            std::lock_guard<std::mutex> guard(queues[i]->lock);
+            std::deque<std::function<void()>>& tasks = queues[i]->tasks;
+            if (tasks.empty()) {
+                continue;
+            }
+            if (i == own) {
+                task = std::move(tasks.back());
+                tasks.pop_back();
+            } else {
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+        }
+        if (!task) {
+            return false;
+        }
+        queued.fetch_sub(1);
+        task();
+        return true;
+    }
+
+    void workerLoop(std::size_t index) {
+        currentPool() = this;
+        currentIndex() = index;
+        while (true) {
+            if (runOne(index)) {
+                continue;
+            }
+            std::unique_lock<std::mutex> guard(sleep_lock);
+            wake.wait(guard, [this]() { return stopping || queued.load() > 0; });
+            if (stopping && queued.load() == 0) {
+                return;
+            }
+        }
+    }
+
+public:
+    /**
+     * @brief Start the pool.
+     *
+     * @param workers  Number of worker threads (0: one per hardware thread).
+     */
+    explicit WorkStealingPool(std::size_t workers = 0)
+        : queues(), threads(), queued(0), next_queue(0), sleep_lock(), wake(), stopping(false)
+    {
+        if (workers == 0) {
+            workers = std::thread::hardware_concurrency();
+        }
+        if (workers == 0) {
+            workers = 1;
+        }
+        for (std::size_t i = 0; i < workers; ++i) {
+            queues.push_back(std::make_unique<Queue>());
+        }
+        for (std::size_t i = 0; i < workers; ++i) {
+            threads.emplace_back([this, i]() { workerLoop(i); });
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /**
+     * @brief Finish every queued task, then stop the workers.
+     */
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> guard(sleep_lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    std::size_t workerCount() const noexcept {
+        return threads.size();
+    }
+
+    /**
+     * @brief Queue a task to run on a worker and return right away
+     *        (fire and forget, e.g. a background rebuild).
+     *
+     * @param task  Callable that must not throw; it may still be queued when
+     *              the caller returns, so it must own what it uses.
+     */
+    void submit(std::function<void()> task) {
+        push(std::move(task));
+    }
+
+    /**
+     * @brief Fork-join of two tasks: run f and g in parallel, return when both finished.
+     *
+     * @throws Rethrows the first exception thrown by f or g.
+     */
+    template<typename F, typename G>
+    void invoke(const F& f, const G& g) {
+        parallelFor(2, 1, [&f, &g](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                if (i == 0) {
+                    f();
+                } else {
+                    g();
+                }
+            }
+        });
+    }
+
+    /**
+     * @brief Run body(begin, end) over sub-ranges covering [0, n) in parallel
+     *        and return when all of them finished.
+     *
+     * The range is halved until a piece holds at most grain indices; the
+     * halves are pushed for other workers to steal. The caller runs pieces
+     * too while it waits, and sleeps (with a bounded back-off) when there is
+     * nothing to run. If a piece cannot be queued, it is skipped and the
+     * push error is rethrown once the queued pieces finished.
+     *
+     * @param n      Number of indices.
+     * @param grain  Largest piece handed to one body call (0: about 8 pieces
+     *               per thread).
+     * @param body   Callable taking (std::size_t begin, std::size_t end).
+     * @throws Rethrows the first exception thrown by body or by queueing a
+     *         piece, once every queued piece finished.
+     */
+    template<typename Body>
+    void parallelFor(std::size_t n, std::size_t grain, const Body& body) {
+        if (n == 0) {
+            return;
+        }
+        if (grain == 0) {
+            grain = n / (8 * (workerCount() + 1));
+        }
+        if (grain == 0) {
+            grain = 1;
+        }
+        std::atomic<std::size_t> remaining(n);
+        std::mutex error_lock;
+        std::exception_ptr error;
+        // Set under done_lock by the call that finishes the last index; the
+        // caller returns only after seeing it, so no finisher touches this
+        // call's state afterwards
+        std::mutex done_lock;
+        std::condition_variable done;
+        bool finished = false;
+        // Set instead when the caller finishes the last index itself (no lock needed)
+        const std::thread::id caller = std::this_thread::get_id();
+        bool finished_here = false;
+
+        auto fail = [&](std::exception_ptr e) {
+            std::lock_guard<std::mutex> guard(error_lock);
+            if (!error) {
+                error = std::move(e);
+            }
+        };
+        auto finish = [&](std::size_t count) {
+            if (remaining.fetch_sub(count) == count) {
+                if (std::this_thread::get_id() == caller) {
+                    finished_here = true;
+                    return;
+                }
+                std::lock_guard<std::mutex> guard(done_lock);
+                finished = true;
+                done.notify_all();
+            }
+        };
+
+        std::function<void(std::size_t, std::size_t)> split;
+        split = [&](std::size_t begin, std::size_t end) {
+            while (end - begin > grain) {
+                std::size_t middle = begin + (end - begin) / 2;
+                try {
+                    push([&split, middle, end]() { split(middle, end); });
+                } catch (...) { // e.g. bad_alloc growing a deque: [begin, end) never runs
+                    fail(std::current_exception());
+                    finish(end - begin);
+                    return;
+                }
+                end = middle;
+            }
+            try {
+                body(begin, end);
+            } catch (...) {
+                fail(std::current_exception());
+            }
+            finish(end - begin);
+        };
+
+        split(0, n);
+        // Help with queued tasks; when there are none, sleep with a back-off
+        // (doubling up to MAX_PAUSE) until woken by the last finisher
+        constexpr std::chrono::microseconds FIRST_PAUSE(16);
+        constexpr std::chrono::microseconds MAX_PAUSE(2048);
+        std::chrono::microseconds pause = FIRST_PAUSE;
+        std::size_t own = self();
+        while (!finished_here) {
+            if (runOne(own)) {
+                pause = FIRST_PAUSE;
+                continue;
+            }
+            std::unique_lock<std::mutex> guard(done_lock);
+            if (done.wait_for(guard, pause, [&finished]() { return finished; })) {
+                break;
+            }
+            pause = std::min(pause * 2, MAX_PAUSE);
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+/**
+ * @brief Requested size of defaultPool() and whether it already started.
+ */
+struct DefaultPoolSettings {
+    std::mutex lock;
+    std::size_t workers = 0;
+    bool started = false;
+};
+
+inline DefaultPoolSettings& defaultPoolSettings() {
+    static DefaultPoolSettings settings;
+    return settings;
+}
+
+/**
+ * @brief The project-wide pool that every parallel path uses: parallel sort
+ *        of the sorted cache, parallel remove, parallel_for_each /
+ *        parallel_reduce and ShardedContainer::forEachShard.
+ *
+ * Started on first use with the worker count set by setDefaultPoolWorkers(),
+ * else the MYCONTAINER_WORKERS environment variable, else one worker per
+ * hardware thread.
+ */
+inline WorkStealingPool& defaultPool() {
+    static WorkStealingPool pool([]() {
+        DefaultPoolSettings& settings = defaultPoolSettings();
+        std::lock_guard<std::mutex> guard(settings.lock);
+        settings.started = true;
+        std::size_t workers = settings.workers;
+        if (workers == 0) {
+            if (const char* env = std::getenv("MYCONTAINER_WORKERS")) {
+                workers = static_cast<std::size_t>(std::strtoull(env, nullptr, 10));
+            }
+        }
+        return workers;
+    }());
+    return pool;
+}
+
+/**
+ * @brief Set the number of workers of defaultPool() (0: one per hardware thread).
+ *
+ * @throws std::runtime_error if defaultPool() already started.
+ */
+inline void setDefaultPoolWorkers(std::size_t workers) {
+    DefaultPoolSettings& settings = defaultPoolSettings();
+    std::lock_guard<std::mutex> guard(settings.lock);
+    if (settings.started) {
+        throw std::runtime_error("Default pool already started");
+    }
+    settings.workers = workers;
+}
+
+/**
+ * @brief Sort v on the pool: sort equal pieces in parallel, then merge
+ *        neighbouring pieces pairwise, one parallel round per doubling.
+ */
+template<typename T, typename Alloc>
+void parallelSort(std::vector<T, Alloc>& v, WorkStealingPool& pool) {
+    std::size_t n = v.size();
+    std::size_t pieces = 4 * (pool.workerCount() + 1);
+    if (pieces > n / 1024) {
+        pieces = n / 1024;
+    }
+    if (pieces < 2) {
+        std::sort(v.begin(), v.end());
+        return;
+    }
+    auto bound = [n, pieces](std::size_t i) {
+        return static_cast<std::ptrdiff_t>(i >= pieces ? n : i * (n / pieces));
+    };
+    pool.parallelFor(pieces, 1, [&](std::size_t first, std::size_t last) {
+        for (std::size_t i = first; i < last; ++i) {
+            std::sort(v.begin() + bound(i), v.begin() + bound(i + 1));
+        }
+    });
+    for (std::size_t width = 1; width < pieces; width *= 2) {
+        std::size_t pairs = (pieces + 2 * width - 1) / (2 * width);
+        pool.parallelFor(pairs, 1, [&](std::size_t first, std::size_t last) {
+            for (std::size_t j = first; j < last; ++j) {
+                std::size_t left = 2 * width * j;
+                if (left + width < pieces) {
+                    std::inplace_merge(v.begin() + bound(left),
+                                       v.begin() + bound(left + width),
+                                       v.begin() + bound(left + 2 * width));
+                }
+            }
+        });
+    }
+}
+
+} // namespace ariel
@@ -4,8 +4,20 @@
 #include "doctest.h"
 
 #include "MyContainer.hpp"
+#include "ConcurrentContainer.hpp"
+#include "ConcurrentAppender.hpp"
+#include "ShardedContainer.hpp"
+#include "MergeIterator.hpp"
+#include "ParallelAlgorithms.hpp"
 #include <sstream>
 #include <type_traits>
+#include <fstream>
+#include <cstdio>
+#include <iomanip>
+#include <limits>
+#include <thread>
+#include <atomic>
+#include <chrono>
 
 using namespace ariel;
 
@@ -800,3 +812,2316 @@ TEST_CASE("Chained removes and re-adding elements maintains correct iteration or
         CHECK(data == std::vector<int>{3, 1, 4});
     }
 }
+
+TEST_CASE("Segmented storage: all iterators and operator<< across chunk boundaries") {
+    // Chunks of 4 elements, so 10 elements span three chunks
+    MyContainer<int, SegmentedStorage<int, 4>> c;
+    std::vector<int> expected;
+    for (int v : {9, 3, 7, 1, 8, 2, 6, 0, 5, 4}) {
+        c.addElement(v);
+        expected.push_back(v);
+    }
+    CHECK(c.size() == 10);
+    CHECK(collectIterator(c.begin_order(), c.end_order()) == expected);
+    CHECK(collectIterator(c.begin_ascending_order(), c.end_ascending_order())
+          == std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9});
+    CHECK(collectIterator(c.begin_descending_order(), c.end_descending_order())
+          == std::vector<int>{9, 8, 7, 6, 5, 4, 3, 2, 1, 0});
+    CHECK(collectIterator(c.begin_side_cross_order(), c.end_side_cross_order())
+          == std::vector<int>{0, 9, 1, 8, 2, 7, 3, 6, 4, 5});
+    CHECK(collectIterator(c.begin_reverse_order(), c.end_reverse_order())
+          == std::vector<int>{4, 5, 0, 6, 2, 8, 1, 7, 3, 9});
+    CHECK(collectIterator(c.begin_middle_out_order(), c.end_middle_out_order())
+          == std::vector<int>{2, 8, 6, 1, 0, 7, 5, 3, 4, 9});
+
+    std::ostringstream os;
+    os << c;
+    CHECK(os.str() == "[9, 3, 7, 1, 8, 2, 6, 0, 5, 4]");
+
+    // Removal compacts across chunks and releases the emptied tail chunk
+    c.addElement(3);
+    c.remove(3);
+    CHECK(c.size() == 9);
+    CHECK(collectIterator(c.begin_order(), c.end_order())
+          == std::vector<int>{9, 7, 1, 8, 2, 6, 0, 5, 4});
+    CHECK_THROWS_AS(c.remove(3), std::runtime_error);
+
+    SegmentedContainer<std::string> s;
+    s.addElement("b");
+    s.addElement("a");
+    std::ostringstream os2;
+    os2 << s;
+    CHECK(os2.str() == "[b, a]");
+
+    // Copies keep every chunk reserved: filling a copied partial chunk moves nothing
+    SegmentedStorage<int, 8> original;
+    for (int v = 0; v < 11; ++v) {
+        original.push_back(v);
+    }
+    SegmentedStorage<int, 8> copied(original);
+    SegmentedStorage<int, 8> assigned;
+    assigned.push_back(-1);
+    assigned = original;
+    for (SegmentedStorage<int, 8>* storage : {&copied, &assigned}) {
+        const int* first = &(*storage)[0];
+        const int* partial = &(*storage)[8];
+        for (int v = 11; v < 16; ++v) {
+            storage->push_back(v);
+        }
+        CHECK(&(*storage)[0] == first);
+        CHECK(&(*storage)[8] == partial);
+        CHECK(std::vector<int>(storage->begin(), storage->end()) == std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15});
+    }
+    CHECK(original.size() == 11);
+}
+
+TEST_CASE("Mmap storage: growth via mremap, copies, iterators and removal") {
+    MmapContainer<int> c;
+    // 1M ints (4 MB) forces the mapping to be remapped past one huge page
+    const int n = 1000000;
+    for (int i = n - 1; i >= 0; --i) {
+        c.addElement(i);
+    }
+    CHECK(c.size() == static_cast<std::size_t>(n));
+    {
+        auto it = c.begin_ascending_order();
+        bool sorted = true;
+        for (int i = 0; i < n; ++i, ++it) {
+            sorted = sorted && (*it == i);
+        }
+        CHECK(sorted);
+        CHECK(it == c.end_ascending_order());
+    }
+    CHECK(*c.begin_order() == n - 1);
+    CHECK(*c.begin_reverse_order() == 0);
+
+    // A copy owns its own mapping
+    MmapContainer<int> copy = c;
+    c.remove(0);
+    CHECK(c.size() == static_cast<std::size_t>(n - 1));
+    CHECK(copy.size() == static_cast<std::size_t>(n));
+    CHECK(*copy.begin_reverse_order() == 0);
+
+    MmapContainer<int> small;
+    for (int v : {7, 15, 6, 1, 2}) {
+        small.addElement(v);
+    }
+    CHECK(collectIterator(small.begin_side_cross_order(), small.end_side_cross_order())
+          == std::vector<int>{1, 15, 2, 7, 6});
+    CHECK(collectIterator(small.begin_middle_out_order(), small.end_middle_out_order())
+          == std::vector<int>{6, 15, 1, 7, 2});
+    CHECK(collectIterator(small.begin_descending_order(), small.end_descending_order())
+          == std::vector<int>{15, 7, 6, 2, 1});
+    small.remove(6);
+    std::ostringstream os;
+    os << small;
+    CHECK(os.str() == "[7, 15, 1, 2]");
+}
+
+TEST_CASE("saveFile / mapFile round trip with and without sorted permutation") {
+    const std::string path = "mycontainer_test.bin";
+    MyContainer<int> c;
+    for (int v : {7, 15, 6, 1, 2, 6}) {
+        c.addElement(v);
+    }
+
+    for (bool with_permutation : {true, false}) {
+        c.saveFile(path, with_permutation);
+        auto m = MyContainer<int>::mapFile(path);
+        CHECK(m.size() == 6);
+        CHECK(collectIterator(m.begin_order(), m.end_order())
+              == std::vector<int>{7, 15, 6, 1, 2, 6});
+        CHECK(collectIterator(m.begin_ascending_order(), m.end_ascending_order())
+              == std::vector<int>{1, 2, 6, 6, 7, 15});
+        CHECK(collectIterator(m.begin_descending_order(), m.end_descending_order())
+              == std::vector<int>{15, 7, 6, 6, 2, 1});
+        CHECK(collectIterator(m.begin_side_cross_order(), m.end_side_cross_order())
+              == std::vector<int>{1, 15, 2, 7, 6, 6});
+
+        // Modifying the mapped container never touches the file
+        m.remove(6);
+        m.addElement(0);
+        CHECK(collectIterator(m.begin_ascending_order(), m.end_ascending_order())
+              == std::vector<int>{0, 1, 2, 7, 15});
+        auto again = MyContainer<int>::mapFile(path);
+        CHECK(again.size() == 6);
+    }
+
+    // Segmented storage is written through the block path
+    SegmentedContainer<int> s;
+    for (int i = 0; i < 10000; ++i) {
+        s.addElement(10000 - i);
+    }
+    s.saveFile(path);
+    auto ms = SegmentedContainer<int>::mapFile(path);
+    CHECK(ms.size() == 10000);
+    CHECK(*ms.begin_ascending_order() == 1);
+    CHECK(*ms.begin_order() == 10000);
+
+    // Wrong element type and garbage files are rejected
+    CHECK_THROWS_AS(MyContainer<long long>::mapFile(path), std::runtime_error);
+    {
+        std::ofstream garbage(path, std::ios::binary | std::ios::trunc);
+        garbage << std::string(100, 'x');
+    }
+    CHECK_THROWS_AS(MyContainer<int>::mapFile(path), std::runtime_error);
+    CHECK_THROWS_AS(MyContainer<int>::mapFile("no_such_file.bin"), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Binary save/load through streams and buffers") {
+    MyContainer<int> c;
+    for (int v : {5, -3, 5, 1000000, 0}) {
+        c.addElement(v);
+    }
+
+    // Stream round trip
+    std::stringstream stream(std::ios::in | std::ios::out | std::ios::binary);
+    c.save(stream);
+    MyContainer<int> fromStream;
+    fromStream.addElement(99); // replaced by load
+    fromStream.load(stream);
+    CHECK(collectIterator(fromStream.begin_order(), fromStream.end_order())
+          == std::vector<int>{5, -3, 5, 1000000, 0});
+    CHECK(collectIterator(fromStream.begin_ascending_order(), fromStream.end_ascending_order())
+          == std::vector<int>{-3, 0, 5, 5, 1000000});
+
+    // Buffer round trip, into other storage policies
+    std::vector<char> buffer;
+    c.save(buffer);
+    SegmentedContainer<int> seg;
+    seg.load(buffer.data(), buffer.size());
+    MmapContainer<int> mapped;
+    mapped.load(buffer.data(), buffer.size());
+    CHECK(collectIterator(seg.begin_order(), seg.end_order())
+          == std::vector<int>{5, -3, 5, 1000000, 0});
+    CHECK(collectIterator(mapped.begin_order(), mapped.end_order())
+          == std::vector<int>{5, -3, 5, 1000000, 0});
+
+    // Truncated data throws and leaves the target untouched
+    MyContainer<int> target;
+    target.addElement(1);
+    CHECK_THROWS_AS(target.load(buffer.data(), buffer.size() - 1), std::runtime_error);
+    CHECK_THROWS_AS(target.load(buffer.data(), 10), std::runtime_error);
+    CHECK(collectIterator(target.begin_order(), target.end_order()) == std::vector<int>{1});
+
+    // Element type must match
+    MyContainer<double> wrong;
+    CHECK_THROWS_AS(wrong.load(buffer.data(), buffer.size()), std::runtime_error);
+    MyContainer<std::string> wrongString;
+    CHECK_THROWS_AS(wrongString.load(buffer.data(), buffer.size()), std::runtime_error);
+
+    // Empty container
+    MyContainer<int> empty;
+    std::vector<char> emptyBuffer;
+    empty.save(emptyBuffer);
+    c.load(emptyBuffer.data(), emptyBuffer.size());
+    CHECK(c.size() == 0);
+}
+
+TEST_CASE("Binary save/load of std::string uses length-prefixed elements") {
+    MyContainer<std::string> c;
+    c.addElement("alpha");
+    c.addElement("");
+    c.addElement(std::string("with\0nul", 8));
+    c.addElement("beta, gamma");
+
+    std::stringstream stream(std::ios::in | std::ios::out | std::ios::binary);
+    c.save(stream);
+    MyContainer<std::string> back;
+    back.load(stream);
+    CHECK(collectIterator(back.begin_order(), back.end_order())
+          == std::vector<std::string>{"alpha", "", std::string("with\0nul", 8), "beta, gamma"});
+
+    std::vector<char> buffer;
+    c.save(buffer);
+    CHECK_THROWS_AS(back.load(buffer.data(), buffer.size() - 3), std::runtime_error);
+    CHECK(back.size() == 4);
+    MyContainer<int> wrong;
+    CHECK_THROWS_AS(wrong.load(buffer.data(), buffer.size()), std::runtime_error);
+}
+
+TEST_CASE("Binary load rejects corrupt counts and lengths with runtime_error") {
+    // Overwrite the element count of a saved header
+    auto withCount = [](std::vector<char> bytes, std::uint64_t count) {
+        FileHeader header;
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        header.count = count;
+        std::memcpy(bytes.data(), &header, sizeof(header));
+        return bytes;
+    };
+    MyContainer<int> c;
+    for (int v : {1, 2, 3}) {
+        c.addElement(v);
+    }
+    std::vector<char> buffer;
+    c.save(buffer);
+    for (std::uint64_t count : {std::uint64_t(4), std::uint64_t(1) << 40, ~std::uint64_t(0)}) {
+        std::vector<char> bad = withCount(buffer, count);
+        MyContainer<int> target;
+        target.addElement(9);
+        CHECK_THROWS_AS(target.load(bad.data(), bad.size()), std::runtime_error);
+        std::stringstream stream(std::string(bad.begin(), bad.end()));
+        CHECK_THROWS_AS(target.load(stream), std::runtime_error);
+        SegmentedContainer<int> seg;
+        CHECK_THROWS_AS(seg.load(bad.data(), bad.size()), std::runtime_error);
+        CHECK(collectIterator(target.begin_order(), target.end_order()) == std::vector<int>{9});
+    }
+
+    // Oversized string length (and string count)
+    MyContainer<std::string> words;
+    words.addElement("abc");
+    std::vector<char> text;
+    words.save(text);
+    std::uint64_t huge = std::uint64_t(1) << 50;
+    std::vector<char> badLength = text;
+    std::memcpy(badLength.data() + sizeof(FileHeader), &huge, sizeof(huge));
+    MyContainer<std::string> back;
+    CHECK_THROWS_AS(back.load(badLength.data(), badLength.size()), std::runtime_error);
+    std::stringstream stream(std::string(badLength.begin(), badLength.end()));
+    CHECK_THROWS_AS(back.load(stream), std::runtime_error);
+    std::vector<char> badCount = withCount(text, huge);
+    CHECK_THROWS_AS(back.load(badCount.data(), badCount.size()), std::runtime_error);
+    std::stringstream countStream(std::string(badCount.begin(), badCount.end()));
+    CHECK_THROWS_AS(back.load(countStream), std::runtime_error);
+    CHECK(back.size() == 0);
+}
+
+TEST_CASE("operator>> reads the operator<< format back") {
+    MyContainer<int> c;
+    for (int v : {7, -15, 6, 1, 2}) {
+        c.addElement(v);
+    }
+    std::stringstream ss;
+    ss << c;
+    MyContainer<int> back;
+    back.addElement(42); // replaced
+    ss >> back;
+    CHECK(!ss.fail());
+    CHECK(collectIterator(back.begin_order(), back.end_order())
+          == std::vector<int>{7, -15, 6, 1, 2});
+
+    // Empty list, extra whitespace, several lists in one stream
+    std::istringstream in("  []  [ 1 ,2,  3 ] [4]");
+    MyContainer<int> a, b, d;
+    in >> a >> b >> d;
+    CHECK(!in.fail());
+    CHECK(a.size() == 0);
+    CHECK(collectIterator(b.begin_order(), b.end_order()) == std::vector<int>{1, 2, 3});
+    CHECK(collectIterator(d.begin_order(), d.end_order()) == std::vector<int>{4});
+
+    // Malformed input sets failbit and keeps the old contents
+    for (const char* bad : {"1, 2]", "[1, x, 3]", "[1, 2", "[1,,2]", "[2147483648]"}) {
+        std::istringstream badIn(bad);
+        badIn >> back;
+        CHECK(badIn.fail());
+        CHECK(back.size() == 5);
+    }
+
+    // Strings and doubles
+    std::istringstream words("[foo, bar baz, qux]");
+    MyContainer<std::string> s;
+    words >> s;
+    CHECK(collectIterator(s.begin_order(), s.end_order())
+          == std::vector<std::string>{"foo", "bar baz", "qux"});
+    std::istringstream reals("[1.5, -2e3, 0.25]");
+    MyContainer<double> r;
+    reals >> r;
+    CHECK(collectIterator(r.begin_order(), r.end_order()) == std::vector<double>{1.5, -2000.0, 0.25});
+}
+
+TEST_CASE("loadText bulk loads whitespace and comma separated values") {
+    std::istringstream in("5 3\n8,1,\t-4\r\n\n  100");
+    MyContainer<int> c;
+    c.addElement(0);
+    CHECK(c.loadText(in) == 6);
+    CHECK(!in.fail());
+    CHECK(collectIterator(c.begin_order(), c.end_order()) == std::vector<int>{0, 5, 3, 8, 1, -4, 100});
+    CHECK(*c.begin_ascending_order() == -4);
+
+    // Values spanning the 1 MB chunk boundary are carried over intact
+    std::string big;
+    const int n = 300000;
+    for (int i = 0; i < n; ++i) {
+        big += std::to_string(i * 7);
+        big += (i % 10 == 9) ? '\n' : ',';
+    }
+    std::istringstream bigIn(big);
+    SegmentedContainer<int> s;
+    CHECK(s.loadText(bigIn) == static_cast<std::size_t>(n));
+    bool ok = true;
+    std::size_t i = 0;
+    for (auto it = s.begin_order(); it != s.end_order(); ++it, ++i) {
+        ok = ok && (*it == static_cast<int>(i) * 7);
+    }
+    CHECK(ok);
+
+    // Invalid values throw
+    std::istringstream bad("1 2 three 4");
+    MyContainer<int> b;
+    CHECK_THROWS_AS(b.loadText(bad), std::runtime_error);
+
+    std::istringstream words("alpha beta,gamma");
+    MyContainer<std::string> w;
+    CHECK(w.loadText(words) == 3);
+    CHECK(collectIterator(w.begin_order(), w.end_order())
+          == std::vector<std::string>{"alpha", "beta", "gamma"});
+}
+
+//-----------------------------------------------------------------------------
+// Helper: the element-by-element operator<< output, as a reference for the
+// buffered to_chars path. `configure` applies the same flags to both streams.
+//-----------------------------------------------------------------------------
+template<typename T, typename Configure>
+void checkSameAsStreamInsertion(const std::vector<T>& values, Configure configure) {
+    MyContainer<T> c;
+    for (const T& v : values) {
+        c.addElement(v);
+    }
+    std::ostringstream fast;
+    std::ostringstream reference;
+    configure(fast);
+    configure(reference);
+    fast << c;
+    if (values.empty()) {
+        reference << "[]";
+    } else {
+        reference << "[";
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            reference << values[i];
+            if (i + 1 < values.size()) reference << ", ";
+        }
+        reference << "]";
+    }
+    CHECK(fast.str() == reference.str());
+}
+
+TEST_CASE("operator<< to_chars fast path is byte-identical to stream insertion") {
+    auto plain = [](std::ostream&) {};
+    std::vector<int> ints{0, -1, 42, std::numeric_limits<int>::min(), std::numeric_limits<int>::max()};
+    checkSameAsStreamInsertion(ints, plain);
+    checkSameAsStreamInsertion(std::vector<int>{}, plain);
+    checkSameAsStreamInsertion(std::vector<unsigned long long>{0, std::numeric_limits<unsigned long long>::max()}, plain);
+    checkSameAsStreamInsertion(std::vector<short>{-32768, 7}, plain);
+
+    std::vector<double> reals{0.0, -0.0, 1.5, 1.0 / 3.0, 1e300, -2.5e-300, 123456789.0, 100.0,
+                              std::numeric_limits<double>::infinity(), std::numeric_limits<double>::quiet_NaN()};
+    checkSameAsStreamInsertion(reals, plain);
+    checkSameAsStreamInsertion(std::vector<float>{0.1f, 3.0f, -1e10f}, plain);
+    checkSameAsStreamInsertion(std::vector<long double>{0.1L, 2.0L}, plain);
+    checkSameAsStreamInsertion(reals, [](std::ostream& os) { os << std::setprecision(17); });
+    checkSameAsStreamInsertion(reals, [](std::ostream& os) { os << std::setprecision(0); });
+    checkSameAsStreamInsertion(reals, [](std::ostream& os) { os << std::fixed << std::setprecision(3); });
+    checkSameAsStreamInsertion(reals, [](std::ostream& os) { os << std::scientific; });
+
+    // Flags the fast path does not handle fall back to the stream
+    checkSameAsStreamInsertion(ints, [](std::ostream& os) { os << std::hex << std::showbase; });
+    checkSameAsStreamInsertion(ints, [](std::ostream& os) { os << std::showpos; });
+    checkSameAsStreamInsertion(reals, [](std::ostream& os) { os << std::uppercase << std::showpoint; });
+    checkSameAsStreamInsertion(reals, [](std::ostream& os) { os << std::hexfloat; });
+    checkSameAsStreamInsertion(ints, [](std::ostream& os) { os << std::setw(6) << std::setfill('*'); });
+    checkSameAsStreamInsertion(std::vector<char>{'a', 'b'}, plain);
+    checkSameAsStreamInsertion(std::vector<bool>{true, false}, plain);
+
+    // More elements than fit into one output buffer
+    std::vector<long long> many;
+    for (long long i = 0; i < 50000; ++i) {
+        many.push_back(i * 1000003 - 25000000000LL);
+    }
+    checkSameAsStreamInsertion(many, plain);
+
+    // Huge fixed-notation values exceed the buffer and are streamed directly
+    checkSameAsStreamInsertion(std::vector<double>{1e300, 1.0, -1e308}, [](std::ostream& os) {
+        os << std::fixed << std::setprecision(400);
+    });
+}
+
+TEST_CASE("print(os, Order) and formatRange stream every traversal order") {
+    MyContainer<int> c;
+    for (int v : {7, 15, 6, 1, 2}) {
+        c.addElement(v);
+    }
+    auto printed = [&c](Order order) {
+        std::ostringstream os;
+        c.print(os, order);
+        return os.str();
+    };
+    CHECK(printed(Order::Insertion) == "[7, 15, 6, 1, 2]");
+    CHECK(printed(Order::Ascending) == "[1, 2, 6, 7, 15]");
+    CHECK(printed(Order::Descending) == "[15, 7, 6, 2, 1]");
+    CHECK(printed(Order::SideCross) == "[1, 15, 2, 7, 6]");
+    CHECK(printed(Order::Reverse) == "[2, 1, 6, 15, 7]");
+    CHECK(printed(Order::MiddleOut) == "[6, 15, 1, 7, 2]");
+
+    // Even count and the iterator adaptor agree with print
+    c.addElement(4);
+    auto viaRange = [](auto begin, auto end) {
+        std::ostringstream os;
+        os << formatRange(begin, end);
+        return os.str();
+    };
+    CHECK(printed(Order::MiddleOut) == viaRange(c.begin_middle_out_order(), c.end_middle_out_order()));
+    CHECK(printed(Order::SideCross) == viaRange(c.begin_side_cross_order(), c.end_side_cross_order()));
+    CHECK(printed(Order::Descending) == viaRange(c.begin_descending_order(), c.end_descending_order()));
+    CHECK(printed(Order::Reverse) == viaRange(c.begin_reverse_order(), c.end_reverse_order()));
+    CHECK(printed(Order::Insertion) == viaRange(c.begin_order(), c.end_order()));
+
+    // Index mapping matches the iterators for every small size
+    for (int n = 1; n <= 12; ++n) {
+        MyContainer<int> d;
+        for (int i = 0; i < n; ++i) {
+            d.addElement((i * 5) % 7);
+        }
+        std::ostringstream a, b, x, y;
+        d.print(a, Order::MiddleOut);
+        b << formatRange(d.begin_middle_out_order(), d.end_middle_out_order());
+        d.print(x, Order::SideCross);
+        y << formatRange(d.begin_side_cross_order(), d.end_side_cross_order());
+        CHECK(a.str() == b.str());
+        CHECK(x.str() == y.str());
+    }
+
+    // Empty container and non-numeric elements
+    MyContainer<int> empty;
+    std::ostringstream os;
+    empty.print(os, Order::Ascending);
+    os << formatRange(empty.begin_middle_out_order(), empty.end_middle_out_order());
+    CHECK(os.str() == "[][]");
+
+    MyContainer<std::string> words;
+    words.addElement("pear");
+    words.addElement("apple");
+    words.addElement("fig");
+    std::ostringstream ws;
+    words.print(ws, Order::Descending);
+    CHECK(ws.str() == "[pear, fig, apple]");
+
+    // Every storage and sorted source streams the same text as the iterators:
+    // counted storage (read from its counts), a delta run, and the tree index
+    CountedContainer<int> counted;
+    MyContainer<int> runs;
+    MyContainer<int> tree;
+    tree.setTreeIndex(true);
+    for (int i = 0; i < 300; ++i) {
+        int v = (i * 37) % 11 - 3;
+        counted.addElement(v);
+        runs.addElement(v);
+        tree.addElement(v);
+        if (i == 150) {
+            (void)runs.begin_ascending_order(); // sorted base, later appends go to the delta
+        }
+    }
+    auto matches = [&viaRange](const auto& d) {
+        for (Order order : {Order::Insertion, Order::Ascending, Order::Descending,
+                            Order::SideCross, Order::Reverse, Order::MiddleOut}) {
+            std::ostringstream out;
+            d.print(out, order);
+            std::string expected;
+            switch (order) {
+                case Order::Ascending:
+                    expected = viaRange(d.begin_ascending_order(), d.end_ascending_order());
+                    break;
+                case Order::Descending:
+                    expected = viaRange(d.begin_descending_order(), d.end_descending_order());
+                    break;
+                case Order::SideCross:
+                    expected = viaRange(d.begin_side_cross_order(), d.end_side_cross_order());
+                    break;
+                case Order::Reverse:
+                    expected = viaRange(d.begin_reverse_order(), d.end_reverse_order());
+                    break;
+                case Order::MiddleOut:
+                    expected = viaRange(d.begin_middle_out_order(), d.end_middle_out_order());
+                    break;
+                case Order::Insertion:
+                    expected = viaRange(d.begin_order(), d.end_order());
+                    break;
+            }
+            CHECK(out.str() == expected);
+        }
+    };
+    matches(counted);
+    matches(runs);
+    matches(tree);
+    std::ostringstream a, b;
+    counted.print(a, Order::SideCross);
+    runs.print(b, Order::SideCross);
+    CHECK(a.str() == b.str());
+    CountedContainer<int> one;
+    one.addElement(5);
+    std::ostringstream single;
+    one.print(single, Order::SideCross);
+    CHECK(single.str() == "[5]");
+}
+
+TEST_CASE("ConcurrentContainer: readers iterate stable snapshots while writers publish") {
+    ConcurrentContainer<int> shared;
+    CHECK(shared.size() == 0);
+
+    // A snapshot does not see later writes
+    shared.addElement(3);
+    shared.flush();
+    auto before = shared.snapshot();
+    std::vector<int> batch = {9, 1, 5};
+    shared.addElements(batch.begin(), batch.end());
+    CHECK(before->size() == 1);
+    CHECK(shared.size() == 4);
+    std::ostringstream os;
+    shared.snapshot()->print(os, Order::Ascending);
+    CHECK(os.str() == "[1, 3, 5, 9]");
+
+    // A failed remove publishes nothing
+    CHECK_THROWS_AS(shared.remove(42), std::runtime_error);
+    CHECK(shared.size() == 4);
+    shared.remove(9);
+    shared.update([](MyContainer<int>& c) {
+        c.addElement(-1);
+        c.addElement(-2);
+    });
+    std::ostringstream after;
+    after << *shared.snapshot();
+    CHECK(after.str() == "[3, 1, 5, -1, -2]");
+
+    // Stress: writers append pairs (v, -v) atomically, readers check that every
+    // snapshot is consistent in all six orders
+    ConcurrentContainer<int> stress;
+    constexpr int WRITERS = 3;
+    constexpr int PER_WRITER = 150;
+    std::atomic<bool> done(false);
+    std::atomic<int> bad(0);
+    std::vector<std::thread> threads;
+    for (int w = 0; w < WRITERS; ++w) {
+        threads.emplace_back([&stress, w]() {
+            for (int i = 1; i <= PER_WRITER; ++i) {
+                int v = w * PER_WRITER + i;
+                std::vector<int> pair = {v, -v};
+                stress.addElements(pair.begin(), pair.end());
+            }
+        });
+    }
+    for (int r = 0; r < 2; ++r) {
+        threads.emplace_back([&stress, &done, &bad]() {
+            while (!done.load()) {
+                auto snap = stress.snapshot();
+                std::size_t n = snap->size();
+                long long sum = 0;
+                std::size_t seen = 0;
+                for (auto it = snap->begin_order(); it != snap->end_order(); ++it) {
+                    sum += *it;
+                    ++seen;
+                }
+                int previous = std::numeric_limits<int>::min();
+                std::size_t ascending = 0;
+                for (auto it = snap->begin_ascending_order(); it != snap->end_ascending_order(); ++it) {
+                    if (*it < previous) {
+                        ++bad;
+                    }
+                    previous = *it;
+                    ++ascending;
+                }
+                std::size_t others = 0;
+                for (auto it = snap->begin_descending_order(); it != snap->end_descending_order(); ++it) ++others;
+                for (auto it = snap->begin_side_cross_order(); it != snap->end_side_cross_order(); ++it) ++others;
+                for (auto it = snap->begin_reverse_order(); it != snap->end_reverse_order(); ++it) ++others;
+                for (auto it = snap->begin_middle_out_order(); it != snap->end_middle_out_order(); ++it) ++others;
+                if (sum != 0 || n % 2 != 0 || seen != n || ascending != n || others != 4 * n) {
+                    ++bad;
+                }
+            }
+        });
+    }
+    for (int w = 0; w < WRITERS; ++w) {
+        threads[w].join();
+    }
+    done = true;
+    for (std::size_t t = WRITERS; t < threads.size(); ++t) {
+        threads[t].join();
+    }
+    CHECK(bad.load() == 0);
+    CHECK(stress.size() == static_cast<std::size_t>(2 * WRITERS * PER_WRITER));
+    std::ostringstream sorted;
+    stress.snapshot()->print(sorted, Order::Ascending);
+    CHECK(sorted.str().substr(0, 11) == "[-450, -449");
+}
+
+TEST_CASE("ConcurrentContainer: single appends are logged and folded in order") {
+    ConcurrentContainer<int> shared;
+    auto empty = shared.snapshot();
+    for (int i = 0; i < 1000; ++i) {
+        shared.addElement(i);
+    }
+    shared.flush();
+    CHECK(empty->size() == 0);
+    CHECK(shared.size() == 1000);
+    auto all = collectIterator(shared.snapshot()->begin_order(), shared.snapshot()->end_order());
+    std::vector<int> expected;
+    for (int i = 0; i < 1000; ++i) {
+        expected.push_back(i);
+    }
+    CHECK(all == expected);
+
+    // Other writes see the logged values first; a failed one keeps them logged
+    shared.addElement(5000);
+    shared.remove(5000);
+    CHECK(shared.size() == 1000);
+    shared.addElement(7000);
+    CHECK_THROWS_AS(shared.remove(42000), std::runtime_error);
+    shared.update([](MyContainer<int>& c) { c.remove(7000); });
+    CHECK(shared.size() == 1000);
+
+    // Single appenders and readers at once: every snapshot holds a prefix of
+    // each appender's values, and a thread sees its own appends after flush()
+    ConcurrentContainer<int> stress;
+    constexpr int WRITERS = 3;
+    constexpr int PER_WRITER = 2000;
+    std::atomic<bool> done(false);
+    std::atomic<int> bad(0);
+    std::vector<std::thread> threads;
+    for (int w = 0; w < WRITERS; ++w) {
+        threads.emplace_back([&stress, &bad, w]() {
+            for (int i = 0; i < PER_WRITER; ++i) {
+                stress.addElement(w * PER_WRITER + i);
+                if (i % 97 == 0) {
+                    stress.flush();
+                    auto snap = stress.snapshot();
+                    int own = 0;
+                    for (auto it = snap->begin_order(); it != snap->end_order(); ++it) {
+                        own += *it / PER_WRITER == w;
+                    }
+                    if (own != i + 1) {
+                        ++bad;
+                    }
+                }
+            }
+        });
+    }
+    threads.emplace_back([&stress, &done, &bad]() {
+        while (!done.load()) {
+            auto snap = stress.snapshot();
+            std::vector<int> next(WRITERS, 0);
+            for (auto it = snap->begin_order(); it != snap->end_order(); ++it) {
+                int w = *it / PER_WRITER;
+                if (*it != w * PER_WRITER + next[w]++) {
+                    ++bad;
+                }
+            }
+        }
+    });
+    for (int w = 0; w < WRITERS; ++w) {
+        threads[w].join();
+    }
+    done = true;
+    threads.back().join();
+    stress.flush();
+    CHECK(bad.load() == 0);
+    CHECK(stress.size() == static_cast<std::size_t>(WRITERS * PER_WRITER));
+
+    // Without flush() the queued flush still publishes every single append
+    ConcurrentContainer<int> background;
+    for (int i = 0; i < 500; ++i) {
+        background.addElement(i);
+    }
+    auto waited = std::chrono::steady_clock::now();
+    while (background.size() != 500 && std::chrono::steady_clock::now() - waited < std::chrono::seconds(10)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(background.size() == 500);
+}
+
+TEST_CASE("ConcurrentContainer: readers do not wait for a slow writer") {
+    ConcurrentContainer<int> shared;
+    std::vector<int> initial = {1, 2, 3};
+    shared.addElements(initial.begin(), initial.end());
+    std::atomic<bool> inside(false);
+    std::atomic<bool> finished(false);
+    std::thread slow([&shared, &inside, &finished]() {
+        shared.update([&inside](MyContainer<int>& c) {
+            inside = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(300));
+            c.addElement(4);
+        });
+        finished = true;
+    });
+    while (!inside.load()) {
+        std::this_thread::yield();
+    }
+    // A logged single append must not make readers fold it behind the writer
+    shared.addElement(5);
+    auto start = std::chrono::steady_clock::now();
+    auto snap = shared.snapshot();
+    std::size_t n = shared.size();
+    auto waited = std::chrono::steady_clock::now() - start;
+    CHECK_FALSE(finished.load());
+    CHECK(waited < std::chrono::milliseconds(100));
+    CHECK(snap->size() == 3);
+    CHECK(n == 3);
+    slow.join();
+    shared.flush();
+    std::ostringstream os;
+    os << *shared.snapshot();
+    CHECK(os.str() == "[1, 2, 3, 4, 5]");
+}
+
+TEST_CASE("ConcurrentAppender: lock-free producers keep per-thread order across segments") {
+    // Tiny first segment so the appends cross many segment boundaries
+    ConcurrentAppender<int, 4> appender;
+    constexpr int THREADS = 4;
+    constexpr int PER_THREAD = 2000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&appender, t]() {
+            if (t % 2 == 0) {
+                for (int i = 0; i < PER_THREAD; ++i) {
+                    appender.append(t * PER_THREAD + i);
+                }
+            } else {
+                ConcurrentAppender<int, 4>::Producer producer(appender, 37);
+                for (int i = 0; i < PER_THREAD; ++i) {
+                    producer.add(t * PER_THREAD + i);
+                }
+            } // producer flushes its last batch here
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    CHECK(appender.size() == static_cast<std::size_t>(THREADS * PER_THREAD));
+
+    MyContainer<int> c;
+    c.addElement(-1);
+    CHECK(appender.drainInto(c) == static_cast<std::size_t>(THREADS * PER_THREAD));
+    CHECK(appender.size() == 0);
+    CHECK(c.size() == static_cast<std::size_t>(THREADS * PER_THREAD + 1));
+
+    // Every value exactly once, and each thread's values in the order appended
+    std::vector<int> next(THREADS, 0);
+    bool ordered = true;
+    auto it = c.begin_order();
+    CHECK(*it == -1);
+    for (++it; it != c.end_order(); ++it) {
+        int t = *it / PER_THREAD;
+        ordered = ordered && (*it == t * PER_THREAD + next[t]);
+        ++next[t];
+    }
+    CHECK(ordered);
+    CHECK(std::all_of(next.begin(), next.end(), [](int k) { return k == PER_THREAD; }));
+
+    // The appender is reusable after a drain, also with range appends
+    std::vector<int> more = {5, 6, 7};
+    appender.append(more.begin(), more.end());
+    SegmentedContainer<int> s;
+    appender.drainInto(s);
+    std::ostringstream os;
+    os << s;
+    CHECK(os.str() == "[5, 6, 7]");
+}
+
+namespace {
+/// Value whose copy assignment throws for 13 (an append that fails after its reservation)
+struct Fragile {
+    int v = 0;
+    Fragile() = default;
+    Fragile(int x) : v(x) {}
+    Fragile(const Fragile&) = default;
+    Fragile& operator=(const Fragile& other) {
+        if (other.v == 13) {
+            throw std::runtime_error("cannot copy 13");
+        }
+        v = other.v;
+        return *this;
+    }
+    bool operator<(const Fragile& other) const { return v < other.v; }
+    bool operator==(const Fragile& other) const { return v == other.v; }
+};
+}
+
+TEST_CASE("ConcurrentAppender: a failed append is skipped and the drain appends in bulk") {
+    ConcurrentAppender<Fragile, 4> appender;
+    appender.append(Fragile(1));
+    std::vector<Fragile> bad = {2, 3, 13, 4, 5}; // crosses into the next segment
+    CHECK_THROWS_AS(appender.append(bad.begin(), bad.end()), std::runtime_error);
+    CHECK_THROWS_AS(appender.append(Fragile(13)), std::runtime_error);
+    CHECK(appender.size() == 1);
+    std::vector<Fragile> good = {6, 7, 8, 9, 10};
+    appender.append(good.begin(), good.end());
+    appender.append(Fragile(11));
+    CHECK(appender.size() == 7);
+
+    // Slots after the failed ones still drain, into a tree-indexed container
+    MyContainer<Fragile> c;
+    c.setTreeIndex(true);
+    c.addElement(Fragile(100));
+    CHECK(appender.drainInto(c) == 7);
+    std::vector<int> got;
+    for (auto it = c.begin_order(); it != c.end_order(); ++it) {
+        got.push_back((*it).v);
+    }
+    CHECK(got == std::vector<int>{100, 1, 6, 7, 8, 9, 10, 11});
+    CHECK((*c.begin_ascending_order()).v == 1);
+    CHECK(c.kthSmallest(7).v == 100);
+    CHECK((c.min().v == 1 && c.max().v == 100));
+
+    // The cleared flags do not leak into the next round
+    appender.append(Fragile(20));
+    MyContainer<Fragile> next;
+    CHECK(appender.drainInto(next) == 1);
+    CHECK(next.size() == 1);
+
+    // addElements on its own, from forward and single-pass iterators
+    MyContainer<int> plain;
+    std::vector<int> batch = {4, -2, 9};
+    plain.addElements(batch.begin(), batch.end());
+    std::istringstream stream("8 1");
+    plain.addElements(std::istream_iterator<int>(stream), std::istream_iterator<int>());
+    std::ostringstream os;
+    os << plain;
+    CHECK(os.str() == "[4, -2, 9, 8, 1]");
+    CHECK((plain.min() == -2 && plain.max() == 9));
+}
+
+TEST_CASE("ShardedContainer: six orders over all shards match a single container") {
+    using Sharded = ShardedContainer<int>;
+    for (Sharded::Routing routing : {Sharded::Routing::RoundRobin, Sharded::Routing::Hash}) {
+        Sharded sharded(3, routing);
+        MyContainer<int> plain;
+        for (int v : {7, 15, 6, 1, 2, 15, -4, 9, 6, 0, 11}) {
+            sharded.addElement(v);
+            plain.addElement(v);
+        }
+        CHECK(sharded.shardCount() == 3);
+        CHECK(sharded.size() == plain.size());
+
+        auto same = [](auto begin, auto end, auto pbegin, auto pend) {
+            std::ostringstream a, b;
+            a << formatRange(begin, end);
+            b << formatRange(pbegin, pend);
+            CHECK(a.str() == b.str());
+        };
+        auto all = [&]() {
+            same(sharded.begin_order(), sharded.end_order(), plain.begin_order(), plain.end_order());
+            same(sharded.begin_ascending_order(), sharded.end_ascending_order(),
+                 plain.begin_ascending_order(), plain.end_ascending_order());
+            same(sharded.begin_descending_order(), sharded.end_descending_order(),
+                 plain.begin_descending_order(), plain.end_descending_order());
+            same(sharded.begin_side_cross_order(), sharded.end_side_cross_order(),
+                 plain.begin_side_cross_order(), plain.end_side_cross_order());
+            same(sharded.begin_reverse_order(), sharded.end_reverse_order(),
+                 plain.begin_reverse_order(), plain.end_reverse_order());
+            same(sharded.begin_middle_out_order(), sharded.end_middle_out_order(),
+                 plain.begin_middle_out_order(), plain.end_middle_out_order());
+        };
+        all();
+
+        // Removing keeps the global insertion order of the survivors
+        sharded.remove(15);
+        plain.remove(15);
+        sharded.remove(6);
+        plain.remove(6);
+        all();
+        CHECK_THROWS_AS(sharded.remove(100), std::runtime_error);
+
+        std::ostringstream os;
+        os << sharded;
+        CHECK(os.str() == "[7, 1, 2, -4, 9, 0, 11]");
+    }
+
+    ShardedContainer<int> empty(2);
+    CHECK(empty.begin_ascending_order() == empty.end_ascending_order());
+    CHECK_THROWS_AS(*empty.begin_order(), std::out_of_range);
+    CHECK_THROWS_AS(empty.remove(1), std::runtime_error);
+    CHECK_THROWS_AS(empty.addElementTo(2, 1), std::runtime_error);
+}
+
+namespace {
+/// Ordered but not hashable: no std::hash specialization
+struct Reading {
+    int sensor;
+    double value;
+    bool operator<(const Reading& other) const {
+        return sensor < other.sensor || (sensor == other.sensor && value < other.value);
+    }
+    bool operator==(const Reading& other) const {
+        return sensor == other.sensor && value == other.value;
+    }
+};
+} // namespace
+
+TEST_CASE("ShardedContainer: round-robin routing works without std::hash") {
+    static_assert(!IsHashable<Reading>::value, "Reading must not be hashable for this test");
+    static_assert(IsHashable<int>::value, "int is hashable");
+    ShardedContainer<Reading> c(3);
+    for (int i = 0; i < 30; ++i) {
+        c.addElement({i % 4, i * 0.5});
+    }
+    CHECK(c.size() == 30);
+    c.remove({1, 0.5});
+    CHECK(c.size() == 29);
+    CHECK_THROWS_AS(c.remove({1, 0.5}), std::runtime_error);
+    int previous = -1;
+    for (auto it = c.begin_ascending_order(); it != c.end_ascending_order(); ++it) {
+        CHECK((*it).sensor >= previous);
+        previous = (*it).sensor;
+    }
+    CHECK_THROWS_AS(ShardedContainer<Reading>(3, ShardedContainer<Reading>::Routing::Hash), std::runtime_error);
+}
+
+TEST_CASE("ShardedContainer: concurrent ingest into owned shards and parallel shard traversal") {
+    constexpr int THREADS = 4;
+    constexpr int PER_THREAD = 500;
+    ShardedContainer<int> sharded(THREADS);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&sharded, t]() {
+            for (int i = 0; i < PER_THREAD; ++i) {
+                sharded.addElementTo(static_cast<std::size_t>(t), t * PER_THREAD + i);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    CHECK(sharded.size() == static_cast<std::size_t>(THREADS * PER_THREAD));
+
+    // The ascending merge yields 0 .. THREADS * PER_THREAD - 1
+    int expected = 0;
+    bool ordered = true;
+    for (auto it = sharded.begin_ascending_order(); it != sharded.end_ascending_order(); ++it) {
+        ordered = ordered && (*it == expected++);
+    }
+    CHECK(ordered);
+    CHECK(expected == THREADS * PER_THREAD);
+
+    std::vector<std::size_t> sizes(THREADS, 0);
+    sharded.forEachShard([&sizes](std::size_t i, const MyContainer<int>& shard) {
+        sizes[i] = shard.size();
+    });
+    CHECK(std::all_of(sizes.begin(), sizes.end(), [](std::size_t n) { return n == PER_THREAD; }));
+    CHECK_THROWS_AS(sharded.forEachShard([](std::size_t i, const MyContainer<int>&) {
+        if (i == 1) {
+            throw std::runtime_error("shard failed");
+        }
+    }), std::runtime_error);
+}
+
+TEST_CASE("MergedView: loser-tree merge of many containers in ascending and descending order") {
+    // Every number of containers from 0 to 17, including empty ones, so the
+    // tree is exercised with non power of two sizes and exhausted leaves
+    for (int k = 0; k <= 17; ++k) {
+        std::vector<MyContainer<int>> tenants(static_cast<std::size_t>(k));
+        MyContainer<int> all;
+        for (int t = 0; t < k; ++t) {
+            for (int i = 0; i < (t * 7) % 5; ++i) {
+                int v = (t * 31 + i * 17) % 23 - 11;
+                tenants[t].addElement(v);
+                all.addElement(v);
+            }
+        }
+        MergedView<int> view(tenants);
+        CHECK(view.size() == all.size());
+        std::ostringstream a, b, c, d;
+        a << formatRange(view.begin_ascending_order(), view.end_ascending_order());
+        b << formatRange(all.begin_ascending_order(), all.end_ascending_order());
+        c << formatRange(view.begin_descending_order(), view.end_descending_order());
+        d << formatRange(all.begin_descending_order(), all.end_descending_order());
+        CHECK(a.str() == b.str());
+        CHECK(c.str() == d.str());
+    }
+
+    // Pointer form skips null entries; the view is a snapshot of the containers
+    MyContainer<int> x, y;
+    for (int v : {5, 1, 9}) {
+        x.addElement(v);
+    }
+    for (int v : {4, 4, 10}) {
+        y.addElement(v);
+    }
+    MergedView<int> view({&x, nullptr, &y});
+    x.addElement(100);
+    std::ostringstream os;
+    os << formatRange(view.begin_ascending_order(), view.end_ascending_order());
+    CHECK(os.str() == "[1, 4, 4, 5, 9, 10]");
+
+    auto it = view.begin_descending_order();
+    CHECK(*it++ == 10);
+    CHECK(*it == 9);
+    auto end = view.end_descending_order();
+    for (int i = 0; i < 5; ++i) {
+        ++it;
+    }
+    CHECK(it == end);
+    CHECK_THROWS_AS(*it, std::out_of_range);
+    CHECK_THROWS_AS(++it, std::out_of_range);
+}
+
+TEST_CASE("OrderView gives random access in all six orders") {
+    MyContainer<int> c;
+    for (int v : {7, 15, 6, 1, 2, 4}) {
+        c.addElement(v);
+    }
+    auto matches = [&c](Order order, auto begin, auto end) {
+        auto view = c.view(order);
+        std::size_t k = 0;
+        bool same = true;
+        for (auto it = begin; it != end; ++it, ++k) {
+            same = same && (view[k] == *it) && (view.at(k) == *it);
+        }
+        CHECK(same);
+        CHECK(k == view.size());
+        CHECK_THROWS_AS(view.at(k), std::out_of_range);
+    };
+    matches(Order::Insertion, c.begin_order(), c.end_order());
+    matches(Order::Ascending, c.begin_ascending_order(), c.end_ascending_order());
+    matches(Order::Descending, c.begin_descending_order(), c.end_descending_order());
+    matches(Order::SideCross, c.begin_side_cross_order(), c.end_side_cross_order());
+    matches(Order::Reverse, c.begin_reverse_order(), c.end_reverse_order());
+    matches(Order::MiddleOut, c.begin_middle_out_order(), c.end_middle_out_order());
+}
+
+TEST_CASE("parallel_for_each / parallel_reduce on a work-stealing pool, every order") {
+    WorkStealingPool pool(3);
+    CHECK(pool.workerCount() == 3);
+
+    MyContainer<int> c;
+    for (int i = 0; i < 1000; ++i) {
+        c.addElement((i * 7919) % 1009 - 500);
+    }
+    for (Order order : {Order::Insertion, Order::Ascending, Order::Descending,
+                        Order::SideCross, Order::Reverse, Order::MiddleOut}) {
+        std::ostringstream expected;
+        c.print(expected, order);
+        for (std::size_t grain : {std::size_t(0), std::size_t(1), std::size_t(37)}) {
+            // Every position visited exactly once, with the right element
+            std::vector<int> seen(c.size());
+            std::vector<std::atomic<int>> visits(c.size());
+            parallel_for_each(c, order, [&](std::size_t k, const int& v) {
+                seen[k] = v;
+                ++visits[k];
+            }, grain, pool);
+            std::ostringstream got;
+            got << formatRange(seen.begin(), seen.end());
+            CHECK(got.str() == expected.str());
+            CHECK(std::all_of(visits.begin(), visits.end(), [](const std::atomic<int>& n) { return n.load() == 1; }));
+        }
+    }
+
+    // Non-commutative op (concatenation): the fold keeps position order
+    MyContainer<std::string> words;
+    for (int i = 0; i < 200; ++i) {
+        words.addElement(std::string(1, static_cast<char>('a' + (i * 7) % 26)) + std::to_string(i % 10));
+    }
+    for (Order order : {Order::Insertion, Order::Ascending, Order::Descending,
+                        Order::SideCross, Order::Reverse, Order::MiddleOut}) {
+        std::string expected = ">";
+        auto view = words.view(order);
+        for (std::size_t k = 0; k < view.size(); ++k) {
+            expected += view[k];
+        }
+        for (std::size_t grain : {std::size_t(0), std::size_t(1), std::size_t(37)}) {
+            auto concat = [](std::string a, const std::string& b) { return a + b; };
+            CHECK(parallel_reduce(words, order, std::string(">"), concat, grain, pool) == expected);
+        }
+    }
+
+    // Element-only callable, the default pool, and sums
+    std::atomic<long long> total(0);
+    parallel_for_each(c, Order::Ascending, [&total](const int& v) { total += v; });
+    long long sum = 0;
+    for (auto it = c.begin_order(); it != c.end_order(); ++it) {
+        sum += *it;
+    }
+    CHECK(total.load() == sum);
+    CHECK(parallel_reduce(c, Order::MiddleOut, 0LL, [](long long a, long long b) { return a + b; }) == sum);
+
+    // Folds that are not "add the element": every element goes through transform
+    MyContainer<int> sevens;
+    for (int i = 0; i < 1000; ++i) {
+        sevens.addElement(7);
+    }
+    auto atLeastFive = [](const int& v) { return v >= 5 ? 1L : 0L; };
+    auto plus = [](long a, long b) { return a + b; };
+    CHECK(parallel_transform_reduce(sevens, Order::Insertion, 0L, atLeastFive, plus, 100, pool) == 1000);
+    std::vector<int> values = collectIterator(c.begin_order(), c.end_order());
+    long large = static_cast<long>(std::count_if(values.begin(), values.end(), [](int v) { return v >= 5; }));
+    CHECK(parallel_transform_reduce(c, Order::Ascending, 5L, atLeastFive, plus, 37, pool) == 5 + large);
+    auto square = [](const int& v) { return static_cast<long long>(v) * v; };
+    auto larger = [](long long a, long long b) { return a < b ? b : a; };
+    long long widest = 0;
+    for (int v : values) {
+        widest = std::max(widest, square(v));
+    }
+    CHECK(parallel_transform_reduce(c, Order::SideCross, -1LL, square, larger, 7, pool) == widest);
+    MyContainer<int> none;
+    CHECK(parallel_transform_reduce(none, Order::Reverse, 3L, atLeastFive, plus, 0, pool) == 3);
+    for (std::size_t grain : {std::size_t(1), std::size_t(3), std::size_t(100)}) {
+        CHECK(parallel_reduce(c, Order::Descending, 1000LL, [](long long a, long long b) { return a + b; },
+                              grain, pool) == 1000 + sum);
+    }
+
+    // Ops whose identity is not R(): min, max and product from a real init
+    MyContainer<int> small;
+    for (int i = 0; i < 300; ++i) {
+        small.addElement(5 + (i * 37) % 101);
+    }
+    std::vector<int> smalls = collectIterator(small.begin_order(), small.end_order());
+    int lowest = *std::min_element(smalls.begin(), smalls.end());
+    int highest = *std::max_element(smalls.begin(), smalls.end());
+    auto smaller = [](int a, int b) { return b < a ? b : a; };
+    auto bigger = [](int a, int b) { return a < b ? b : a; };
+    MyContainer<int> factors;
+    for (int i = 0; i < 40; ++i) {
+        factors.addElement(i % 3 == 0 ? 3 : 1);
+    }
+    long long product = 1;
+    for (int i = 0; i < 40; ++i) {
+        product *= (i % 3 == 0 ? 3 : 1);
+    }
+    auto times = [](long long a, long long b) { return a * b; };
+    for (std::size_t grain : {std::size_t(0), std::size_t(1), std::size_t(7), std::size_t(1000)}) {
+        CHECK(parallel_reduce(small, Order::Insertion, std::numeric_limits<int>::max(), smaller, grain, pool) == lowest);
+        CHECK(parallel_reduce(small, Order::MiddleOut, 0, smaller, grain, pool) == 0);
+        CHECK(parallel_reduce(small, Order::SideCross, std::numeric_limits<int>::min(), bigger, grain, pool) == highest);
+        CHECK(parallel_reduce(small, Order::Descending, -7, bigger, grain, pool) == highest);
+        CHECK(parallel_reduce(factors, Order::Reverse, 1LL, times, grain, pool) == product);
+        CHECK(parallel_reduce(factors, Order::Ascending, 2LL, times, grain, pool) == 2 * product);
+    }
+
+    // Empty container, exceptions, nested parallel loops
+    MyContainer<int> empty;
+    CHECK(parallel_reduce(empty, Order::SideCross, 42, [](int a, int b) { return a + b; }, 0, pool) == 42);
+    CHECK_THROWS_AS(parallel_for_each(c, Order::Insertion, [](const int& v) {
+        if (v == 0) {
+            throw std::runtime_error("zero");
+        }
+    }, 8, pool), std::runtime_error);
+    // Slow pieces: the caller sleeps with a back-off and still sees every piece finish
+    std::atomic<int> slow(0);
+    pool.parallelFor(8, 1, [&slow](std::size_t b, std::size_t e) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(3));
+        slow += static_cast<int>(e - b);
+    });
+    CHECK(slow.load() == 8);
+    std::atomic<int> inner(0);
+    pool.parallelFor(4, 1, [&](std::size_t, std::size_t) {
+        pool.parallelFor(100, 10, [&](std::size_t b, std::size_t e) { inner += static_cast<int>(e - b); });
+    });
+    CHECK(inner.load() == 400);
+}
+
+TEST_CASE("removeIf and parallel compaction keep insertion order") {
+    // Small containers compact serially
+    MyContainer<int> small;
+    for (int v : {5, 1, 8, 1, 3, 8}) {
+        small.addElement(v);
+    }
+    CHECK(small.removeIf([](int v) { return v > 4; }) == 3);
+    CHECK(small.removeIf([](int v) { return v > 4; }) == 0);
+    std::ostringstream os;
+    os << small;
+    CHECK(os.str() == "[1, 1, 3]");
+
+    // Force the parallel path on several compaction blocks
+    const std::size_t saved = MyContainer<int>::parallel_remove_threshold;
+    MyContainer<int>::parallel_remove_threshold = 0;
+    MyContainer<int> big;
+    std::vector<int> expected;
+    for (int i = 0; i < 300000; ++i) {
+        int v = static_cast<int>((i * 7919LL) % 1000);
+        big.addElement(v);
+        if (v % 3 != 0 && v != 500) {
+            expected.push_back(v);
+        }
+    }
+    CHECK(*big.begin_ascending_order() == 0); // sorted cache must be dropped
+    CHECK(big.removeIf([](int v) { return v % 3 == 0; }) == 334 * 300);
+    big.remove(500);
+    CHECK_THROWS_AS(big.remove(500), std::runtime_error);
+    CHECK(big.size() == expected.size());
+    CHECK(*big.begin_ascending_order() == 1);
+    bool same = true;
+    std::size_t k = 0;
+    for (auto it = big.begin_order(); it != big.end_order(); ++it, ++k) {
+        same = same && (*it == expected[k]);
+    }
+    CHECK(same);
+
+    // A throwing predicate leaves the container unchanged
+    CHECK_THROWS_AS(big.removeIf([](int v) -> bool {
+        if (v == 998) {
+            throw std::runtime_error("stop");
+        }
+        return true;
+    }), std::runtime_error);
+    CHECK(big.size() == expected.size());
+
+    // Removing nothing, and removing everything
+    CHECK(big.removeIf([](int) { return false; }) == 0);
+    CHECK(big.removeIf([](int) { return true; }) == expected.size());
+    CHECK(big.size() == 0);
+    MyContainer<int>::parallel_remove_threshold = saved;
+
+    // Mmap storage and non-trivial elements take the parallel path too
+    const std::size_t savedMmap = MmapContainer<int>::parallel_remove_threshold;
+    MmapContainer<int>::parallel_remove_threshold = 0;
+    MmapContainer<int> mapped;
+    for (int i = 0; i < 100000; ++i) {
+        mapped.addElement(i % 10);
+    }
+    mapped.remove(3);
+    CHECK(mapped.size() == 90000);
+    std::ostringstream head;
+    head << formatRange(mapped.begin_order(), mapped.end_order());
+    CHECK(head.str().substr(0, 31) == "[0, 1, 2, 4, 5, 6, 7, 8, 9, 0, ");
+    MmapContainer<int>::parallel_remove_threshold = savedMmap;
+
+    MyContainer<std::string>::parallel_remove_threshold = 0;
+    MyContainer<std::string> words;
+    for (const char* w : {"a", "bb", "c", "dd", "e"}) {
+        words.addElement(w);
+    }
+    CHECK(words.removeIf([](const std::string& w) { return w.size() == 2; }) == 2);
+    std::ostringstream ws;
+    ws << words;
+    CHECK(ws.str() == "[a, c, e]");
+    MyContainer<std::string>::parallel_remove_threshold = std::size_t(1) << 20;
+}
+
+TEST_CASE("Shared default pool: configuration, fork-join and parallel sort of the sorted cache") {
+    WorkStealingPool& pool = defaultPool();
+    CHECK(&pool == &defaultPool());
+    CHECK(pool.workerCount() >= 1);
+    CHECK_THROWS_AS(setDefaultPoolWorkers(2), std::runtime_error);
+
+    // invoke runs both sides, also nested inside pool tasks
+    std::atomic<int> calls(0);
+    pool.invoke([&]() { ++calls; }, [&]() {
+        pool.invoke([&]() { ++calls; }, [&]() { ++calls; });
+    });
+    CHECK(calls.load() == 3);
+    CHECK_THROWS_AS(pool.invoke([]() {}, []() { throw std::runtime_error("right"); }), std::runtime_error);
+
+    // parallelSort agrees with std::sort for several sizes and piece counts
+    for (std::size_t n : {std::size_t(0), std::size_t(5), std::size_t(4096), std::size_t(100003)}) {
+        std::vector<int> values(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            values[i] = static_cast<int>((i * 2654435761u) % 1000);
+        }
+        std::vector<int> expected = values;
+        std::sort(expected.begin(), expected.end());
+        WorkStealingPool small(3);
+        parallelSort(values, small);
+        CHECK(values == expected);
+    }
+
+    // The sorted iterators use it above parallel_sort_threshold
+    const std::size_t saved = MyContainer<std::string>::parallel_sort_threshold;
+    MyContainer<std::string>::parallel_sort_threshold = 0;
+    MyContainer<std::string> words;
+    for (int i = 0; i < 5000; ++i) {
+        words.addElement(std::to_string((i * 7919) % 5003));
+    }
+    std::vector<std::string> expected;
+    for (auto it = words.begin_order(); it != words.end_order(); ++it) {
+        expected.push_back(*it);
+    }
+    std::sort(expected.begin(), expected.end());
+    std::size_t k = 0;
+    bool same = true;
+    for (auto it = words.begin_ascending_order(); it != words.end_ascending_order(); ++it, ++k) {
+        same = same && (*it == expected[k]);
+    }
+    CHECK(same);
+    CHECK(k == expected.size());
+    MyContainer<std::string>::parallel_sort_threshold = saved;
+}
+
+TEST_CASE("SortedRuns: base and delta read as one merged run in both directions") {
+    auto base = std::make_shared<const std::vector<int>>(std::vector<int>{1, 3, 3, 5, 8, 9});
+    auto delta = std::make_shared<const std::vector<int>>(std::vector<int>{0, 3, 6, 9, 10});
+    SortedRuns<int> runs(base, delta);
+    std::vector<int> merged{0, 1, 3, 3, 3, 5, 6, 8, 9, 9, 10};
+    REQUIRE(runs.size() == merged.size());
+
+    // Every split point yields the tail of the merge forwards and the head backwards
+    for (std::size_t k = 0; k <= merged.size(); ++k) {
+        SortedRuns<int>::Cursor c = runs.split(k);
+        CHECK(c.base + c.delta == k);
+        std::vector<int> tail;
+        for (SortedRuns<int>::Cursor f = c; f.base + f.delta < runs.size(); runs.advance(f)) {
+            tail.push_back(runs.next(f));
+        }
+        CHECK(tail == std::vector<int>(merged.begin() + k, merged.end()));
+        std::vector<int> head;
+        for (SortedRuns<int>::Cursor b = c; b.base + b.delta > 0; runs.retreat(b)) {
+            head.push_back(runs.previous(b));
+        }
+        CHECK(head == std::vector<int>(merged.rbegin() + (merged.size() - k), merged.rend()));
+    }
+
+    // The sorted iterators accept runs and start mid-way
+    CHECK(*AscendingOrderIterator<int>(runs, 4) == 3);
+    CHECK(*DescendingOrderIterator<int>(runs, 1) == 9);
+    CHECK(*SideCrossOrderIterator<int>(runs, 3) == 9);
+    CHECK(*SideCrossOrderIterator<int>(runs, 4) == 3);
+    CHECK(*AscendingOrderIterator<int>(SortedRuns<int>(nullptr, delta), 0) == 0);
+}
+
+TEST_CASE("Background sort: queries merge a sorted delta until the rebuild is adopted") {
+    MyContainer<int> c;
+    c.setBackgroundSort(true);
+    CHECK(c.backgroundSort());
+    std::vector<int> all;
+    for (int i = 0; i < 2000; ++i) {
+        c.addElement((i * 7919) % 1009);
+        all.push_back((i * 7919) % 1009);
+    }
+    auto collect = [](auto first, auto last) {
+        std::vector<int> out;
+        for (; first != last; ++first) {
+            out.push_back(*first);
+        }
+        return out;
+    };
+    std::vector<int> sorted = all;
+    std::sort(sorted.begin(), sorted.end());
+    CHECK(collect(c.begin_ascending_order(), c.end_ascending_order()) == sorted);
+
+    // Bursts of appends between queries: every order stays exact while stale
+    for (int burst = 0; burst < 5; ++burst) {
+        for (int i = 0; i < 300; ++i) {
+            int v = (burst * 300 + i) * 31 % 1013;
+            c.addElement(v);
+            all.push_back(v);
+        }
+        sorted = all;
+        std::sort(sorted.begin(), sorted.end());
+        CHECK(collect(c.begin_ascending_order(), c.end_ascending_order()) == sorted);
+        CHECK(collect(c.begin_descending_order(), c.end_descending_order())
+              == std::vector<int>(sorted.rbegin(), sorted.rend()));
+        std::vector<int> side;
+        for (std::size_t k = 0; k < sorted.size(); ++k) {
+            side.push_back(k % 2 == 0 ? sorted[k / 2] : sorted[sorted.size() - 1 - k / 2]);
+        }
+        CHECK(collect(c.begin_side_cross_order(), c.end_side_cross_order()) == side);
+    }
+
+    // Once the rebuild is adopted the cache covers every element
+    c.waitForBackgroundSort();
+    CHECK(c.sortedView()->size() == c.size());
+    CHECK(*c.sortedView() == sorted);
+
+    // Copies, remove and turning the option off keep the orders exact
+    MyContainer<int> copy = c;
+    copy.addElement(-1);
+    CHECK(*copy.begin_ascending_order() == -1);
+    c.addElement(5000);
+    c.remove(0);
+    sorted.erase(std::remove(sorted.begin(), sorted.end(), 0), sorted.end());
+    sorted.push_back(5000);
+    CHECK(collect(c.begin_ascending_order(), c.end_ascending_order()) == sorted);
+    c.addElement(-7);
+    c.setBackgroundSort(false);
+    CHECK(*c.begin_ascending_order() == -7);
+    CHECK(c.sortedView()->size() == c.size());
+}
+
+TEST_CASE("Incremental sorted index: delta merges and deletion markers keep every order exact") {
+    const std::size_t saved = MyContainer<int>::delta_merge_threshold;
+    for (std::size_t threshold : {std::size_t(0), std::size_t(16), std::size_t(1) << 20}) {
+        MyContainer<int>::delta_merge_threshold = threshold;
+        MyContainer<int> c;
+        std::vector<int> all;
+        auto check = [&]() {
+            std::vector<int> sorted = all;
+            std::sort(sorted.begin(), sorted.end());
+            std::vector<int> asc;
+            for (auto it = c.begin_ascending_order(); it != c.end_ascending_order(); ++it) {
+                asc.push_back(*it);
+            }
+            std::vector<int> desc;
+            for (auto it = c.begin_descending_order(); it != c.end_descending_order(); ++it) {
+                desc.push_back(*it);
+            }
+            std::vector<int> side;
+            for (auto it = c.begin_side_cross_order(); it != c.end_side_cross_order(); ++it) {
+                side.push_back(*it);
+            }
+            std::vector<int> expected_side;
+            for (std::size_t k = 0; k < sorted.size(); ++k) {
+                expected_side.push_back(k % 2 == 0 ? sorted[k / 2] : sorted[sorted.size() - 1 - k / 2]);
+            }
+            CHECK(asc == sorted);
+            CHECK(desc == std::vector<int>(sorted.rbegin(), sorted.rend()));
+            CHECK(side == expected_side);
+            auto view = c.view(Order::Ascending);
+            bool same = view.size() == sorted.size();
+            for (std::size_t k = 0; same && k < sorted.size(); ++k) {
+                same = view[k] == sorted[k];
+            }
+            CHECK(same);
+        };
+        for (int round = 0; round < 20; ++round) {
+            for (int i = 0; i < 37; ++i) {
+                int v = (round * 37 + i) * 17 % 101;
+                c.addElement(v);
+                all.push_back(v);
+            }
+            // Removed values are marked deleted in the base and dropped from the delta
+            int gone = (round * 13) % 101;
+            if (std::find(all.begin(), all.end(), gone) != all.end()) {
+                c.remove(gone);
+                all.erase(std::remove(all.begin(), all.end(), gone), all.end());
+            }
+            if (round % 3 == 0) {
+                check();
+            }
+        }
+        check();
+
+        // A value removed from the base and added again is visible once
+        int v = all.front();
+        c.remove(v);
+        all.erase(std::remove(all.begin(), all.end(), v), all.end());
+        c.addElement(v);
+        all.push_back(v);
+        check();
+
+        // Two removes between queries, then removeIf drops the index
+        for (int gone : {all.back(), all.front()}) {
+            c.remove(gone);
+            all.erase(std::remove(all.begin(), all.end(), gone), all.end());
+        }
+        check();
+        c.removeIf([](int x) { return x % 2 == 0; });
+        all.erase(std::remove_if(all.begin(), all.end(), [](int x) { return x % 2 == 0; }), all.end());
+        c.addElement(1000);
+        all.push_back(1000);
+        check();
+    }
+    MyContainer<int>::delta_merge_threshold = saved;
+}
+
+TEST_CASE("OrderStatisticTree: ranks, k-th element, leaves and copy-on-write snapshots") {
+    OrderStatisticTree<int> tree;
+    std::vector<int> reference;
+    for (int i = 0; i < 20000; ++i) {
+        int v = static_cast<int>((i * 7919LL) % 1543);
+        tree.insert(v);
+        reference.insert(std::upper_bound(reference.begin(), reference.end(), v), v);
+    }
+    REQUIRE(tree.size() == reference.size());
+    OrderStatisticTree<int> snapshot = tree; // shares every node
+
+    // Erase by value and by rank
+    CHECK(tree.eraseAll(7) == static_cast<std::size_t>(std::count(reference.begin(), reference.end(), 7)));
+    reference.erase(std::remove(reference.begin(), reference.end(), 7), reference.end());
+    CHECK(tree.eraseAll(7) == 0);
+    for (int i = 0; i < 5000; ++i) {
+        std::size_t rank = (static_cast<std::size_t>(i) * 104729) % reference.size();
+        tree.eraseAt(rank);
+        reference.erase(reference.begin() + static_cast<std::ptrdiff_t>(rank));
+    }
+    REQUIRE(tree.size() == reference.size());
+    bool same = true;
+    for (std::size_t k = 0; k < reference.size(); k += 7) {
+        same = same && tree.kth(k) == reference[k];
+    }
+    CHECK(same);
+    for (int v : {-1, 0, 7, 700, 1542, 2000}) {
+        CHECK(tree.lowerRank(v) == static_cast<std::size_t>(
+            std::lower_bound(reference.begin(), reference.end(), v) - reference.begin()));
+        CHECK(tree.upperRank(v) == static_cast<std::size_t>(
+            std::upper_bound(reference.begin(), reference.end(), v) - reference.begin()));
+    }
+
+    // Leaves cover the ranks in order
+    std::vector<int> walked;
+    for (std::size_t rank = 0; rank < tree.size();) {
+        OrderStatisticTree<int>::Chunk leaf = tree.chunkAt(rank);
+        CHECK(leaf.first == rank);
+        walked.insert(walked.end(), leaf.values, leaf.values + leaf.size);
+        rank += leaf.size;
+    }
+    CHECK(walked == reference);
+
+    // The snapshot still holds the 20000 original elements
+    CHECK(snapshot.size() == 20000);
+    std::vector<int> before;
+    snapshot.forEach([&before](int v) { before.push_back(v); });
+    CHECK(std::is_sorted(before.begin(), before.end()));
+    CHECK(std::count(before.begin(), before.end(), 7) > 0);
+
+    // Bulk build, empty tree and bounds
+    OrderStatisticTree<int> built = OrderStatisticTree<int>::fromSorted(reference.begin(), reference.end());
+    CHECK(built.size() == reference.size());
+    CHECK(built.kth(reference.size() - 1) == reference.back());
+    CHECK_THROWS_AS(built.kth(reference.size()), std::out_of_range);
+    OrderStatisticTree<int> empty;
+    CHECK(empty.size() == 0);
+    CHECK(empty.lowerRank(3) == 0);
+    CHECK_THROWS_AS(empty.eraseAt(0), std::out_of_range);
+}
+
+TEST_CASE("Tree index: O(log n) updates serve the sorted orders and kthSmallest") {
+    MyContainer<int> c;
+    for (int v : {5, 3, 9, 3}) {
+        c.addElement(v);
+    }
+    c.setTreeIndex(true);
+    CHECK(c.treeIndex());
+    std::vector<int> all{5, 3, 9, 3};
+    auto check = [&]() {
+        std::vector<int> sorted = all;
+        std::sort(sorted.begin(), sorted.end());
+        std::vector<int> asc;
+        for (auto it = c.begin_ascending_order(); it != c.end_ascending_order(); ++it) {
+            asc.push_back(*it);
+        }
+        std::vector<int> desc;
+        for (auto it = c.begin_descending_order(); it != c.end_descending_order(); ++it) {
+            desc.push_back(*it);
+        }
+        std::vector<int> side;
+        for (auto it = c.begin_side_cross_order(); it != c.end_side_cross_order(); ++it) {
+            side.push_back(*it);
+        }
+        std::vector<int> expected_side;
+        for (std::size_t k = 0; k < sorted.size(); ++k) {
+            expected_side.push_back(k % 2 == 0 ? sorted[k / 2] : sorted[sorted.size() - 1 - k / 2]);
+        }
+        CHECK(asc == sorted);
+        CHECK(desc == std::vector<int>(sorted.rbegin(), sorted.rend()));
+        CHECK(side == expected_side);
+        bool same = true;
+        for (std::size_t k = 0; k < sorted.size(); k += 3) {
+            same = same && c.kthSmallest(k) == sorted[k];
+        }
+        CHECK(same);
+        CHECK(*c.sortedView() == std::vector<int>(sorted.begin(), sorted.end()));
+    };
+    check();
+
+    // An iterator keeps reading its snapshot while the tree changes
+    auto first = c.begin_ascending_order();
+    for (int i = 0; i < 3000; ++i) {
+        int v = static_cast<int>((i * 7919LL) % 2003);
+        c.addElement(v);
+        all.push_back(v);
+        if (i % 10 == 9) {
+            c.remove(v);
+            all.erase(std::remove(all.begin(), all.end(), v), all.end());
+        }
+    }
+    CHECK(*first == 3);
+    CHECK(*++first == 3);
+    check();
+
+    c.removeIf([](int x) { return x % 3 == 0; });
+    all.erase(std::remove_if(all.begin(), all.end(), [](int x) { return x % 3 == 0; }), all.end());
+    check();
+    std::istringstream text("[4, 1, 4]");
+    text >> c;
+    all = {4, 1, 4};
+    check();
+    MyContainer<int> copy = c;
+    copy.addElement(0);
+    CHECK(copy.kthSmallest(0) == 0);
+    CHECK(c.kthSmallest(0) == 1);
+    CHECK_THROWS_AS(c.kthSmallest(3), std::out_of_range);
+    c.setTreeIndex(false);
+    c.addElement(2);
+    all.push_back(2);
+    check();
+}
+
+TEST_CASE("Range seek: ascending / descending from a bound and equal_range") {
+    const std::size_t saved = MyContainer<int>::delta_merge_threshold;
+    MyContainer<int>::delta_merge_threshold = std::size_t(1) << 20; // keep a delta run
+    for (int mode = 0; mode < 3; ++mode) {
+        MyContainer<int> c;
+        std::vector<int> all;
+        for (int i = 0; i < 500; ++i) {
+            int v = (i * 37) % 101 * 2; // even values 0 .. 200, with duplicates
+            c.addElement(v);
+            all.push_back(v);
+        }
+        if (mode == 1) {
+            CHECK(*c.begin_ascending_order() == 0); // index built; the rest goes to the delta
+            for (int i = 0; i < 60; ++i) {
+                c.addElement(i * 3);
+                all.push_back(i * 3);
+            }
+        }
+        if (mode == 2) {
+            c.setTreeIndex(true);
+        }
+        std::vector<int> sorted = all;
+        std::sort(sorted.begin(), sorted.end());
+        for (int bound : {-5, 0, 1, 50, 51, 177, 200, 201}) {
+            std::vector<int> up;
+            for (auto it = c.begin_ascending_order_from(bound); it != c.end_ascending_order(); ++it) {
+                up.push_back(*it);
+            }
+            CHECK(up == std::vector<int>(std::lower_bound(sorted.begin(), sorted.end(), bound), sorted.end()));
+            std::vector<int> down;
+            for (auto it = c.begin_descending_order_from(bound); it != c.end_descending_order(); ++it) {
+                down.push_back(*it);
+            }
+            std::vector<int> expected(sorted.begin(), std::upper_bound(sorted.begin(), sorted.end(), bound));
+            std::reverse(expected.begin(), expected.end());
+            CHECK(down == expected);
+            auto range = c.equal_range(bound);
+            std::size_t copies = 0;
+            for (auto it = range.first; it != range.second; ++it, ++copies) {
+                CHECK(*it == bound);
+            }
+            CHECK(copies == static_cast<std::size_t>(std::count(sorted.begin(), sorted.end(), bound)));
+        }
+    }
+    MyContainer<int> empty;
+    CHECK(empty.begin_ascending_order_from(3) == empty.end_ascending_order());
+    CHECK_THROWS_AS(*empty.begin_descending_order_from(3), std::out_of_range);
+    MyContainer<int>::delta_merge_threshold = saved;
+}
+
+TEST_CASE("Search accelerator: Eytzinger layout, contains and count") {
+    for (std::size_t n : {0u, 1u, 2u, 7u, 8u, 100u, 1000u}) {
+        std::vector<int> sorted;
+        for (std::size_t i = 0; i < n; ++i) {
+            sorted.push_back(static_cast<int>(i / 3) * 2); // duplicates and gaps
+        }
+        EytzingerIndex<int> layout(sorted);
+        CHECK(layout.size() == n);
+        for (int v = -2; v <= static_cast<int>(n) + 2; ++v) {
+            CHECK(layout.lowerRank(v) == static_cast<std::size_t>(std::lower_bound(sorted.begin(), sorted.end(), v) - sorted.begin()));
+            CHECK(layout.upperRank(v) == static_cast<std::size_t>(std::upper_bound(sorted.begin(), sorted.end(), v) - sorted.begin()));
+        }
+    }
+
+    std::size_t saved = MyContainer<int>::delta_merge_threshold;
+    MyContainer<int>::delta_merge_threshold = 1000;
+    for (int mode = 0; mode < 3; ++mode) {
+        MyContainer<int> c;
+        c.setSearchAccelerator(mode != 2);
+        CHECK(c.searchAccelerator() == (mode != 2));
+        std::vector<int> all;
+        for (int i = 0; i < 300; ++i) {
+            int v = (i * 37) % 101;
+            c.addElement(v);
+            all.push_back(v);
+        }
+        CHECK(*c.begin_ascending_order() == 0); // base built (with its layout)
+        if (mode == 1) {
+            for (int i = 0; i < 40; ++i) { // delta on top of the accelerated base
+                c.addElement(i * 5);
+                all.push_back(i * 5);
+            }
+            c.remove(50);
+            all.erase(std::remove(all.begin(), all.end(), 50), all.end());
+        }
+        if (mode == 2) {
+            c.setTreeIndex(true);
+        }
+        for (int v = -3; v <= 210; ++v) {
+            std::size_t copies = static_cast<std::size_t>(std::count(all.begin(), all.end(), v));
+            CHECK(c.count(v) == copies);
+            CHECK(c.contains(v) == (copies > 0));
+        }
+        std::vector<int> sorted = all;
+        std::sort(sorted.begin(), sorted.end());
+        std::vector<int> up;
+        for (auto it = c.begin_ascending_order_from(60); it != c.end_ascending_order(); ++it) {
+            up.push_back(*it);
+        }
+        CHECK(up == std::vector<int>(std::lower_bound(sorted.begin(), sorted.end(), 60), sorted.end()));
+    }
+    MyContainer<int> empty;
+    empty.setSearchAccelerator(true);
+    CHECK_FALSE(empty.contains(1));
+    CHECK(empty.count(1) == 0);
+    MyContainer<int>::delta_merge_threshold = saved;
+}
+
+TEST_CASE("Order statistics: min, max, nth, median, percentile and middle") {
+    MyContainer<int> empty;
+    CHECK_THROWS_AS(empty.min(), std::runtime_error);
+    CHECK_THROWS_AS(empty.max(), std::runtime_error);
+    CHECK_THROWS_AS(empty.median(), std::runtime_error);
+    CHECK_THROWS_AS(empty.percentile(50), std::runtime_error);
+    CHECK_THROWS_AS(empty.middle(), std::runtime_error);
+    CHECK_THROWS_AS(empty.nth(0), std::out_of_range);
+
+    for (int mode = 0; mode < 3; ++mode) {
+        MyContainer<int> c;
+        std::vector<int> all;
+        for (int i = 0; i < 501; ++i) {
+            int v = (i * 7919) % 1000 - 300;
+            c.addElement(v);
+            all.push_back(v);
+        }
+        if (mode == 1) {
+            CHECK(*c.begin_ascending_order() == -300); // sorted index: lookups
+            c.addElement(5000);                        // ... with a delta run
+            all.push_back(5000);
+        }
+        if (mode == 2) {
+            c.setTreeIndex(true);
+        }
+        std::vector<int> sorted = all;
+        std::sort(sorted.begin(), sorted.end());
+        std::size_t n = sorted.size();
+        CHECK(c.min() == sorted.front());
+        CHECK(c.max() == sorted.back());
+        for (std::size_t k : {std::size_t(0), std::size_t(1), n / 3, n / 2, n - 1}) {
+            CHECK(c.nth(k) == sorted[k]);
+        }
+        CHECK_THROWS_AS(c.nth(n), std::out_of_range);
+        CHECK(c.median() == sorted[(n - 1) / 2]);
+        CHECK(c.percentile(0) == sorted.front());
+        CHECK(c.percentile(100) == sorted.back());
+        CHECK(c.percentile(50) == sorted[(n + 1) / 2 - 1]);
+        CHECK(c.percentile(99) == sorted[static_cast<std::size_t>(std::ceil(0.99 * n)) - 1]);
+        CHECK_THROWS_AS(c.percentile(-1), std::out_of_range);
+        CHECK_THROWS_AS(c.percentile(100.5), std::out_of_range);
+        CHECK(c.middle() == all[n / 2]);
+        CHECK(c.middle() == *c.begin_middle_out_order());
+    }
+
+    // Extremes follow every modification
+    MyContainer<int> c;
+    c.addElement(5);
+    CHECK((c.min() == 5 && c.max() == 5));
+    c.addElement(9);
+    c.addElement(-2);
+    c.addElement(9);
+    CHECK((c.min() == -2 && c.max() == 9));
+    c.remove(9);
+    CHECK(c.max() == 5);
+    c.remove(-2);
+    CHECK(c.min() == 5);
+    c.addElement(1);
+    c.addElement(8);
+    c.removeIf([](int v) { return v < 3; });
+    CHECK((c.min() == 5 && c.max() == 8));
+    std::vector<char> bytes;
+    MyContainer<int> other;
+    other.addElement(42);
+    other.addElement(-42);
+    other.save(bytes);
+    c.load(bytes.data(), bytes.size());
+    CHECK((c.min() == -42 && c.max() == 42));
+    MyContainer<int> copy = c;
+    CHECK((copy.min() == -42 && copy.max() == 42));
+    MyContainer<int> moved = std::move(copy);
+    CHECK(moved.max() == 42);
+
+    // Mapped files look the extremes up (through the stored permutation)
+    const std::string path = "mycontainer_stats.bin";
+    for (bool with_permutation : {true, false}) {
+        c.saveFile(path, with_permutation);
+        auto m = MyContainer<int>::mapFile(path);
+        CHECK((m.min() == -42 && m.max() == 42));
+        CHECK(m.median() == -42);
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("top_k / bottom_k and partial sort iterators") {
+    std::vector<int> all;
+    MyContainer<int> plain;
+    for (int i = 0; i < 1000; ++i) {
+        int v = (i * 7919) % 401; // duplicates
+        all.push_back(v);
+        plain.addElement(v);
+    }
+    std::vector<int> up = all;
+    std::sort(up.begin(), up.end());
+    std::vector<int> down(up.rbegin(), up.rend());
+
+    MyContainer<int> indexed = plain;
+    CHECK(*indexed.begin_ascending_order() == up.front());
+    indexed.addElement(-1); // delta run
+    MyContainer<int> tree = plain;
+    tree.setTreeIndex(true);
+    for (std::size_t k : {std::size_t(0), std::size_t(1), std::size_t(10), std::size_t(999), std::size_t(5000)}) {
+        std::size_t m = std::min(k, up.size());
+        std::vector<int> smallest(up.begin(), up.begin() + m);
+        std::vector<int> largest(down.begin(), down.begin() + m);
+        CHECK(plain.bottom_k(k) == smallest);
+        CHECK(plain.top_k(k) == largest);
+        CHECK(tree.bottom_k(k) == smallest);
+        CHECK(tree.top_k(k) == largest);
+        std::vector<int> with_delta = indexed.bottom_k(k);
+        if (m > 0) {
+            CHECK(with_delta.front() == -1);
+        }
+        std::vector<int> top = indexed.top_k(k);
+        CHECK(std::vector<int>(top.begin(), top.begin() + m) == largest); // -1 is last, if taken
+    }
+
+    const std::string path = "mycontainer_topk.bin";
+    for (bool with_permutation : {true, false}) {
+        plain.saveFile(path, with_permutation);
+        auto m = MyContainer<int>::mapFile(path);
+        CHECK(m.top_k(5) == std::vector<int>(down.begin(), down.begin() + 5));
+        CHECK(m.bottom_k(5) == std::vector<int>(up.begin(), up.begin() + 5));
+    }
+    std::remove(path.c_str());
+
+    // Partial sort iterators yield the full orders, read in any amount
+    CHECK(collectIterator(plain.begin_partial_ascending_order(), plain.end_partial_ascending_order()) == up);
+    CHECK(collectIterator(plain.begin_partial_descending_order(), plain.end_partial_descending_order()) == down);
+    auto it = plain.begin_partial_descending_order();
+    auto copy = it;
+    for (int i = 0; i < 100; ++i) {
+        ++it; // sorts past the first batch through it ...
+    }
+    CHECK(*it == down[100]);
+    CHECK(*copy == down[0]); // ... without disturbing the copy
+    CHECK(*copy++ == down[0]);
+    CHECK(*copy == down[1]);
+
+    MyContainer<int> empty;
+    CHECK(empty.top_k(3).empty());
+    CHECK(empty.begin_partial_ascending_order() == empty.end_partial_ascending_order());
+    CHECK_THROWS_AS(*empty.begin_partial_descending_order(), std::out_of_range);
+    CHECK_THROWS_AS(++empty.begin_partial_ascending_order(), std::out_of_range);
+}
+
+TEST_CASE("Distinct values, count_of and histogram") {
+    for (int mode = 0; mode < 3; ++mode) {
+        MyContainer<int> c;
+        std::vector<int> all;
+        for (int i = 0; i < 2000; ++i) {
+            int v = (i % 7 == 0) ? 42 : (i * 31) % 97; // 42 has many copies
+            c.addElement(v);
+            all.push_back(v);
+        }
+        if (mode == 1) {
+            CHECK(*c.begin_ascending_order() == 0);
+            for (int v : {42, 500, -1, 500}) { // delta run
+                c.addElement(v);
+                all.push_back(v);
+            }
+        }
+        if (mode == 2) {
+            c.setTreeIndex(true);
+        }
+        std::vector<int> sorted = all;
+        std::sort(sorted.begin(), sorted.end());
+        std::vector<int> distinct = sorted;
+        distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+
+        auto values = c.distinct_ascending();
+        CHECK(collectIterator(values.begin(), values.end()) == distinct);
+        std::vector<std::pair<int, std::size_t>> expected;
+        for (int v : distinct) {
+            expected.push_back({v, static_cast<std::size_t>(std::count(all.begin(), all.end(), v))});
+            CHECK(c.count_of(v) == expected.back().second);
+        }
+        auto hist = c.histogram();
+        CHECK(collectIterator(hist.begin(), hist.end()) == expected);
+        std::size_t total = 0;
+        for (auto it = values.begin(); it != values.end(); ++it) {
+            total += it.count();
+        }
+        CHECK(total == all.size());
+        CHECK(c.count_of(1000) == 0);
+
+        // The view is a snapshot
+        c.addElement(7777);
+        CHECK(collectIterator(values.begin(), values.end()) == distinct);
+    }
+
+    MyContainer<int> empty;
+    auto none = empty.histogram();
+    CHECK(none.begin() == none.end());
+    CHECK_THROWS_AS(*none.begin(), std::out_of_range);
+    CHECK_THROWS_AS(++none.begin(), std::out_of_range);
+    CHECK_THROWS_AS(none.begin().count(), std::out_of_range);
+}
+
+TEST_CASE("Counted storage: distinct values with counts behave like a plain container") {
+    CountedContainer<int> c;
+    MyContainer<int> plain;
+    auto same = [&]() {
+        CHECK(c.size() == plain.size());
+        CHECK(collectIterator(c.begin_order(), c.end_order()) == collectIterator(plain.begin_order(), plain.end_order()));
+        CHECK(collectIterator(c.begin_ascending_order(), c.end_ascending_order())
+              == collectIterator(plain.begin_ascending_order(), plain.end_ascending_order()));
+        CHECK(collectIterator(c.begin_descending_order(), c.end_descending_order())
+              == collectIterator(plain.begin_descending_order(), plain.end_descending_order()));
+        CHECK(collectIterator(c.begin_side_cross_order(), c.end_side_cross_order())
+              == collectIterator(plain.begin_side_cross_order(), plain.end_side_cross_order()));
+        CHECK(collectIterator(c.begin_middle_out_order(), c.end_middle_out_order())
+              == collectIterator(plain.begin_middle_out_order(), plain.end_middle_out_order()));
+        std::ostringstream a, b;
+        c.print(a, Order::Descending);
+        plain.print(b, Order::Descending);
+        CHECK(a.str() == b.str());
+        for (Order order : {Order::Ascending, Order::Descending, Order::SideCross}) {
+            auto vc = c.view(order);
+            auto vp = plain.view(order);
+            std::vector<int> got, want;
+            for (std::size_t k = 0; k < vc.size(); ++k) {
+                got.push_back(vc[k]);
+                want.push_back(vp.at(k));
+            }
+            CHECK(got == want);
+        }
+        CHECK(*c.sortedView() == std::vector<int>(plain.sortedView()->begin(), plain.sortedView()->end()));
+    };
+    for (int i = 0; i < 3000; ++i) {
+        int v = (i * 7919) % 23 - 5;
+        c.addElement(v);
+        plain.addElement(v);
+    }
+    same();
+
+    // The expansion of the counts is made once per version and dropped by a write
+    auto expanded = c.sortedView();
+    CHECK(c.sortedView() == expanded);
+    c.addElement(1000);
+    CHECK(c.sortedView() != expanded);
+    CHECK(c.sortedView()->size() == expanded->size() + 1);
+    c.remove(1000);
+    same();
+    auto distinct = [&c]() {
+        auto values = c.distinct_ascending();
+        return collectIterator(values.begin(), values.end()).size();
+    };
+    CHECK(distinct() == 23);
+    for (int v = -7; v < 20; ++v) {
+        CHECK(c.count(v) == plain.count(v));
+        CHECK(c.contains(v) == plain.contains(v));
+        auto range = c.equal_range(v);
+        CHECK(collectIterator(range.first, range.second).size() == plain.count(v));
+        CHECK(collectIterator(c.begin_ascending_order_from(v), c.end_ascending_order())
+              == collectIterator(plain.begin_ascending_order_from(v), plain.end_ascending_order()));
+    }
+    CHECK((c.min() == plain.min() && c.max() == plain.max()));
+    CHECK((c.median() == plain.median() && c.nth(1234) == plain.nth(1234)));
+    CHECK(c.top_k(40) == plain.top_k(40));
+    auto hc = c.histogram();
+    auto hp = plain.histogram();
+    CHECK(collectIterator(hc.begin(), hc.end()) == collectIterator(hp.begin(), hp.end()));
+
+    // remove drops a value's whole count; removeIf asks once per distinct value
+    c.remove(3);
+    plain.remove(3);
+    CHECK_THROWS_AS(c.remove(3), std::runtime_error);
+    CHECK(distinct() == 22);
+    int calls = 0;
+    CHECK(c.removeIf([&calls](int v) { ++calls; return v % 2 == 0; }) == plain.removeIf([](int v) { return v % 2 == 0; }));
+    CHECK(calls == 22);
+    same();
+    for (int v : {100, 3, 3, -5}) { // new values reuse freed ids
+        c.addElement(v);
+        plain.addElement(v);
+    }
+    same();
+    const std::size_t live = distinct();
+    for (int round = 0; round < 3; ++round) { // churn through the free-list of ids
+        for (int v = 2000; v < 2500; ++v) {
+            c.addElement(v);
+            plain.addElement(v);
+        }
+        CHECK(distinct() == live + 500);
+        CHECK(c.removeIf([](int v) { return v >= 2000; }) == 500);
+        plain.removeIf([](int v) { return v >= 2000; });
+        same();
+    }
+
+    // Copies, serialization and the tree index
+    CountedContainer<int> copy = c;
+    c.addElement(0);
+    CHECK(copy.size() + 1 == c.size());
+    std::vector<char> bytes;
+    copy.save(bytes);
+    CountedContainer<int> loaded;
+    loaded.load(bytes.data(), bytes.size());
+    CHECK(collectIterator(loaded.begin_order(), loaded.end_order()) == collectIterator(copy.begin_order(), copy.end_order()));
+    c.setTreeIndex(true);
+    plain.addElement(0);
+    CHECK(c.kthSmallest(10) == plain.kthSmallest(10));
+    same();
+
+    // Strings, and too many distinct values for the id type
+    MyContainer<std::string, CountedStorage<std::string>> words;
+    for (const char* w : {"b", "a", "b", "c", "a"}) {
+        words.addElement(w);
+    }
+    std::ostringstream os;
+    os << words;
+    CHECK(os.str() == "[b, a, b, c, a]");
+    CHECK(*words.begin_descending_order() == "c");
+    MyContainer<int, CountedStorage<int, std::uint8_t>> narrow;
+    for (int v = 0; v < 256; ++v) {
+        narrow.addElement(v);
+    }
+    CHECK_THROWS_AS(narrow.addElement(256), std::runtime_error);
+    CHECK(narrow.size() == 256);
+    narrow.remove(7);
+    narrow.addElement(256);
+    CHECK(narrow.max() == 256);
+}
+
+TEST_CASE("Set operations: merge, union, intersection and difference of sorted indexes") {
+    auto expected = [](SetOperation op, std::vector<int> l, std::vector<int> r) {
+        std::sort(l.begin(), l.end());
+        std::sort(r.begin(), r.end());
+        std::vector<int> out;
+        switch (op) {
+        case SetOperation::Merge:
+            std::merge(l.begin(), l.end(), r.begin(), r.end(), std::back_inserter(out));
+            break;
+        case SetOperation::Union:
+            std::set_union(l.begin(), l.end(), r.begin(), r.end(), std::back_inserter(out));
+            break;
+        case SetOperation::Intersection:
+            std::set_intersection(l.begin(), l.end(), r.begin(), r.end(), std::back_inserter(out));
+            break;
+        case SetOperation::Difference:
+            std::set_difference(l.begin(), l.end(), r.begin(), r.end(), std::back_inserter(out));
+            break;
+        }
+        return out;
+    };
+    auto result = [](SetOperation op, const MyContainer<int>& l, const MyContainer<int>& r) {
+        switch (op) {
+        case SetOperation::Merge: return l.merge(r);
+        case SetOperation::Union: return l.set_union(r);
+        case SetOperation::Intersection: return l.set_intersection(r);
+        default: return l.set_difference(r);
+        }
+    };
+    const SetOperation ops[] = {SetOperation::Merge, SetOperation::Union,
+                                SetOperation::Intersection, SetOperation::Difference};
+    // every op on every pair, eagerly and lazily, compared with the std algorithms
+    auto check = [&](const MyContainer<int>& l, const MyContainer<int>& r) {
+        std::vector<int> lv = collectIterator(l.begin_order(), l.end_order());
+        std::vector<int> rv = collectIterator(r.begin_order(), r.end_order());
+        for (SetOperation op : ops) {
+            std::vector<int> want = expected(op, lv, rv);
+            auto view = l.set_operation(op, r);
+            CHECK(collectIterator(view.begin(), view.end()) == want);
+            MyContainer<int> out = result(op, l, r);
+            CHECK(collectIterator(out.begin_order(), out.end_order()) == want);
+            CHECK(collectIterator(out.begin_ascending_order(), out.end_ascending_order()) == want);
+            if (!want.empty()) {
+                CHECK((out.min() == want.front() && out.max() == want.back()));
+            }
+        }
+    };
+
+    MyContainer<int> a, b, empty;
+    for (int i = 0; i < 2000; ++i) {
+        a.addElement((i * 37) % 101);      // ~20 copies of each of 0..100
+        b.addElement((i * 53) % 151 - 40); // ~13 copies of each of -40..110
+    }
+    check(a, b);
+    check(b, a);
+    check(a, empty);
+    check(empty, a);
+    check(a, a);
+
+    // delta runs of recent appends are merged on the fly
+    a.addElement(500);
+    b.addElement(-100);
+    b.addElement(50);
+    check(a, b);
+
+    // very different sizes take the seeking paths
+    MyContainer<int> few;
+    for (int v : {-1, 7, 7, 50, 99, 1000}) {
+        few.addElement(v);
+    }
+    MyContainer<int> many;
+    for (int i = 0; i < 5000; ++i) {
+        many.addElement(i % 1200);
+    }
+    check(few, many);
+    check(many, few);
+    many.addElement(7);
+    check(few, many);
+
+    // the tree index and counted storage are read through their own runs
+    many.setTreeIndex(true);
+    check(many, a);
+    CountedContainer<int> cl, cr;
+    for (int i = 0; i < 300; ++i) {
+        cl.addElement(i % 7);
+        cr.addElement(i % 5 + 3);
+    }
+    auto inter = cl.set_intersection(cr);
+    CHECK(inter.count(3) == std::min(cl.count(3), cr.count(3)));
+    CHECK(inter.size() == 43 + 43 + 43 + 42); // values 3..6
+    auto diff = cl.set_operation(SetOperation::Difference, cr);
+    CHECK(collectIterator(diff.begin(), diff.end()).size() == cl.size() - inter.size());
+
+    // counted results are built from the counts and match the plain ones
+    MyContainer<int> pl, pr;
+    for (int i = 0; i < 300; ++i) {
+        pl.addElement(i % 7);
+        pr.addElement(i % 5 + 3);
+    }
+    for (SetOperation op : ops) {
+        CountedContainer<int> counted = op == SetOperation::Merge ? cl.merge(cr)
+            : op == SetOperation::Union ? cl.set_union(cr)
+            : op == SetOperation::Intersection ? cl.set_intersection(cr) : cl.set_difference(cr);
+        MyContainer<int> plain = result(op, pl, pr);
+        CHECK(collectIterator(counted.begin_order(), counted.end_order())
+              == collectIterator(plain.begin_order(), plain.end_order()));
+        CHECK(collectIterator(counted.begin_descending_order(), counted.end_descending_order())
+              == collectIterator(plain.begin_descending_order(), plain.end_descending_order()));
+        if (plain.size() > 0) {
+            CHECK((counted.min() == plain.min() && counted.max() == plain.max()));
+            int first = plain.min();
+            counted.remove(first);
+            plain.remove(first);
+            CHECK(collectIterator(counted.begin_ascending_order(), counted.end_ascending_order())
+                  == collectIterator(plain.begin_ascending_order(), plain.end_ascending_order()));
+        }
+    }
+    CHECK(CountedContainer<int>().set_union(CountedContainer<int>()).size() == 0);
+
+    // views are snapshots; end iterators do not move
+    auto view = a.set_operation(SetOperation::Union, b);
+    std::size_t before = collectIterator(view.begin(), view.end()).size();
+    a.addElement(-1000);
+    CHECK(collectIterator(view.begin(), view.end()).size() == before);
+    auto it = view.end();
+    CHECK_THROWS_AS(*it, std::out_of_range);
+    CHECK_THROWS_AS(++it, std::out_of_range);
+
+    // non-arithmetic elements
+    MyContainer<std::string> s1, s2;
+    for (const char* w : {"pear", "apple", "fig", "apple"}) {
+        s1.addElement(w);
+    }
+    for (const char* w : {"fig", "apple", "kiwi"}) {
+        s2.addElement(w);
+    }
+    auto common = s1.set_intersection(s2);
+    CHECK(collectIterator(common.begin_order(), common.end_order()) == std::vector<std::string>{"apple", "fig"});
+    auto only = s1.set_difference(s2);
+    CHECK(collectIterator(only.begin_order(), only.end_order()) == std::vector<std::string>{"apple", "pear"});
+}
+
+namespace {
+struct Purchase {
+    int customer;
+    int amount;
+    bool operator<(const Purchase& other) const {
+        return customer < other.customer || (customer == other.customer && amount < other.amount);
+    }
+    bool operator==(const Purchase& other) const {
+        return customer == other.customer && amount == other.amount;
+    }
+};
+struct Customer {
+    int id;
+    std::string name;
+    bool operator<(const Customer& other) const { return id < other.id; }
+    bool operator==(const Customer& other) const { return id == other.id; }
+};
+} // namespace
+
+TEST_CASE("Sort-merge join: matched pairs by projection keys") {
+    MyContainer<Purchase> purchases;
+    MyContainer<Customer> customers;
+    for (int i = 0; i < 600; ++i) {
+        purchases.addElement({(i * 7) % 41, i});   // customers 0..40, ~15 purchases each
+    }
+    for (int id = 20; id < 60; ++id) {
+        customers.addElement({id, "c" + std::to_string(id)});
+    }
+    customers.addElement({25, "twin"}); // duplicates on both sides
+
+    // every pair, compared with a nested loop over the insertion orders
+    auto joined = [&]() {
+        std::vector<std::pair<Purchase, Customer>> out;
+        for (const auto& match : purchases.join(customers, &Purchase::customer, &Customer::id)) {
+            out.emplace_back(match.first, match.second);
+        }
+        return out;
+    };
+    auto expected = [&]() {
+        std::size_t pairs = 0;
+        for (auto p = purchases.begin_order(); p != purchases.end_order(); ++p) {
+            for (auto c = customers.begin_order(); c != customers.end_order(); ++c) {
+                pairs += (*p).customer == (*c).id ? 1 : 0;
+            }
+        }
+        return pairs;
+    };
+    auto pairs = joined();
+    CHECK(pairs.size() == expected());
+    for (std::size_t i = 0; i < pairs.size(); ++i) {
+        CHECK(pairs[i].first.customer == pairs[i].second.id);
+        if (i > 0) { // ascending key order, left-major within a key
+            CHECK(!(pairs[i].first < pairs[i - 1].first));
+        }
+    }
+    auto with = [&pairs](auto pred) { return std::count_if(pairs.begin(), pairs.end(), pred); };
+    CHECK(with([](const auto& m) { return m.first.customer == 25; })
+          == 2 * with([](const auto& m) { return m.second.name == "twin"; }));
+
+    // delta runs, the tree index and a lambda projection shared by both sides
+    purchases.addElement({59, 1});
+    customers.setTreeIndex(true);
+    customers.addElement({59, "late"});
+    CHECK(joined().size() == expected());
+    auto byId = [](const auto& x) -> int {
+        if constexpr (std::is_same<std::decay_t<decltype(x)>, Purchase>::value) {
+            return x.customer;
+        } else {
+            return x.id;
+        }
+    };
+    auto view = purchases.join(customers, byId);
+    CHECK(collectIterator(view.begin(), view.end()).size() == expected());
+
+    // identity join of plain values: every combination of equal values
+    MyContainer<int> l, r, none;
+    for (int v : {1, 2, 2, 3, 5, 5, 5}) {
+        l.addElement(v);
+    }
+    for (int v : {2, 2, 4, 5, 6}) {
+        r.addElement(v);
+    }
+    auto ints = l.join(r);
+    std::vector<std::pair<int, int>> got;
+    for (auto it = ints.begin(); it != ints.end(); ++it) {
+        got.emplace_back((*it).first, (*it).second);
+    }
+    CHECK(got == std::vector<std::pair<int, int>>{{2, 2}, {2, 2}, {2, 2}, {2, 2}, {5, 5}, {5, 5}, {5, 5}});
+    auto empty = l.join(none);
+    CHECK(empty.begin() == empty.end());
+    auto it = empty.end();
+    CHECK_THROWS_AS(*it, std::out_of_range);
+    CHECK_THROWS_AS(++it, std::out_of_range);
+
+    // a key that is not ordered by the ascending order is reported
+    auto descending = [](int v) { return -v; };
+    CHECK_THROWS_AS(collectIterator(l.join(r, descending).begin(), l.join(r, descending).end()), std::runtime_error);
+
+    // a key that goes down only once, past the point where the other side ends,
+    // is reported too, before any pair is produced
+    MyContainer<int> ranks;
+    for (int v : {1, 2, 3}) {
+        ranks.addElement(v);
+    }
+    MyContainer<int> two;
+    two.addElement(2);
+    auto swapped = [](int v) { return v == 2 ? 3 : (v == 3 ? 2 : v); }; // keys 1, 3, 2
+    CHECK_THROWS_AS(ranks.join(two, swapped, IdentityKey{}), std::runtime_error);
+    CHECK_THROWS_AS(two.join(ranks, IdentityKey{}, swapped), std::runtime_error);
+    MyContainer<int> mixed;
+    for (int v : {1, 2, 3, 4}) {
+        mixed.addElement(v);
+    }
+    auto late = [](int v) { return v == 4 ? 0 : v; }; // keys 1, 2, 3, 0
+    CHECK_THROWS_AS(mixed.join(ranks, late, IdentityKey{}), std::runtime_error);
+    CHECK(collectIterator(ranks.join(two, IdentityKey{}, IdentityKey{}).begin(),
+                          ranks.join(two, IdentityKey{}, IdentityKey{}).end()).size() == 1);
+}